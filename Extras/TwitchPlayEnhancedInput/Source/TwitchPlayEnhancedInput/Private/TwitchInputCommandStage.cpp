@@ -0,0 +1,84 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "TwitchInputCommandStage.h"
+#include "TwitchInputMapping.h"
+
+FTwitchInputCommandStage::FTwitchInputCommandStage(const UTwitchInputMapping& mapping, const FString& commandDelimiter, const FString& optionsDelimiter)
+	: CommandDelimiter(commandDelimiter)
+	, OptionsDelimiter(optionsDelimiter)
+{
+	for(int32 index = 0; index < mapping.Mappings.Num(); ++index)
+	{
+		const FTwitchInputCommandMapping& command_mapping = mapping.Mappings[index];
+		if(!command_mapping.Command.IsEmpty() && command_mapping.Action != nullptr)
+		{
+			Commands.FindOrAdd(command_mapping.Command).Emplace(command_mapping.Option, index);
+		}
+	}
+}
+
+void FTwitchInputCommandStage::TakeTriggered(TArray<int32>& mappingsOut)
+{
+	mappingsOut.Reset();
+	FScopeLock lock(&Lock);
+	Swap(mappingsOut, Triggered);
+}
+
+void FTwitchInputCommandStage::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	TArray<int32, TInlineAllocator<64>> triggered;
+	for(const FTwitchChatMessage& message : messages)
+	{
+		// Senders without the roles of a registered command can't inject input with it
+		if(message.bCommandRejected)
+		{
+			continue;
+		}
+
+		// Registered commands were already parsed and authorized, other commands are parsed here
+		const FOptionMappings* option_mappings;
+		FString option;
+		if(!message.Command.IsEmpty())
+		{
+			option_mappings = Commands.Find(message.Command);
+			if(option_mappings != nullptr && message.Options.Num() > 0)
+			{
+				option = message.Options[0];
+			}
+		}
+		else
+		{
+			const FString command = FTwitchCommandRules::GetDelimitedString(message.Message, CommandDelimiter);
+			option_mappings = command.IsEmpty() ? nullptr : Commands.Find(command);
+			if(option_mappings != nullptr)
+			{
+				option = FTwitchCommandRules::GetDelimitedString(message.Message, OptionsDelimiter);
+				int32 comma;
+				if(option.FindChar(TEXT(','), comma))
+				{
+					option.LeftInline(comma);
+				}
+			}
+		}
+
+		if(option_mappings == nullptr)
+		{
+			continue;
+		}
+
+		option.TrimStartAndEndInline();
+		for(const TPair<FString, int32>& option_mapping : *option_mappings)
+		{
+			if(option_mapping.Key.IsEmpty() || option_mapping.Key.Equals(option, ESearchCase::IgnoreCase))
+			{
+				triggered.Add(option_mapping.Value);
+			}
+		}
+	}
+
+	if(triggered.Num() > 0)
+	{
+		FScopeLock lock(&Lock);
+		Triggered.Append(triggered);
+	}
+}
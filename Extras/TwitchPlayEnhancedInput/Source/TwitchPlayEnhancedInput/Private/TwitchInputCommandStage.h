@@ -0,0 +1,41 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+
+class UTwitchInputMapping;
+
+/**
+ * Matches chat commands against an input mapping on the receiver thread.
+ * The game thread only takes the indices of the mappings that were triggered.
+ */
+class FTwitchInputCommandStage final : public ITwitchChatStage
+{
+public:
+
+	FTwitchInputCommandStage(const UTwitchInputMapping& mapping, const FString& commandDelimiter, const FString& optionsDelimiter);
+
+	// Takes the indices of the mappings triggered since the last call, in order of arrival
+	void TakeTriggered(TArray<int32>& mappingsOut);
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+
+private:
+
+	// Option, empty for any, and index of each mapping of a command
+	using FOptionMappings = TArray<TPair<FString, int32>, TInlineAllocator<4>>;
+
+	// Copied from the mapping, the asset is not touched off the game thread
+	TMap<FString, FOptionMappings> Commands;
+
+	const FString CommandDelimiter;
+	const FString OptionsDelimiter;
+
+	TArray<int32> Triggered;
+	FCriticalSection Lock;
+};
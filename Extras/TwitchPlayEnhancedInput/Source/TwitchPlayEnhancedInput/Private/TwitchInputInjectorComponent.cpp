@@ -0,0 +1,197 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "TwitchInputInjectorComponent.h"
+#include "TwitchInputCommandStage.h"
+#include "TwitchInputMapping.h"
+#include "Components/TwitchPlayComponent.h"
+#include "EnhancedInputSubsystems.h"
+#include "InputAction.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+UTwitchInputInjectorComponent::UTwitchInputInjectorComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+}
+
+void UTwitchInputInjectorComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Inject before the controller builds its input stack for this frame
+	if(APlayerController* controller = GetPlayerController())
+	{
+		controller->PrimaryActorTick.AddPrerequisite(this, PrimaryComponentTick);
+		PrerequisiteController = controller;
+	}
+
+	InstallStage();
+}
+
+void UTwitchInputInjectorComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UninstallStage();
+	HeldInputs.Reset();
+
+	if(APlayerController* controller = PrerequisiteController.Get())
+	{
+		controller->PrimaryActorTick.RemovePrerequisite(this, PrimaryComponentTick);
+	}
+	PrerequisiteController.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTwitchInputInjectorComponent::SetChatComponent(UTwitchIRCComponent* chatComponent)
+{
+	if(chatComponent == ChatComponent)
+	{
+		return;
+	}
+
+	UninstallStage();
+	ChatComponent = chatComponent;
+	if(HasBegunPlay())
+	{
+		InstallStage();
+	}
+}
+
+void UTwitchInputInjectorComponent::SetMapping(UTwitchInputMapping* mapping)
+{
+	if(mapping == Mapping)
+	{
+		return;
+	}
+
+	// Stage indices and held actions belong to the previous mapping
+	UninstallStage();
+	HeldInputs.Reset();
+	Mapping = mapping;
+	if(HasBegunPlay())
+	{
+		InstallStage();
+	}
+}
+
+void UTwitchInputInjectorComponent::InstallStage()
+{
+	if(ChatComponent == nullptr || Mapping == nullptr || CommandStage.IsValid())
+	{
+		return;
+	}
+
+	FString command_delimiter = TEXT("!");
+	FString options_delimiter = TEXT("#");
+	if(const UTwitchPlayComponent* play_component = Cast<UTwitchPlayComponent>(ChatComponent))
+	{
+		command_delimiter = play_component->command_encapsulation_char_;
+		options_delimiter = play_component->options_encapsulation_char_;
+	}
+
+	CommandStage = MakeShared<FTwitchInputCommandStage, ESPMode::ThreadSafe>(*Mapping, command_delimiter, options_delimiter);
+	ChatComponent->AddChatStage(CommandStage);
+}
+
+void UTwitchInputInjectorComponent::UninstallStage()
+{
+	if(CommandStage.IsValid() && ChatComponent != nullptr)
+	{
+		ChatComponent->RemoveChatStage(CommandStage);
+	}
+	CommandStage.Reset();
+}
+
+APlayerController* UTwitchInputInjectorComponent::GetPlayerController() const
+{
+	AActor* owner = GetOwner();
+	if(APlayerController* controller = Cast<APlayerController>(owner))
+	{
+		return controller;
+	}
+
+	const APawn* pawn = Cast<APawn>(owner);
+	return pawn != nullptr ? Cast<APlayerController>(pawn->GetController()) : nullptr;
+}
+
+void UTwitchInputInjectorComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if(CommandStage.IsValid())
+	{
+		CommandStage->TakeTriggered(Triggered);
+	}
+
+	if(Triggered.Num() > 0)
+	{
+		struct FMergedInput
+		{
+			FVector Sum = FVector::ZeroVector;
+			FVector Latest = FVector::ZeroVector;
+			int32 Count = 0;
+			float HoldSeconds = 0.0f;
+		};
+
+		// Commands of the same frame make a single value per action
+		TMap<const UInputAction*, FMergedInput, TInlineSetAllocator<8>> merged_inputs;
+		for(const int32 mapping_index : Triggered)
+		{
+			const FTwitchInputCommandMapping& command_mapping = Mapping->Mappings[mapping_index];
+			FMergedInput& merged = merged_inputs.FindOrAdd(command_mapping.Action);
+			merged.Sum += command_mapping.Value;
+			merged.Latest = command_mapping.Value;
+			merged.HoldSeconds = FMath::Max(merged.HoldSeconds, command_mapping.HoldSeconds);
+			++merged.Count;
+		}
+
+		for(const TPair<const UInputAction*, FMergedInput>& entry : merged_inputs)
+		{
+			const FMergedInput& merged = entry.Value;
+			FVector value;
+			switch(Mapping->MergeMode)
+			{
+			case ETwitchInputMerge::AVERAGE:
+				value = merged.Sum / static_cast<float>(merged.Count);
+				break;
+			case ETwitchInputMerge::LATEST:
+				value = merged.Latest;
+				break;
+			default:
+				value = merged.Sum.BoundToCube(1.0f);
+				break;
+			}
+
+			// New commands replace what is still held for the action
+			HeldInputs.Add(entry.Key, FHeldInput { value, merged.HoldSeconds });
+		}
+	}
+
+	if(HeldInputs.Num() == 0)
+	{
+		return;
+	}
+
+	const APlayerController* controller = GetPlayerController();
+	const ULocalPlayer* local_player = controller != nullptr ? controller->GetLocalPlayer() : nullptr;
+	UEnhancedInputLocalPlayerSubsystem* input_subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(local_player);
+	if(input_subsystem == nullptr)
+	{
+		return;
+	}
+
+	// Every held input is injected at least once, even a single frame one
+	for(auto it = HeldInputs.CreateIterator(); it; ++it)
+	{
+		const UInputAction* action = it->Key;
+		input_subsystem->InjectInputForAction(action, FInputActionValue(action->ValueType, it->Value.Value), {}, {});
+
+		it->Value.RemainingSeconds -= DeltaTime;
+		if(it->Value.RemainingSeconds <= 0.0f)
+		{
+			it.RemoveCurrent();
+		}
+	}
+}
@@ -0,0 +1,76 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TwitchInputInjectorComponent.generated.h"
+
+class UInputAction;
+class UTwitchIRCComponent;
+class UTwitchInputMapping;
+class FTwitchInputCommandStage;
+class APlayerController;
+
+/**
+ * Injects chat commands into Enhanced Input as if a local player had pressed the mapped actions.
+ * Games written against input actions get chat control without per-command callbacks.
+ * Add it to a PlayerController (or a Pawn it possesses). Commands are matched on the receiver thread
+ * and injected before the controller processes its input, so they show up in the same frame's input stack.
+ */
+UCLASS(ClassGroup = (TwitchAPI), meta = (BlueprintSpawnableComponent))
+class TWITCHPLAYENHANCEDINPUT_API UTwitchInputInjectorComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	// Commands to actions
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	UTwitchInputMapping* Mapping = nullptr;
+
+	UTwitchInputInjectorComponent();
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/**
+	 * Sets the component whose chat drives the input. Works before or after it connects.
+	 * Delimiters of a TwitchPlayComponent are used to parse commands it did not register.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Input")
+	void SetChatComponent(UTwitchIRCComponent* chatComponent);
+
+	// Swaps the mapping. Held inputs are released.
+	UFUNCTION(BlueprintCallable, Category = "Input")
+	void SetMapping(UTwitchInputMapping* mapping);
+
+private:
+
+	// Value injected every frame until the hold runs out
+	struct FHeldInput
+	{
+		FVector Value;
+		float RemainingSeconds;
+	};
+
+	void InstallStage();
+	void UninstallStage();
+
+	APlayerController* GetPlayerController() const;
+
+	UPROPERTY(Transient)
+	UTwitchIRCComponent* ChatComponent = nullptr;
+
+	TSharedPtr<FTwitchInputCommandStage, ESPMode::ThreadSafe> CommandStage;
+
+	// Actions are kept alive by the mapping
+	TMap<const UInputAction*, FHeldInput> HeldInputs;
+
+	// Mapping indices taken from the stage, reused between ticks
+	TArray<int32> Triggered;
+
+	// Controller this component ticks before
+	TWeakObjectPtr<APlayerController> PrerequisiteController;
+};
@@ -0,0 +1,66 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TwitchInputMapping.generated.h"
+
+class UInputAction;
+
+// How the commands received in the same frame for the same action make a single input value
+UENUM(BlueprintType)
+enum class ETwitchInputMerge : uint8
+{
+	// Values add up, each component clamped to [-1, 1]. Opposite commands cancel out.
+	SUM,
+	// Average of the values
+	AVERAGE,
+	// Value of the command received last
+	LATEST,
+};
+
+// A chat command driving an input action
+USTRUCT(BlueprintType)
+struct FTwitchInputCommandMapping
+{
+	GENERATED_BODY()
+
+	// Command to react to (ie. up for !up!)
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	FString Command;
+
+	// First option the command must have (ie. 2 for !jump#2#), case insensitive. Empty for any.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	FString Option;
+
+	// Action to inject
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	UInputAction* Action = nullptr;
+
+	// Value injected, only the components used by the action value type matter. (1, 0, 0) presses a digital action.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	FVector Value = FVector(1.0f, 0.0f, 0.0f);
+
+	// Seconds the value is held. 0 injects it for a single frame.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input", meta = (ClampMin = "0"))
+	float HoldSeconds = 0.0f;
+};
+
+/**
+ * Maps chat commands to Enhanced Input actions, for a TwitchInputInjector.
+ */
+UCLASS(BlueprintType)
+class TWITCHPLAYENHANCEDINPUT_API UTwitchInputMapping : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	TArray<FTwitchInputCommandMapping> Mappings;
+
+	// How commands received in the same frame for the same action are merged
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Input")
+	ETwitchInputMerge MergeMode = ETwitchInputMerge::SUM;
+};
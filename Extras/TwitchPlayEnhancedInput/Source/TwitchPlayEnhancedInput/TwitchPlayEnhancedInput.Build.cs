@@ -0,0 +1,26 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+using UnrealBuildTool;
+using System.IO;
+
+public class TwitchPlayEnhancedInput : ModuleRules
+{
+	public TwitchPlayEnhancedInput(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public"));
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private"));
+
+		PublicDependencyModuleNames.AddRange(
+			 new string[]
+			 {
+					 "Core",
+					 "CoreUObject",
+					 "Engine",
+					 "EnhancedInput",
+					 "TwitchPlay",
+			 }
+			 );
+	}
+}
@@ -0,0 +1,290 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "NiagaraDataInterfaceTwitchChat.h"
+#include "NiagaraTypes.h"
+#include "VectorVM.h"
+
+#define LOCTEXT_NAMESPACE "NiagaraDataInterfaceTwitchChat"
+
+namespace TwitchChatNiagara
+{
+	static const FName GetMessageRateName(TEXT("GetMessageRate"));
+	static const FName GetNewMessagesName(TEXT("GetNewMessages"));
+	static const FName GetNumTopEmotesName(TEXT("GetNumTopEmotes"));
+	static const FName GetTopEmoteName(TEXT("GetTopEmote"));
+	static const FName GetHeatmapSizeName(TEXT("GetHeatmapSize"));
+	static const FName GetHeatmapValueName(TEXT("GetHeatmapValue"));
+	static const FName GetNumVoteOptionsName(TEXT("GetNumVoteOptions"));
+	static const FName GetVoteShareName(TEXT("GetVoteShare"));
+
+	// Snapshot read by the VM functions, swapped each system tick
+	struct FInstanceData
+	{
+		FTwitchChatAggregatesPtr Aggregates;
+	};
+}
+
+UNiagaraDataInterfaceTwitchChat::UNiagaraDataInterfaceTwitchChat(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, Source(TEXT("Chat"))
+{
+}
+
+void UNiagaraDataInterfaceTwitchChat::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	if(HasAnyFlags(RF_ClassDefaultObject))
+	{
+		FNiagaraTypeRegistry::Register(FNiagaraTypeDefinition(GetClass()), true, false, false);
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions)
+{
+	auto add_function = [this, &OutFunctions](const FName name, const FText& description) -> FNiagaraFunctionSignature&
+	{
+		FNiagaraFunctionSignature& signature = OutFunctions.AddDefaulted_GetRef();
+		signature.Name = name;
+		signature.bMemberFunction = true;
+		signature.bRequiresContext = false;
+#if WITH_EDITORONLY_DATA
+		signature.Description = description;
+#endif
+		signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition(GetClass()), TEXT("TwitchChat")));
+		return signature;
+	};
+
+	add_function(TwitchChatNiagara::GetMessageRateName, LOCTEXT("GetMessageRate", "Chat messages per second, smoothed"))
+		.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("MessagesPerSecond")));
+
+	add_function(TwitchChatNiagara::GetNewMessagesName, LOCTEXT("GetNewMessages", "Chat messages received this frame"))
+		.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NewMessages")));
+
+	add_function(TwitchChatNiagara::GetNumTopEmotesName, LOCTEXT("GetNumTopEmotes", "Number of top emotes, at most the NumTopEmotes of the IRC component"))
+		.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumTopEmotes")));
+
+	{
+		FNiagaraFunctionSignature& signature = add_function(TwitchChatNiagara::GetTopEmoteName,
+			LOCTEXT("GetTopEmote", "Decayed use count of a top emote, most used first, and its region of the emote atlas (min u, min v, max u, max v)"));
+		signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Index")));
+		signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Count")));
+		signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec4Def(), TEXT("AtlasUV")));
+	}
+
+	add_function(TwitchChatNiagara::GetHeatmapSizeName, LOCTEXT("GetHeatmapSize", "Number of cells on each side of the heatmap"))
+		.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Size")));
+
+	{
+		FNiagaraFunctionSignature& signature = add_function(TwitchChatNiagara::GetHeatmapValueName,
+			LOCTEXT("GetHeatmapValue", "Heat of the heatmap cell at a position from 0 to 1, from 0 to 1 for the hottest cell"));
+		signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetVec2Def(), TEXT("UV")));
+		signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Heat")));
+	}
+
+	add_function(TwitchChatNiagara::GetNumVoteOptionsName, LOCTEXT("GetNumVoteOptions", "Number of options of the poll updated last"))
+		.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("NumOptions")));
+
+	{
+		FNiagaraFunctionSignature& signature = add_function(TwitchChatNiagara::GetVoteShareName,
+			LOCTEXT("GetVoteShare", "Share of the votes of an option of the poll updated last, from 0 to 1"));
+		signature.Inputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetIntDef(), TEXT("Option")));
+		signature.Outputs.Add(FNiagaraVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("Share")));
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc)
+{
+	using FVMFunction = void(UNiagaraDataInterfaceTwitchChat::*)(FVectorVMContext&);
+	struct FBinding
+	{
+		FName Name;
+		int32 NumInputs;
+		int32 NumOutputs;
+		FVMFunction Function;
+	};
+
+	// Inputs and outputs count the registers, a vector takes one per component. Inputs start with the instance data operand.
+	static const FBinding bindings[] =
+	{
+		{ TwitchChatNiagara::GetMessageRateName, 1, 1, &UNiagaraDataInterfaceTwitchChat::GetMessageRate },
+		{ TwitchChatNiagara::GetNewMessagesName, 1, 1, &UNiagaraDataInterfaceTwitchChat::GetNewMessages },
+		{ TwitchChatNiagara::GetNumTopEmotesName, 1, 1, &UNiagaraDataInterfaceTwitchChat::GetNumTopEmotes },
+		{ TwitchChatNiagara::GetTopEmoteName, 2, 5, &UNiagaraDataInterfaceTwitchChat::GetTopEmote },
+		{ TwitchChatNiagara::GetHeatmapSizeName, 1, 1, &UNiagaraDataInterfaceTwitchChat::GetHeatmapSize },
+		{ TwitchChatNiagara::GetHeatmapValueName, 3, 1, &UNiagaraDataInterfaceTwitchChat::GetHeatmapValue },
+		{ TwitchChatNiagara::GetNumVoteOptionsName, 1, 1, &UNiagaraDataInterfaceTwitchChat::GetNumVoteOptions },
+		{ TwitchChatNiagara::GetVoteShareName, 2, 1, &UNiagaraDataInterfaceTwitchChat::GetVoteShare },
+	};
+
+	for(const FBinding& binding : bindings)
+	{
+		if(BindingInfo.Name == binding.Name && BindingInfo.GetNumInputs() == binding.NumInputs && BindingInfo.GetNumOutputs() == binding.NumOutputs)
+		{
+			OutFunc = FVMExternalFunction::CreateUObject(this, binding.Function);
+			return;
+		}
+	}
+}
+
+bool UNiagaraDataInterfaceTwitchChat::InitPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance)
+{
+	new(PerInstanceData) TwitchChatNiagara::FInstanceData();
+	return true;
+}
+
+void UNiagaraDataInterfaceTwitchChat::DestroyPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance)
+{
+	static_cast<TwitchChatNiagara::FInstanceData*>(PerInstanceData)->~FInstanceData();
+}
+
+bool UNiagaraDataInterfaceTwitchChat::PerInstanceTick(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance, float DeltaSeconds)
+{
+	static_cast<TwitchChatNiagara::FInstanceData*>(PerInstanceData)->Aggregates = FTwitchChatAggregator::GetPublished(Source, SystemInstance->GetWorld());
+	return false;
+}
+
+int32 UNiagaraDataInterfaceTwitchChat::PerInstanceDataSize() const
+{
+	return sizeof(TwitchChatNiagara::FInstanceData);
+}
+
+bool UNiagaraDataInterfaceTwitchChat::Equals(const UNiagaraDataInterface* Other) const
+{
+	return Super::Equals(Other) && CastChecked<const UNiagaraDataInterfaceTwitchChat>(Other)->Source == Source;
+}
+
+bool UNiagaraDataInterfaceTwitchChat::CopyToInternal(UNiagaraDataInterface* Destination) const
+{
+	if(!Super::CopyToInternal(Destination))
+	{
+		return false;
+	}
+
+	CastChecked<UNiagaraDataInterfaceTwitchChat>(Destination)->Source = Source;
+	return true;
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetMessageRate(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_rate(Context);
+
+	const float rate = instance_data->Aggregates.IsValid() ? instance_data->Aggregates->MessagesPerSecond : 0.0f;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		*out_rate.GetDestAndAdvance() = rate;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetNewMessages(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncRegisterHandler<int32> out_messages(Context);
+
+	const int32 new_messages = instance_data->Aggregates.IsValid() ? instance_data->Aggregates->NewMessages : 0;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		*out_messages.GetDestAndAdvance() = new_messages;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetNumTopEmotes(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncRegisterHandler<int32> out_num(Context);
+
+	const int32 num_emotes = instance_data->Aggregates.IsValid() ? instance_data->Aggregates->TopEmoteIds.Num() : 0;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		*out_num.GetDestAndAdvance() = num_emotes;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetTopEmote(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncInputHandler<int32> in_index(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_count(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_min_u(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_min_v(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_max_u(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_max_v(Context);
+
+	const FTwitchChatAggregates* aggregates = instance_data->Aggregates.Get();
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		const int32 index = in_index.GetAndAdvance();
+		const bool b_valid = aggregates != nullptr && aggregates->TopEmoteCounts.IsValidIndex(index);
+		const FVector4 uv = b_valid ? aggregates->TopEmoteUVs[index] : FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+		*out_count.GetDestAndAdvance() = b_valid ? aggregates->TopEmoteCounts[index] : 0.0f;
+		*out_min_u.GetDestAndAdvance() = uv.X;
+		*out_min_v.GetDestAndAdvance() = uv.Y;
+		*out_max_u.GetDestAndAdvance() = uv.Z;
+		*out_max_v.GetDestAndAdvance() = uv.W;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetHeatmapSize(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncRegisterHandler<int32> out_size(Context);
+
+	const int32 size = instance_data->Aggregates.IsValid() ? instance_data->Aggregates->HeatmapSize : 0;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		*out_size.GetDestAndAdvance() = size;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetHeatmapValue(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncInputHandler<float> in_u(Context);
+	VectorVM::FExternalFuncInputHandler<float> in_v(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_heat(Context);
+
+	const FTwitchChatAggregates* aggregates = instance_data->Aggregates.Get();
+	const int32 size = aggregates != nullptr ? aggregates->HeatmapSize : 0;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		const float u = in_u.GetAndAdvance();
+		const float v = in_v.GetAndAdvance();
+		float heat = 0.0f;
+		if(size > 0)
+		{
+			const int32 cell_x = FMath::Clamp(FMath::FloorToInt(u * size), 0, size - 1);
+			const int32 cell_y = FMath::Clamp(FMath::FloorToInt(v * size), 0, size - 1);
+			heat = aggregates->Heatmap[cell_y * size + cell_x];
+		}
+		*out_heat.GetDestAndAdvance() = heat;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetNumVoteOptions(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncRegisterHandler<int32> out_num(Context);
+
+	const int32 num_options = instance_data->Aggregates.IsValid() ? instance_data->Aggregates->VoteShares.Num() : 0;
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		*out_num.GetDestAndAdvance() = num_options;
+	}
+}
+
+void UNiagaraDataInterfaceTwitchChat::GetVoteShare(FVectorVMContext& Context)
+{
+	VectorVM::FUserPtrHandler<TwitchChatNiagara::FInstanceData> instance_data(Context);
+	VectorVM::FExternalFuncInputHandler<int32> in_option(Context);
+	VectorVM::FExternalFuncRegisterHandler<float> out_share(Context);
+
+	const FTwitchChatAggregates* aggregates = instance_data->Aggregates.Get();
+	for(int32 instance = 0; instance < Context.NumInstances; ++instance)
+	{
+		const int32 option = in_option.GetAndAdvance();
+		*out_share.GetDestAndAdvance() = aggregates != nullptr && aggregates->VoteShares.IsValidIndex(option) ? aggregates->VoteShares[option] : 0.0f;
+	}
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,56 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NiagaraDataInterface.h"
+#include "Chat/TwitchChatAggregator.h"
+#include "NiagaraDataInterfaceTwitchChat.generated.h"
+
+/**
+ * Reads the chat aggregates published by an IRC component (message rate, top emotes, heatmap, vote shares) into particle systems.
+ * The snapshot is picked up once per system tick, so particles scale with chat without any per-message work.
+ * CPU simulations only.
+ */
+UCLASS(EditInlineNew, Category = "TwitchPlay", meta = (DisplayName = "Twitch Chat"))
+class TWITCHPLAYNIAGARA_API UNiagaraDataInterfaceTwitchChat : public UNiagaraDataInterface
+{
+	GENERATED_UCLASS_BODY()
+
+public:
+
+	// AggregatesName of the IRC component to read from
+	UPROPERTY(EditAnywhere, Category = "Twitch Chat")
+	FName Source;
+
+	//
+	// UObject interface.
+	//
+	virtual void PostInitProperties() override;
+
+	//
+	// UNiagaraDataInterface interface.
+	//
+	virtual void GetFunctions(TArray<FNiagaraFunctionSignature>& OutFunctions) override;
+	virtual void GetVMExternalFunction(const FVMExternalFunctionBindingInfo& BindingInfo, void* InstanceData, FVMExternalFunction& OutFunc) override;
+	virtual bool CanExecuteOnTarget(ENiagaraSimTarget Target) const override { return Target == ENiagaraSimTarget::CPUSim; }
+	virtual bool InitPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance) override;
+	virtual void DestroyPerInstanceData(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance) override;
+	virtual bool PerInstanceTick(void* PerInstanceData, FNiagaraSystemInstance* SystemInstance, float DeltaSeconds) override;
+	virtual int32 PerInstanceDataSize() const override;
+	virtual bool Equals(const UNiagaraDataInterface* Other) const override;
+
+	// VM functions
+	void GetMessageRate(FVectorVMContext& Context);
+	void GetNewMessages(FVectorVMContext& Context);
+	void GetNumTopEmotes(FVectorVMContext& Context);
+	void GetTopEmote(FVectorVMContext& Context);
+	void GetHeatmapSize(FVectorVMContext& Context);
+	void GetHeatmapValue(FVectorVMContext& Context);
+	void GetNumVoteOptions(FVectorVMContext& Context);
+	void GetVoteShare(FVectorVMContext& Context);
+
+protected:
+
+	virtual bool CopyToInternal(UNiagaraDataInterface* Destination) const override;
+};
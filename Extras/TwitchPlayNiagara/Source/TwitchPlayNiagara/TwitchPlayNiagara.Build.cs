@@ -0,0 +1,34 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+using UnrealBuildTool;
+using System.IO;
+
+public class TwitchPlayNiagara : ModuleRules
+{
+	public TwitchPlayNiagara(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "Public"));
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private"));
+
+		PublicDependencyModuleNames.AddRange(
+			 new string[]
+			 {
+					 "Core",
+					 "CoreUObject",
+					 "Engine",
+					 "Niagara",
+					 "TwitchPlay",
+			 }
+			 );
+
+		PrivateDependencyModuleNames.AddRange(
+			 new string[]
+			 {
+				 "NiagaraCore",
+				 "VectorVM",
+			 }
+			 );
+	}
+}
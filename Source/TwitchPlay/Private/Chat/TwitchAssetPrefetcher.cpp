@@ -0,0 +1,131 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchAssetPrefetcher.h"
+#include "Async/Async.h"
+
+FTwitchAssetPrefetcher::FTwitchAssetPrefetcher(const float retainSeconds)
+	: RetainSeconds(retainSeconds)
+{
+}
+
+TSharedRef<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> FTwitchAssetPrefetcher::Create(const float retainSeconds)
+{
+	return TSharedRef<FTwitchAssetPrefetcher, ESPMode::ThreadSafe>(new FTwitchAssetPrefetcher(retainSeconds), [](FTwitchAssetPrefetcher* prefetcher)
+	{
+		if(IsInGameThread())
+		{
+			delete prefetcher;
+		}
+		else
+		{
+			AsyncTask(ENamedThreads::GameThread, [prefetcher]()
+			{
+				delete prefetcher;
+			});
+		}
+	});
+}
+
+FTwitchAssetPrefetcher::~FTwitchAssetPrefetcher()
+{
+	check(IsInGameThread());
+
+	for(TPair<FSoftObjectPath, FPrefetchedAsset>& asset : Assets)
+	{
+		if(asset.Value.Handle.IsValid())
+		{
+			asset.Value.Handle->ReleaseHandle();
+		}
+	}
+}
+
+void FTwitchAssetPrefetcher::RequestFromAnyThread(const TArray<FSoftObjectPath>& assets)
+{
+	// Chat spams the same commands, only go to the game thread for assets that weren't requested lately
+	TArray<FSoftObjectPath> new_assets;
+	{
+		const double now = FPlatformTime::Seconds();
+		FScopeLock lock(&AssetsLock);
+		for(const FSoftObjectPath& asset : assets)
+		{
+			if(asset.IsNull())
+			{
+				continue;
+			}
+
+			FPrefetchedAsset* prefetched = Assets.Find(asset);
+			if(prefetched == nullptr)
+			{
+				prefetched = &Assets.Add(asset);
+				new_assets.Add(asset);
+			}
+			prefetched->LastRequestTime = now;
+		}
+	}
+
+	if(new_assets.Num() == 0)
+	{
+		return;
+	}
+
+	if(IsInGameThread())
+	{
+		StartStreaming(new_assets);
+	}
+	else
+	{
+		TWeakPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> weakThis = AsShared();
+		AsyncTask(ENamedThreads::GameThread, [weakThis, new_assets]()
+		{
+			if(FTwitchAssetPrefetcherPtr prefetcher = weakThis.Pin())
+			{
+				prefetcher->StartStreaming(new_assets);
+			}
+		});
+	}
+}
+
+void FTwitchAssetPrefetcher::StartStreaming(const TArray<FSoftObjectPath>& assets)
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FStreamableHandle> handle = StreamableManager.RequestAsyncLoad(assets, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+
+	FScopeLock lock(&AssetsLock);
+	for(const FSoftObjectPath& asset : assets)
+	{
+		// Might have been released in between
+		if(FPrefetchedAsset* prefetched = Assets.Find(asset))
+		{
+			prefetched->Handle = handle;
+		}
+	}
+}
+
+void FTwitchAssetPrefetcher::ReleaseUnused()
+{
+	check(IsInGameThread());
+
+	const double expire_time = FPlatformTime::Seconds() - RetainSeconds;
+	TArray<TSharedPtr<FStreamableHandle>> released;
+	{
+		FScopeLock lock(&AssetsLock);
+		for(auto it = Assets.CreateIterator(); it; ++it)
+		{
+			if(it->Value.LastRequestTime < expire_time)
+			{
+				released.AddUnique(it->Value.Handle);
+				it.RemoveCurrent();
+			}
+		}
+	}
+
+	// A handle may be shared by several assets that were requested together, release it when none of them uses it anymore
+	for(const TSharedPtr<FStreamableHandle>& handle : released)
+	{
+		if(handle.IsValid() && handle.GetSharedReferenceCount() == 1)
+		{
+			handle->ReleaseHandle();
+		}
+	}
+}
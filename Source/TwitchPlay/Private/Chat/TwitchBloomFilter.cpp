@@ -0,0 +1,70 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchBloomFilter.h"
+
+namespace
+{
+	// SplitMix64 finalizer, spreads user ids (which are sequential numbers) over the whole range
+	uint64 MixUserKey(uint64 key)
+	{
+		key ^= key >> 30;
+		key *= 0xbf58476d1ce4e5b9ull;
+		key ^= key >> 27;
+		key *= 0x94d049bb133111ebull;
+		key ^= key >> 31;
+		return key;
+	}
+}
+
+FTwitchBloomFilter::FTwitchBloomFilter(const int32 expectedKeys, const double falsePositiveRate)
+	: Mask(0)
+	, NumHashes(1)
+{
+	// Optimal Bloom filter size is -n*ln(p)/ln(2)^2 bits with (bits/n)*ln(2) hashes, rounded up to a power of two for masking
+	const double num_keys = FMath::Max(expectedKeys, 1);
+	const double optimal_bits = -num_keys * FMath::Loge(FMath::Clamp(falsePositiveRate, 1e-6, 0.5)) / FMath::Square(FMath::Loge(2.0));
+	const uint64 num_bits = FMath::Max<uint64>(FMath::RoundUpToPowerOfTwo64(static_cast<uint64>(optimal_bits)), 64);
+	Mask = num_bits - 1;
+	NumHashes = FMath::Clamp(FMath::RoundToInt(static_cast<double>(num_bits) / num_keys * FMath::Loge(2.0)), 1, 16);
+
+	Bits.SetNumZeroed(static_cast<int32>(num_bits / 64));
+}
+
+bool FTwitchBloomFilter::Add(const uint64 key)
+{
+	// Double hashing, h1 + i*h2
+	const uint64 h1 = MixUserKey(key);
+	const uint64 h2 = MixUserKey(h1) | 1;
+	bool b_was_set = true;
+	for(int32 i = 0; i < NumHashes; ++i)
+	{
+		const uint64 bit = (h1 + i * h2) & Mask;
+		uint64& word = Bits[bit >> 6];
+		const uint64 bit_mask = 1ull << (bit & 63);
+		b_was_set &= (word & bit_mask) != 0;
+		word |= bit_mask;
+	}
+
+	return b_was_set;
+}
+
+bool FTwitchBloomFilter::MayContain(const uint64 key) const
+{
+	const uint64 h1 = MixUserKey(key);
+	const uint64 h2 = MixUserKey(h1) | 1;
+	for(int32 i = 0; i < NumHashes; ++i)
+	{
+		const uint64 bit = (h1 + i * h2) & Mask;
+		if((Bits[bit >> 6] & (1ull << (bit & 63))) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FTwitchBloomFilter::Reset()
+{
+	FMemory::Memzero(Bits.GetData(), Bits.Num() * sizeof(uint64));
+}
@@ -0,0 +1,263 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatAggregator.h"
+#include "Chat/TwitchChatDisplay.h"
+
+// Decayed counts below this are dropped
+static constexpr float TwitchAggregateMinCount = 0.01f;
+
+namespace
+{
+	// A snapshot and who published it. The pointers only identify the owner and world, they are never dereferenced.
+	struct FPublishedSnapshot
+	{
+		const UObject* Owner = nullptr;
+		const UWorld* World = nullptr;
+		FTwitchChatAggregatesPtr Aggregates;
+	};
+
+	// Published snapshots by name
+	struct FPublishedAggregates
+	{
+		TMap<FName, TArray<FPublishedSnapshot>> Snapshots;
+		FCriticalSection Lock;
+	};
+
+	FPublishedAggregates& GetPublishedAggregates()
+	{
+		static FPublishedAggregates published;
+		return published;
+	}
+}
+
+FTwitchChatAggregator::FTwitchChatAggregator(const FString& heatmapCommand, const int32 heatmapSize, const int32 numTopEmotes, const float halfLifeSeconds)
+	: HeatmapCommand(heatmapCommand)
+	, HeatmapSize(FMath::Max(heatmapSize, 0))
+	, NumTopEmotes(FMath::Max(numTopEmotes, 0))
+	, HalfLifeSeconds(FMath::Max(halfLifeSeconds, 0.01f))
+	, PendingMessages(0)
+	, CommandDelimiter(TEXT("!"))
+	, OptionsDelimiter(TEXT("#"))
+	, MessagesPerSecond(0.0f)
+{
+	PendingHeat.SetNumZeroed(HeatmapSize * HeatmapSize);
+	Heat.SetNumZeroed(HeatmapSize * HeatmapSize);
+}
+
+void FTwitchChatAggregator::SetDelimiters(const FString& commandDelimiter, const FString& optionsDelimiter)
+{
+	FScopeLock lock(&Lock);
+	CommandDelimiter = commandDelimiter;
+	OptionsDelimiter = optionsDelimiter;
+}
+
+void FTwitchChatAggregator::SetVoteTallies(const TArray<float>& tallies)
+{
+	float total = 0.0f;
+	for(const float tally : tallies)
+	{
+		total += FMath::Max(tally, 0.0f);
+	}
+
+	VoteShares.SetNumUninitialized(tallies.Num());
+	for(int32 index = 0; index < tallies.Num(); ++index)
+	{
+		VoteShares[index] = total > 0.0f ? FMath::Max(tallies[index], 0.0f) / total : 0.0f;
+	}
+}
+
+int32 FTwitchChatAggregator::GetHeatmapCell(const FTwitchChatMessage& message) const
+{
+	if(HeatmapSize == 0 || HeatmapCommand.IsEmpty() || message.bCommandRejected)
+	{
+		return INDEX_NONE;
+	}
+
+	FString x, y;
+	if(!message.Command.IsEmpty())
+	{
+		if(message.Command != HeatmapCommand || message.Options.Num() < 2)
+		{
+			return INDEX_NONE;
+		}
+		x = message.Options[0];
+		y = message.Options[1];
+	}
+	else if(FTwitchCommandRules::GetDelimitedString(message.Message, CommandDelimiter) != HeatmapCommand
+		|| !FTwitchCommandRules::GetDelimitedString(message.Message, OptionsDelimiter).Split(TEXT(","), &x, &y))
+	{
+		return INDEX_NONE;
+	}
+
+	const float u = FCString::Atof(*x);
+	const float v = FCString::Atof(*y);
+	if(!(u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f))
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 cell_x = FMath::Min(FMath::FloorToInt(u * HeatmapSize), HeatmapSize - 1);
+	const int32 cell_y = FMath::Min(FMath::FloorToInt(v * HeatmapSize), HeatmapSize - 1);
+	return cell_y * HeatmapSize + cell_x;
+}
+
+void FTwitchChatAggregator::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	FScopeLock lock(&Lock);
+	for(const FTwitchChatMessage& message : messages)
+	{
+		++PendingMessages;
+
+		if(message.Display.IsValid())
+		{
+			for(const FTwitchDisplayRun& run : message.Display->Runs)
+			{
+				if(run.Type == ETwitchDisplayRunType::EMOTE)
+				{
+					++PendingEmotes.FindOrAdd(run.EmoteId);
+				}
+			}
+		}
+
+		const int32 cell = GetHeatmapCell(message);
+		if(cell != INDEX_NONE)
+		{
+			++PendingHeat[cell];
+		}
+	}
+}
+
+TSharedRef<FTwitchChatAggregates, ESPMode::ThreadSafe> FTwitchChatAggregator::TakeSnapshot(const float deltaSeconds)
+{
+	int32 new_messages;
+	TMap<FString, int32> new_emotes;
+	{
+		FScopeLock lock(&Lock);
+		new_messages = PendingMessages;
+		PendingMessages = 0;
+		new_emotes = MoveTemp(PendingEmotes);
+		PendingEmotes.Reset();
+		for(int32 cell = 0; cell < Heat.Num(); ++cell)
+		{
+			Heat[cell] += PendingHeat[cell];
+		}
+		FMemory::Memzero(PendingHeat.GetData(), PendingHeat.Num() * sizeof(int32));
+	}
+
+	// Everything decays at the same rate, so the snapshot doesn't depend on the frame rate
+	const float delta_seconds = FMath::Max(deltaSeconds, KINDA_SMALL_NUMBER);
+	const float decay = FMath::Pow(0.5f, delta_seconds / HalfLifeSeconds);
+	MessagesPerSecond = MessagesPerSecond * decay + (new_messages / delta_seconds) * (1.0f - decay);
+
+	TSharedRef<FTwitchChatAggregates, ESPMode::ThreadSafe> snapshot = MakeShared<FTwitchChatAggregates, ESPMode::ThreadSafe>();
+	snapshot->MessagesPerSecond = MessagesPerSecond;
+	snapshot->NewMessages = new_messages;
+
+	for(auto it = EmoteCounts.CreateIterator(); it; ++it)
+	{
+		it->Value *= decay;
+		if(it->Value < TwitchAggregateMinCount)
+		{
+			it.RemoveCurrent();
+		}
+	}
+	for(const TPair<FString, int32>& emote : new_emotes)
+	{
+		EmoteCounts.FindOrAdd(emote.Key) += emote.Value;
+	}
+
+	// Only a handful of top emotes, keep them sorted while walking the counts
+	TArray<TPair<float, const FString*>, TInlineAllocator<16>> top_emotes;
+	for(const TPair<FString, float>& emote : EmoteCounts)
+	{
+		if(top_emotes.Num() == NumTopEmotes && (NumTopEmotes == 0 || emote.Value <= top_emotes.Last().Key))
+		{
+			continue;
+		}
+
+		int32 index = top_emotes.Num();
+		while(index > 0 && top_emotes[index - 1].Key < emote.Value)
+		{
+			--index;
+		}
+		top_emotes.Insert(TPair<float, const FString*>(emote.Value, &emote.Key), index);
+		if(top_emotes.Num() > NumTopEmotes)
+		{
+			top_emotes.Pop(false);
+		}
+	}
+	for(const TPair<float, const FString*>& emote : top_emotes)
+	{
+		snapshot->TopEmoteIds.Add(*emote.Value);
+		snapshot->TopEmoteCounts.Add(emote.Key);
+	}
+	snapshot->TopEmoteUVs.SetNumZeroed(top_emotes.Num());
+
+	float hottest = 0.0f;
+	for(float& heat : Heat)
+	{
+		heat = heat * decay < TwitchAggregateMinCount ? 0.0f : heat * decay;
+		hottest = FMath::Max(hottest, heat);
+	}
+	snapshot->HeatmapSize = HeatmapSize;
+	snapshot->Heatmap.SetNumUninitialized(Heat.Num());
+	for(int32 cell = 0; cell < Heat.Num(); ++cell)
+	{
+		snapshot->Heatmap[cell] = hottest > 0.0f ? Heat[cell] / hottest : 0.0f;
+	}
+
+	snapshot->VoteShares = VoteShares;
+	return snapshot;
+}
+
+void FTwitchChatAggregator::Publish(const FName name, const UObject* owner, const UWorld* world, const FTwitchChatAggregatesPtr& aggregates)
+{
+	FPublishedAggregates& published = GetPublishedAggregates();
+	FScopeLock lock(&published.Lock);
+	TArray<FPublishedSnapshot>& snapshots = published.Snapshots.FindOrAdd(name);
+	FPublishedSnapshot* snapshot = snapshots.FindByPredicate([owner](const FPublishedSnapshot& entry)
+	{
+		return entry.Owner == owner;
+	});
+	if(snapshot == nullptr)
+	{
+		snapshot = &snapshots.AddDefaulted_GetRef();
+		snapshot->Owner = owner;
+	}
+	snapshot->World = world;
+	snapshot->Aggregates = aggregates;
+}
+
+void FTwitchChatAggregator::Unpublish(const FName name, const UObject* owner)
+{
+	FPublishedAggregates& published = GetPublishedAggregates();
+	FScopeLock lock(&published.Lock);
+	if(TArray<FPublishedSnapshot>* snapshots = published.Snapshots.Find(name))
+	{
+		snapshots->RemoveAll([owner](const FPublishedSnapshot& entry)
+		{
+			return entry.Owner == owner;
+		});
+		if(snapshots->Num() == 0)
+		{
+			published.Snapshots.Remove(name);
+		}
+	}
+}
+
+FTwitchChatAggregatesPtr FTwitchChatAggregator::GetPublished(const FName name, const UWorld* world)
+{
+	FPublishedAggregates& published = GetPublishedAggregates();
+	FScopeLock lock(&published.Lock);
+	const TArray<FPublishedSnapshot>* snapshots = published.Snapshots.Find(name);
+	if(snapshots == nullptr || snapshots->Num() == 0)
+	{
+		return nullptr;
+	}
+
+	const FPublishedSnapshot* snapshot = snapshots->FindByPredicate([world](const FPublishedSnapshot& entry)
+	{
+		return entry.World == world;
+	});
+	return snapshot != nullptr ? snapshot->Aggregates : snapshots->Last().Aggregates;
+}
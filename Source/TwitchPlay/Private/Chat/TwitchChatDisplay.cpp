@@ -0,0 +1,140 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatDisplay.h"
+
+namespace
+{
+	struct FEmoteRange
+	{
+		int32 First;
+		int32 Last;
+		int32 IdStart;
+		int32 IdLength;
+	};
+
+	// Parses a non-negative integer, advancing the index. Returns INDEX_NONE if there are no digits.
+	int32 ParseIndex(const FString& text, int32& indexInOut)
+	{
+		int32 value = INDEX_NONE;
+		while(indexInOut < text.Len() && FChar::IsDigit(text[indexInOut]))
+		{
+			value = FMath::Max(value, 0) * 10 + (text[indexInOut] - TEXT('0'));
+			++indexInOut;
+		}
+		return value;
+	}
+}
+
+void FTwitchChatDisplayLine::BuildRuns(const FString& message, const FString& emotesTag, TArray<FTwitchDisplayRun>& runsOut)
+{
+	runsOut.Reset();
+
+	// "id:first-last,first-last/id:first-last", positions are inclusive
+	TArray<FEmoteRange, TInlineAllocator<16>> ranges;
+	int32 index = 0;
+	while(index < emotesTag.Len())
+	{
+		const int32 id_start = index;
+		const int32 id_end = emotesTag.Find(TEXT(":"), ESearchCase::CaseSensitive, ESearchDir::FromStart, index);
+		if(id_end == INDEX_NONE)
+		{
+			break;
+		}
+
+		index = id_end + 1;
+		while(index < emotesTag.Len() && emotesTag[index] != TEXT('/'))
+		{
+			const int32 first = ParseIndex(emotesTag, index);
+			const bool b_has_dash = index < emotesTag.Len() && emotesTag[index] == TEXT('-');
+			index += b_has_dash ? 1 : 0;
+			const int32 last = b_has_dash ? ParseIndex(emotesTag, index) : INDEX_NONE;
+			if(first != INDEX_NONE && last >= first)
+			{
+				ranges.Add(FEmoteRange { first, last, id_start, id_end - id_start });
+			}
+
+			// Skip to the next range, or to the next emote
+			while(index < emotesTag.Len() && emotesTag[index] != TEXT(',') && emotesTag[index] != TEXT('/'))
+			{
+				++index;
+			}
+			index += (index < emotesTag.Len() && emotesTag[index] == TEXT(',')) ? 1 : 0;
+		}
+		++index;
+	}
+
+	ranges.Sort([](const FEmoteRange& a, const FEmoteRange& b)
+	{
+		return a.First < b.First;
+	});
+
+	// Code point to character positions. Only differs from the identity when the message has surrogate pairs.
+	TArray<int32> char_positions;
+	const TCHAR* chars = *message;
+	const int32 len = message.Len();
+	if(sizeof(TCHAR) == 2)
+	{
+		for(int32 char_index = 0; char_index < len; ++char_index)
+		{
+			if(StringConv::IsHighSurrogate(chars[char_index]) && char_index + 1 < len && StringConv::IsLowSurrogate(chars[char_index + 1]))
+			{
+				if(char_positions.Num() == 0)
+				{
+					char_positions.Reserve(len + 1);
+					for(int32 previous = 0; previous < char_index; ++previous)
+					{
+						char_positions.Add(previous);
+					}
+				}
+				char_positions.Add(char_index++);
+			}
+			else if(char_positions.Num() > 0)
+			{
+				char_positions.Add(char_index);
+			}
+		}
+		if(char_positions.Num() > 0)
+		{
+			char_positions.Add(len);
+		}
+	}
+
+	const int32 num_code_points = char_positions.Num() > 0 ? char_positions.Num() - 1 : len;
+	auto to_char_position = [&char_positions](const int32 codePoint)
+	{
+		return char_positions.Num() > 0 ? char_positions[codePoint] : codePoint;
+	};
+
+	auto add_run = [&runsOut](const ETwitchDisplayRunType type, const int32 start, const int32 length) -> FTwitchDisplayRun&
+	{
+		FTwitchDisplayRun& run = runsOut.AddDefaulted_GetRef();
+		run.Type = type;
+		run.Start = start;
+		run.Length = length;
+		return run;
+	};
+
+	int32 text_start = 0;
+	for(const FEmoteRange& range : ranges)
+	{
+		// Overlapping or past the end of the message
+		if(range.Last >= num_code_points || to_char_position(range.First) < text_start)
+		{
+			continue;
+		}
+
+		const int32 emote_start = to_char_position(range.First);
+		const int32 emote_end = to_char_position(range.Last + 1);
+		if(emote_start > text_start)
+		{
+			add_run(ETwitchDisplayRunType::TEXT, text_start, emote_start - text_start);
+		}
+		add_run(ETwitchDisplayRunType::EMOTE, emote_start, emote_end - emote_start).EmoteId = emotesTag.Mid(range.IdStart, range.IdLength);
+		text_start = emote_end;
+	}
+
+	if(text_start < len)
+	{
+		add_run(ETwitchDisplayRunType::TEXT, text_start, len - text_start);
+	}
+}
@@ -0,0 +1,151 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatHistory.h"
+#include "Chat/TwitchChatIndex.h"
+
+FTwitchChatHistory::FTwitchChatHistory(const int32 capacity, const bool bIndexed)
+	: NewestId(0)
+{
+	Records.SetNum(FMath::Max(capacity, 1));
+	if(bIndexed)
+	{
+		Index = MakeUnique<FTwitchChatIndex>(*this);
+	}
+}
+
+FTwitchChatHistory::~FTwitchChatHistory()
+{
+	// The index thread reads the records, stop it first
+	Index.Reset();
+}
+
+void FTwitchChatHistory::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	if(messages.Num() == 0)
+	{
+		return;
+	}
+
+	const FDateTime received_at = FDateTime::UtcNow();
+	{
+		FRWScopeLock lock(Lock, SLT_Write);
+		for(const FTwitchChatMessage& message : messages)
+		{
+			const uint64 record_id = ++NewestId;
+			FTwitchChatHistoryEntry& record = Records[record_id % Records.Num()];
+			record.RecordId = static_cast<int64>(record_id);
+			record.Username = message.Username;
+			record.Message = message.Message;
+			record.Roles = static_cast<int32>(message.Roles);
+			record.ReceivedAt = received_at;
+			record.Display = message.Display;
+		}
+	}
+
+	if(Index.IsValid())
+	{
+		Index->NotifyAppended();
+	}
+}
+
+uint64 FTwitchChatHistory::GetOldestIdLocked() const
+{
+	const uint64 capacity = Records.Num();
+	return NewestId == 0 ? 0 : (NewestId > capacity ? NewestId - capacity + 1 : 1);
+}
+
+uint64 FTwitchChatHistory::GetOldestId() const
+{
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+	return GetOldestIdLocked();
+}
+
+uint64 FTwitchChatHistory::GetNewestId() const
+{
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+	return NewestId;
+}
+
+bool FTwitchChatHistory::GetRecord(const uint64 recordId, FTwitchChatHistoryEntry& recordOut) const
+{
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+	if(recordId == 0 || recordId > NewestId || recordId < GetOldestIdLocked())
+	{
+		return false;
+	}
+
+	recordOut = Records[recordId % Records.Num()];
+	return true;
+}
+
+void FTwitchChatHistory::GetRecords(const uint64 firstId, const int32 count, TArray<FTwitchChatHistoryEntry>& recordsOut) const
+{
+	recordsOut.Reset();
+
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+	const uint64 first_id = FMath::Max(firstId, GetOldestIdLocked());
+	if(first_id == 0 || count <= 0)
+	{
+		return;
+	}
+
+	for(uint64 record_id = first_id; record_id <= NewestId && recordsOut.Num() < count; ++record_id)
+	{
+		recordsOut.Add(Records[record_id % Records.Num()]);
+	}
+}
+
+void FTwitchChatHistory::Search(const FString& text, const FString& username, const int32 maxResults, TArray<FTwitchChatHistoryEntry>& resultsOut) const
+{
+	resultsOut.Reset();
+
+	TArray<FString> tokens;
+	FTwitchChatIndex::Tokenize(text, tokens);
+	if(!username.IsEmpty())
+	{
+		tokens.Add(FTwitchChatIndex::MakeSenderToken(username));
+	}
+
+	if(tokens.Num() == 0 || maxResults <= 0)
+	{
+		return;
+	}
+
+	if(Index.IsValid())
+	{
+		TArray<uint64> record_ids;
+		Index->Find(tokens, GetOldestId(), maxResults, record_ids);
+
+		// Records may have been overwritten in between
+		FRWScopeLock lock(Lock, SLT_ReadOnly);
+		const uint64 oldest_id = GetOldestIdLocked();
+		for(const uint64 record_id : record_ids)
+		{
+			if(record_id >= oldest_id && record_id <= NewestId)
+			{
+				resultsOut.Add(Records[record_id % Records.Num()]);
+			}
+		}
+		return;
+	}
+
+	// No index, tokenize the whole ring from the newest record
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+	const uint64 oldest_id = GetOldestIdLocked();
+	TArray<FString> record_tokens;
+	for(uint64 record_id = NewestId; record_id >= oldest_id && record_id > 0 && resultsOut.Num() < maxResults; --record_id)
+	{
+		const FTwitchChatHistoryEntry& record = Records[record_id % Records.Num()];
+		FTwitchChatIndex::Tokenize(record.Message, record_tokens);
+		record_tokens.Add(FTwitchChatIndex::MakeSenderToken(record.Username));
+
+		const bool b_matches = !tokens.ContainsByPredicate([&record_tokens](const FString& token)
+		{
+			return !record_tokens.Contains(token);
+		});
+		if(b_matches)
+		{
+			resultsOut.Add(record);
+		}
+	}
+}
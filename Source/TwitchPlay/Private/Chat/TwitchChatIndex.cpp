@@ -0,0 +1,225 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatIndex.h"
+#include "Chat/TwitchChatHistory.h"
+#include "Algo/BinarySearch.h"
+
+// Records indexed per batch, the index lock is released in between so searches are never held for long
+static constexpr int32 TwitchIndexBatchSize = 1024;
+
+// Posting lists visited by each pruning sweep
+static constexpr int32 TwitchIndexPruneLists = 4096;
+
+// Longest token indexed, longer words are cut
+static constexpr int32 TwitchIndexMaxTokenLength = 32;
+
+FTwitchChatIndex::FTwitchChatIndex(const FTwitchChatHistory& history)
+	: History(history)
+	, PruneCursor(0)
+	, LastIndexedId(0)
+	, WorkEvent(FPlatformProcess::GetSynchEventFromPool(false))
+	, Thread(nullptr)
+	, bShouldExit(false)
+{
+	Thread = FRunnableThread::Create(this, TEXT("FTwitchChatIndex"), 0, TPri_BelowNormal);
+}
+
+FTwitchChatIndex::~FTwitchChatIndex()
+{
+	if(Thread != nullptr)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	WorkEvent = nullptr;
+}
+
+void FTwitchChatIndex::NotifyAppended()
+{
+	WorkEvent->Trigger();
+}
+
+void FTwitchChatIndex::Stop()
+{
+	bShouldExit = true;
+	WorkEvent->Trigger();
+}
+
+uint32 FTwitchChatIndex::Run()
+{
+	while(!bShouldExit)
+	{
+		// Also wake up once in a while, pruning keeps going while chat is quiet
+		WorkEvent->Wait(FTimespan::FromSeconds(1.0));
+		if(bShouldExit)
+		{
+			break;
+		}
+
+		IndexNewRecords();
+		Prune(History.GetOldestId(), TwitchIndexPruneLists);
+	}
+
+	return 0;
+}
+
+void FTwitchChatIndex::Tokenize(const FString& text, TArray<FString>& tokensOut)
+{
+	tokensOut.Reset();
+
+	FString token;
+	const int32 len = text.Len();
+	for(int32 index = 0; index <= len; ++index)
+	{
+		const TCHAR character = index < len ? text[index] : TEXT(' ');
+		if(FChar::IsAlnum(character) || character == TEXT('_'))
+		{
+			if(token.Len() < TwitchIndexMaxTokenLength)
+			{
+				token.AppendChar(FChar::ToLower(character));
+			}
+		}
+		else if(token.Len() > 0)
+		{
+			tokensOut.AddUnique(token);
+			token.Reset();
+		}
+	}
+}
+
+void FTwitchChatIndex::IndexNewRecords()
+{
+	TArray<FTwitchChatHistoryEntry> records;
+	TArray<FString> tokens;
+	while(!bShouldExit)
+	{
+		History.GetRecords(LastIndexedId + 1, TwitchIndexBatchSize, records);
+		if(records.Num() == 0)
+		{
+			break;
+		}
+
+		// Tokenize outside of the lock
+		TArray<TPair<uint64, TArray<FString>>> indexed_records;
+		indexed_records.Reserve(records.Num());
+		for(const FTwitchChatHistoryEntry& record : records)
+		{
+			Tokenize(record.Message, tokens);
+			tokens.Add(MakeSenderToken(record.Username));
+			indexed_records.Emplace(static_cast<uint64>(record.RecordId), MoveTemp(tokens));
+		}
+		LastIndexedId = static_cast<uint64>(records.Last().RecordId);
+
+		FRWScopeLock lock(Lock, SLT_Write);
+		for(const TPair<uint64, TArray<FString>>& record : indexed_records)
+		{
+			for(const FString& token : record.Value)
+			{
+				int32 list_index;
+				if(const int32* existing = TokenLists.Find(token))
+				{
+					list_index = *existing;
+				}
+				else
+				{
+					list_index = FreePostings.Num() > 0 ? FreePostings.Pop(false) : Postings.AddDefaulted();
+					Postings[list_index].Token = token;
+					TokenLists.Add(token, list_index);
+				}
+
+				// Records come in id order, lists stay sorted
+				Postings[list_index].Ids.Add(record.Key);
+			}
+		}
+	}
+}
+
+void FTwitchChatIndex::Prune(const uint64 oldestId, const int32 maxLists)
+{
+	if(Postings.Num() == 0)
+	{
+		return;
+	}
+
+	FRWScopeLock lock(Lock, SLT_Write);
+	for(int32 visited = 0; visited < maxLists && visited < Postings.Num(); ++visited)
+	{
+		PruneCursor = (PruneCursor + 1) % Postings.Num();
+		FPostingList& list = Postings[PruneCursor];
+		if(list.Token.IsEmpty())
+		{
+			// Free list
+			continue;
+		}
+
+		while(list.Head < list.Ids.Num() && list.Ids[list.Head] < oldestId)
+		{
+			++list.Head;
+		}
+
+		if(list.Head == list.Ids.Num())
+		{
+			// Every record of the token fell out of the history
+			TokenLists.Remove(list.Token);
+			list.Token.Empty();
+			list.Ids.Empty();
+			list.Head = 0;
+			FreePostings.Add(PruneCursor);
+		}
+		else if(list.Head > 64 && list.Head * 2 > list.Ids.Num())
+		{
+			list.Ids.RemoveAt(0, list.Head, false);
+			list.Head = 0;
+		}
+	}
+}
+
+void FTwitchChatIndex::Find(const TArray<FString>& tokens, const uint64 oldestId, const int32 maxResults, TArray<uint64>& recordIdsOut) const
+{
+	recordIdsOut.Reset();
+
+	FRWScopeLock lock(Lock, SLT_ReadOnly);
+
+	// Walk the shortest list and look the ids up in the others
+	TArray<TArrayView<const uint64>, TInlineAllocator<8>> lists;
+	for(const FString& token : tokens)
+	{
+		const int32* list_index = TokenLists.Find(token);
+		if(list_index == nullptr)
+		{
+			return;
+		}
+
+		const FPostingList& list = Postings[*list_index];
+		lists.Add(TArrayView<const uint64>(list.Ids.GetData() + list.Head, list.Ids.Num() - list.Head));
+	}
+
+	lists.Sort([](const TArrayView<const uint64>& a, const TArrayView<const uint64>& b)
+	{
+		return a.Num() < b.Num();
+	});
+
+	const TArrayView<const uint64>& shortest = lists[0];
+	for(int32 index = shortest.Num() - 1; index >= 0 && recordIdsOut.Num() < maxResults; --index)
+	{
+		const uint64 record_id = shortest[index];
+		if(record_id < oldestId)
+		{
+			break;
+		}
+
+		bool b_in_all = true;
+		for(int32 other = 1; other < lists.Num() && b_in_all; ++other)
+		{
+			b_in_all = Algo::BinarySearch(lists[other], record_id) != INDEX_NONE;
+		}
+
+		if(b_in_all)
+		{
+			recordIdsOut.Add(record_id);
+		}
+	}
+}
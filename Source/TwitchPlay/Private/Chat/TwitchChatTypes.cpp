@@ -0,0 +1,172 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatTypes.h"
+#include "Hash/CityHash.h"
+
+uint64 FTwitchChatMessage::MakeUserKey(const FString& userIdOrName)
+{
+	// Twitch user ids are plain numbers, use them as is
+	const int32 len = userIdOrName.Len();
+	bool is_id = len > 0 && len < 19;
+	for(int32 i = 0; is_id && i < len; ++i)
+	{
+		is_id = FChar::IsDigit(userIdOrName[i]);
+	}
+	if(is_id)
+	{
+		return FCString::Strtoui64(*userIdOrName, nullptr, 10);
+	}
+
+	// Names are case insensitive, the top bit keeps them apart from ids
+	const FString lower_name = userIdOrName.ToLower();
+	return CityHash64(reinterpret_cast<const char*>(*lower_name), lower_name.Len() * sizeof(TCHAR)) | (1ull << 63);
+}
+
+const FTwitchCommandRule* FTwitchCommandRules::ParseCommand(const FString& message, const ETwitchUserRole roles, FString& commandOut, TArray<FString>& optionsOut,
+	bool* bRejectedOut) const
+{
+	if(bRejectedOut != nullptr)
+	{
+		*bRejectedOut = false;
+	}
+
+	// Only the first command is accepted
+	commandOut = GetDelimitedString(message, CommandDelimiter);
+
+	// No reason to search for the command in the map, there isn't any
+	if(commandOut.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	const FTwitchCommandRule* rule = Commands.Find(commandOut);
+	const bool b_rejected = rule != nullptr && rule->RequiredRoles != ETwitchUserRole::NONE && !EnumHasAnyFlags(roles, rule->RequiredRoles);
+	if(rule == nullptr || b_rejected)
+	{
+		if(bRejectedOut != nullptr)
+		{
+			*bRejectedOut = b_rejected;
+		}
+		commandOut.Reset();
+		return nullptr;
+	}
+
+	const FString options = GetDelimitedString(message, OptionsDelimiter);
+	options.ParseIntoArray(optionsOut, TEXT(","));
+	return rule;
+}
+
+bool FTwitchCommandRules::GetCommandAssets(const FString& command, const TArray<FString>& options, TArray<FSoftObjectPath>& assetsOut) const
+{
+	const FTwitchCommandAssets* command_assets = CommandAssets.Find(command);
+	if(command_assets == nullptr)
+	{
+		return false;
+	}
+
+	const int32 num_assets = assetsOut.Num();
+	for(const FSoftObjectPath& asset : command_assets->Assets)
+	{
+		assetsOut.AddUnique(asset);
+	}
+
+	for(const FString& option : options)
+	{
+		if(const TArray<FSoftObjectPath>* option_assets = command_assets->OptionAssets.Find(option))
+		{
+			for(const FSoftObjectPath& asset : *option_assets)
+			{
+				assetsOut.AddUnique(asset);
+			}
+		}
+	}
+
+	return assetsOut.Num() > num_assets;
+}
+
+FString FTwitchCommandRules::GetDelimitedString(const FString& inString, const FString& delimiter)
+{
+	// No delimited string can be found on an empty string
+	if (inString.IsEmpty() || delimiter.IsEmpty())
+	{
+		return TEXT("");
+	}
+
+	// Where does the delimiter start?
+	// Remember that the delimiter can be more than 1 character, so we need to add
+	// the delimiter length to find the actual start of the delimited string
+	const int32 start_index = inString.Find(delimiter);
+
+	// If the message did not contain any start delimiter no command can be found
+	// Also, if the start delimiter is at the end of the string no command can be found
+	if (start_index == INDEX_NONE || start_index + delimiter.Len() == inString.Len())
+	{
+		return TEXT("");
+	}
+
+	// Search for the end of the command delimiter
+	// The starting position for the search is the index of the previous delimiter plus
+	// the actual length of the delimiter (start search from at least one char ahead)
+	const int32 end_index = inString.Find(delimiter, ESearchCase::IgnoreCase, ESearchDir::FromStart, start_index + delimiter.Len());
+
+	// If we did not find an end delimiter no encapsulated string can be found
+	if (end_index == INDEX_NONE)
+	{
+		return TEXT("");
+	}
+
+	// If we have the two delimiter positions get the string inbetween them
+	return inString.Mid(start_index + delimiter.Len(), (end_index - (start_index + delimiter.Len())));
+}
+
+ETwitchUserRole FTwitchCommandRules::GetRolesFromBadges(const FString& badges)
+{
+	ETwitchUserRole roles = ETwitchUserRole::NONE;
+
+	// Badges are in the form "name/version,name/version"
+	TArray<FString> badgeList;
+	badges.ParseIntoArray(badgeList, TEXT(","));
+	for(const FString& badge : badgeList)
+	{
+		FString name;
+		if(!badge.Split(TEXT("/"), &name, nullptr))
+		{
+			name = badge;
+		}
+
+		if(name == TEXT("broadcaster"))
+		{
+			roles |= ETwitchUserRole::BROADCASTER | ETwitchUserRole::MODERATOR;
+		}
+		else if(name == TEXT("moderator"))
+		{
+			roles |= ETwitchUserRole::MODERATOR;
+		}
+		else if(name == TEXT("vip"))
+		{
+			roles |= ETwitchUserRole::VIP;
+		}
+		else if(name == TEXT("subscriber"))
+		{
+			roles |= ETwitchUserRole::SUBSCRIBER;
+		}
+		else if(name == TEXT("founder"))
+		{
+			roles |= ETwitchUserRole::FOUNDER | ETwitchUserRole::SUBSCRIBER;
+		}
+		else if(name == TEXT("staff") || name == TEXT("admin") || name == TEXT("global_mod"))
+		{
+			roles |= ETwitchUserRole::STAFF;
+		}
+		else if(name == TEXT("partner"))
+		{
+			roles |= ETwitchUserRole::PARTNER;
+		}
+		else if(name == TEXT("turbo") || name == TEXT("premium"))
+		{
+			roles |= ETwitchUserRole::TURBO;
+		}
+	}
+
+	return roles;
+}
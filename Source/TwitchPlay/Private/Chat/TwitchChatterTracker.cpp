@@ -0,0 +1,119 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchChatterTracker.h"
+
+FTwitchChatterTracker::FTwitchChatterTracker(const int32 maxChatters)
+	: MaxChatters(FMath::Max(maxChatters, 0))
+{
+}
+
+int32 FTwitchChatterTracker::Num() const
+{
+	FScopeLock lock(&Lock);
+	return NamesByKey.Num();
+}
+
+void FTwitchChatterTracker::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	FScopeLock lock(&Lock);
+	for(const FTwitchChatMessage& message : messages)
+	{
+		FPendingUpdate* pending;
+		if(const int32* pending_index = PendingIndices.Find(message.UserKey))
+		{
+			pending = &PendingUpdates[*pending_index];
+		}
+		else
+		{
+			const bool b_joined = !NamesByKey.Contains(message.UserKey);
+			if(b_joined)
+			{
+				if(MaxChatters > 0 && NamesByKey.Num() >= MaxChatters)
+				{
+					continue;
+				}
+
+				const uint64 name_key = FTwitchChatMessage::MakeUserKey(message.Username);
+				NamesByKey.Add(message.UserKey, name_key);
+				KeysByName.Add(name_key, message.UserKey);
+			}
+
+			PendingIndices.Add(message.UserKey, PendingUpdates.Num());
+			pending = &PendingUpdates.AddDefaulted_GetRef();
+			pending->UserKey = message.UserKey;
+			pending->bJoined = b_joined;
+			pending->Update.ChatterId = static_cast<int64>(message.UserKey);
+			pending->Update.Username = message.Username;
+		}
+
+		FTwitchChatterUpdate& update = pending->Update;
+		update.Roles = static_cast<int32>(message.Roles);
+		++update.NewMessages;
+		if(!message.Command.IsEmpty())
+		{
+			update.LastCommand = message.Command;
+			update.LastOptions = message.Options;
+		}
+	}
+}
+
+bool FTwitchChatterTracker::RemovePendingUpdate(const uint64 userKey)
+{
+	int32 pending_index;
+	if(!PendingIndices.RemoveAndCopyValue(userKey, pending_index))
+	{
+		return false;
+	}
+
+	const bool b_joined = PendingUpdates[pending_index].bJoined;
+	PendingUpdates.RemoveAtSwap(pending_index, 1, false);
+	if(PendingUpdates.IsValidIndex(pending_index))
+	{
+		PendingIndices[PendingUpdates[pending_index].UserKey] = pending_index;
+	}
+	return b_joined;
+}
+
+void FTwitchChatterTracker::ProcessDepartures(const TArray<FString>& usernames)
+{
+	FScopeLock lock(&Lock);
+	for(const FString& username : usernames)
+	{
+		uint64 user_key;
+		if(!KeysByName.RemoveAndCopyValue(FTwitchChatMessage::MakeUserKey(username), user_key))
+		{
+			continue;
+		}
+		NamesByKey.Remove(user_key);
+
+		// A chatter that came and went within the batch was never handed out
+		if(!RemovePendingUpdate(user_key))
+		{
+			PendingDepartures.Add(static_cast<int64>(user_key));
+		}
+	}
+}
+
+bool FTwitchChatterTracker::GatherBatch(FTwitchChatterBatch& batchOut)
+{
+	batchOut.Joined.Reset();
+	batchOut.Updated.Reset();
+	batchOut.Departed.Reset();
+
+	FScopeLock lock(&Lock);
+	if(PendingUpdates.Num() == 0 && PendingDepartures.Num() == 0)
+	{
+		return false;
+	}
+
+	for(FPendingUpdate& pending : PendingUpdates)
+	{
+		(pending.bJoined ? batchOut.Joined : batchOut.Updated).Add(MoveTemp(pending.Update));
+	}
+	batchOut.Departed = MoveTemp(PendingDepartures);
+
+	PendingUpdates.Reset();
+	PendingIndices.Reset();
+	PendingDepartures.Reset();
+	return true;
+}
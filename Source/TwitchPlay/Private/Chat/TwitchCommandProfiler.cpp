@@ -0,0 +1,127 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchCommandProfiler.h"
+#include "Chat/TwitchStats.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarTwitchPlayProfileCommands(
+	TEXT("TwitchPlay.ProfileCommands"),
+	0,
+	TEXT("If 1, times the handler of each registered command. See TwitchPlay.CommandCosts for the report."),
+	ECVF_Default);
+
+static FAutoConsoleCommandWithWorldArgsAndOutputDevice GTwitchPlayCommandCostsCommand(
+	TEXT("TwitchPlay.CommandCosts"),
+	TEXT("Lists the command handlers that took the most time since profiling started. TwitchPlay.CommandCosts [count=10] or TwitchPlay.CommandCosts reset"),
+	FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world, FOutputDevice& output)
+	{
+		FTwitchCommandProfiler& profiler = FTwitchCommandProfiler::Get();
+		if(args.Num() > 0 && args[0] == TEXT("reset"))
+		{
+			profiler.Reset();
+			output.Log(TEXT("Command costs reset"));
+			return;
+		}
+
+		if(!FTwitchCommandProfiler::IsEnabled())
+		{
+			output.Log(TEXT("Command profiling is off, set TwitchPlay.ProfileCommands 1"));
+		}
+
+		TArray<FTwitchCommandCost> costs;
+		profiler.GetTopOffenders(args.Num() > 0 ? FCString::Atoi(*args[0]) : 10, costs);
+		output.Logf(TEXT("%-24s %10s %12s %12s %12s"), TEXT("Command"), TEXT("Calls"), TEXT("Total ms"), TEXT("Avg ms"), TEXT("Max ms"));
+		for(const FTwitchCommandCost& cost : costs)
+		{
+			output.Logf(TEXT("%-24s %10d %12.3f %12.3f %12.3f"), *cost.Command, cost.Calls, cost.TotalSeconds * 1000.0f,
+				cost.TotalSeconds * 1000.0f / FMath::Max(cost.Calls, 1), cost.MaxSeconds * 1000.0f);
+		}
+	}));
+
+FTwitchCommandProfiler::FScope::FScope(const FString& command)
+	: Command(nullptr)
+	, StartCycles(0)
+{
+	if(IsEnabled())
+	{
+		Command = &command;
+#if STATS
+		CycleCounter.Emplace(Get().GetStatId(command));
+#endif
+		StartCycles = FPlatformTime::Cycles64();
+	}
+}
+
+FTwitchCommandProfiler::FScope::~FScope()
+{
+	if(Command != nullptr)
+	{
+		const uint64 cycles = FPlatformTime::Cycles64() - StartCycles;
+#if STATS
+		CycleCounter.Reset();
+#endif
+		Get().AddSample(*Command, cycles);
+	}
+}
+
+FTwitchCommandProfiler& FTwitchCommandProfiler::Get()
+{
+	static FTwitchCommandProfiler profiler;
+	return profiler;
+}
+
+bool FTwitchCommandProfiler::IsEnabled()
+{
+	return CVarTwitchPlayProfileCommands.GetValueOnGameThread() != 0;
+}
+
+void FTwitchCommandProfiler::AddSample(const FString& command, const uint64 cycles)
+{
+	check(IsInGameThread());
+
+	FCost& cost = Costs.FindOrAdd(command);
+	++cost.Calls;
+	cost.TotalCycles += cycles;
+	cost.MaxCycles = FMath::Max(cost.MaxCycles, cycles);
+}
+
+void FTwitchCommandProfiler::GetTopOffenders(const int32 count, TArray<FTwitchCommandCost>& costsOut) const
+{
+	costsOut.Reset(Costs.Num());
+	for(const TPair<FString, FCost>& entry : Costs)
+	{
+		FTwitchCommandCost& cost = costsOut.AddDefaulted_GetRef();
+		cost.Command = entry.Key;
+		cost.Calls = entry.Value.Calls;
+		cost.TotalSeconds = static_cast<float>(FPlatformTime::ToSeconds64(entry.Value.TotalCycles));
+		cost.MaxSeconds = static_cast<float>(FPlatformTime::ToSeconds64(entry.Value.MaxCycles));
+	}
+
+	costsOut.Sort([](const FTwitchCommandCost& a, const FTwitchCommandCost& b)
+	{
+		return a.TotalSeconds > b.TotalSeconds;
+	});
+	if(count > 0 && costsOut.Num() > count)
+	{
+		costsOut.SetNum(count);
+	}
+}
+
+void FTwitchCommandProfiler::Reset()
+{
+	Costs.Reset();
+}
+
+#if STATS
+TStatId FTwitchCommandProfiler::GetStatId(const FString& command)
+{
+	if(const TStatId* stat_id = StatIds.Find(command))
+	{
+		return *stat_id;
+	}
+
+	const TStatId stat_id = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_TwitchPlay>(FName(*(TEXT("Command ") + command)));
+	StatIds.Add(command, stat_id);
+	return stat_id;
+}
+#endif
@@ -0,0 +1,359 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchEmoteCache.h"
+#include "Engine/Texture2D.h"
+#include "HttpModule.h"
+#include "Interfaces/IHttpResponse.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Async/Async.h"
+
+// Seconds before a failed emote is requested again, doubled on each further failure up to the max
+static constexpr double TwitchEmoteRetrySeconds = 10.0;
+static constexpr double TwitchEmoteMaxRetrySeconds = 600.0;
+
+UTwitchEmoteCache::UTwitchEmoteCache()
+	: BaseUrl(TEXT("https://static-cdn.jtvnw.net/emoticons/v2/{id}/static/dark/1.0"))
+	, EmoteSize(28)
+	, AtlasSize(1024)
+	, bUseDiskCache(true)
+	, Atlas(nullptr)
+	, LruHead(INDEX_NONE)
+	, LruTail(INDEX_NONE)
+	, CellsPerRow(0)
+	, ImageWrapperModule(nullptr)
+{
+}
+
+bool UTwitchEmoteCache::GetEmoteBrush(const FString& emoteId, FSlateBrush& brushOut)
+{
+	if(const FSlateBrush* brush = FindBrush(emoteId))
+	{
+		brushOut = *brush;
+		return true;
+	}
+	return false;
+}
+
+const FSlateBrush* UTwitchEmoteCache::FindBrush(const FString& emoteId)
+{
+	check(IsInGameThread());
+
+	if(const int32* cell_index = CellsById.Find(emoteId))
+	{
+		TouchCell(*cell_index);
+		return &Cells[*cell_index].Brush;
+	}
+
+	RequestEmote(emoteId);
+	return nullptr;
+}
+
+void UTwitchEmoteCache::RequestEmote(const FString& emoteId)
+{
+	check(IsInGameThread());
+
+	if(emoteId.IsEmpty() || CellsById.Contains(emoteId) || PendingIds.Contains(emoteId))
+	{
+		return;
+	}
+
+	// Failures may be transient, try again once the emote has waited out its delay
+	const FFailedEmote* failed = FailedEmotes.Find(emoteId);
+	if(failed != nullptr && FPlatformTime::Seconds() < failed->RetryTime)
+	{
+		return;
+	}
+
+	if(ImageWrapperModule == nullptr)
+	{
+		// Modules can only be loaded on the game thread
+		ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName("ImageWrapper"));
+	}
+
+	PendingIds.Add(emoteId);
+	if(!bUseDiskCache)
+	{
+		StartDownload(emoteId);
+		return;
+	}
+
+	// Even checking for the file hits the disk, do it on a worker
+	TWeakObjectPtr<UTwitchEmoteCache> weak_this(this);
+	const FString cache_path = GetDiskCachePath(emoteId);
+	Async(EAsyncExecution::ThreadPool, [weak_this, emoteId, cache_path]()
+	{
+		TArray<uint8> data;
+		const bool b_cached = FFileHelper::LoadFileToArray(data, *cache_path, FILEREAD_Silent);
+		AsyncTask(ENamedThreads::GameThread, [weak_this, emoteId, b_cached, data = MoveTemp(data)]() mutable
+		{
+			UTwitchEmoteCache* cache = weak_this.Get();
+			if(cache == nullptr || !cache->PendingIds.Contains(emoteId))
+			{
+				return;
+			}
+
+			if(b_cached)
+			{
+				cache->DecodeAsync(emoteId, MoveTemp(data), false);
+			}
+			else
+			{
+				cache->StartDownload(emoteId);
+			}
+		});
+	});
+}
+
+FString UTwitchEmoteCache::GetDiskCachePath(const FString& emoteId) const
+{
+	// Ids come from chat, keep them from escaping the cache folder
+	FString file_name;
+	file_name.Reserve(emoteId.Len());
+	for(const TCHAR character : emoteId)
+	{
+		file_name.AppendChar(FChar::IsAlnum(character) || character == TEXT('_') ? character : TEXT('-'));
+	}
+
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TwitchPlay"), TEXT("Emotes"), file_name + TEXT(".png"));
+}
+
+void UTwitchEmoteCache::StartDownload(const FString& emoteId)
+{
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> request = FHttpModule::Get().CreateRequest();
+	request->SetURL(BaseUrl.Replace(TEXT("{id}"), *emoteId, ESearchCase::CaseSensitive));
+	request->SetVerb(TEXT("GET"));
+	request->OnProcessRequestComplete().BindUObject(this, &UTwitchEmoteCache::OnDownloadComplete, emoteId);
+	if(!request->ProcessRequest())
+	{
+		OnEmoteFailed(emoteId);
+	}
+}
+
+void UTwitchEmoteCache::OnDownloadComplete(FHttpRequestPtr request, FHttpResponsePtr response, bool bSucceeded, FString emoteId)
+{
+	if(!PendingIds.Contains(emoteId))
+	{
+		return;
+	}
+
+	if(!bSucceeded || !response.IsValid() || !EHttpResponseCodes::IsOk(response->GetResponseCode()))
+	{
+		OnEmoteFailed(emoteId);
+		return;
+	}
+
+	TArray<uint8> data = response->GetContent();
+	DecodeAsync(emoteId, MoveTemp(data), bUseDiskCache);
+}
+
+void UTwitchEmoteCache::DecodeAsync(const FString& emoteId, TArray<uint8>&& compressedData, const bool bSaveToDisk)
+{
+	TWeakObjectPtr<UTwitchEmoteCache> weak_this(this);
+	IImageWrapperModule* image_wrapper_module = ImageWrapperModule;
+	const int32 size = EmoteSize;
+	const FString cache_path = bSaveToDisk ? GetDiskCachePath(emoteId) : FString();
+	Async(EAsyncExecution::ThreadPool, [weak_this, emoteId, image_wrapper_module, size, cache_path, data = MoveTemp(compressedData)]()
+	{
+		TArray<uint8> pixels;
+		const bool b_decoded = DecodeImage(*image_wrapper_module, data, size, pixels);
+		if(b_decoded && !cache_path.IsEmpty())
+		{
+			FFileHelper::SaveArrayToFile(data, *cache_path);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [weak_this, emoteId, b_decoded, pixels = MoveTemp(pixels)]() mutable
+		{
+			UTwitchEmoteCache* cache = weak_this.Get();
+			if(cache == nullptr || !cache->PendingIds.Contains(emoteId))
+			{
+				return;
+			}
+
+			if(b_decoded)
+			{
+				cache->AddToAtlas(emoteId, MoveTemp(pixels));
+			}
+			else
+			{
+				cache->OnEmoteFailed(emoteId);
+			}
+		});
+	});
+}
+
+bool UTwitchEmoteCache::DecodeImage(IImageWrapperModule& imageWrapperModule, const TArray<uint8>& compressedData, const int32 size, TArray<uint8>& pixelsOut)
+{
+	const EImageFormat format = imageWrapperModule.DetectImageFormat(compressedData.GetData(), compressedData.Num());
+	if(format == EImageFormat::Invalid)
+	{
+		return false;
+	}
+
+	TSharedPtr<IImageWrapper> image_wrapper = imageWrapperModule.CreateImageWrapper(format);
+	TArray<uint8> raw;
+	if(!image_wrapper.IsValid() || !image_wrapper->SetCompressed(compressedData.GetData(), compressedData.Num()) || !image_wrapper->GetRaw(ERGBFormat::BGRA, 8, raw))
+	{
+		return false;
+	}
+
+	const int32 width = image_wrapper->GetWidth();
+	const int32 height = image_wrapper->GetHeight();
+	if(width <= 0 || height <= 0)
+	{
+		return false;
+	}
+
+	// Fit the image in the square keeping its aspect, centered, with nearest sampling
+	pixelsOut.SetNumZeroed(size * size * 4);
+	const float scale = static_cast<float>(size) / FMath::Max(width, height);
+	const int32 scaled_width = FMath::Clamp(FMath::RoundToInt(width * scale), 1, size);
+	const int32 scaled_height = FMath::Clamp(FMath::RoundToInt(height * scale), 1, size);
+	const int32 offset_x = (size - scaled_width) / 2;
+	const int32 offset_y = (size - scaled_height) / 2;
+	for(int32 y = 0; y < scaled_height; ++y)
+	{
+		const int32 source_y = FMath::Min(y * height / scaled_height, height - 1);
+		for(int32 x = 0; x < scaled_width; ++x)
+		{
+			const int32 source_x = FMath::Min(x * width / scaled_width, width - 1);
+			FMemory::Memcpy(&pixelsOut[((offset_y + y) * size + offset_x + x) * 4], &raw[(source_y * width + source_x) * 4], 4);
+		}
+	}
+
+	return true;
+}
+
+void UTwitchEmoteCache::CreateAtlas()
+{
+	const int32 stride = EmoteSize + CellPadding * 2;
+	CellsPerRow = FMath::Max(AtlasSize / stride, 1);
+	const int32 atlas_size = FMath::Max(AtlasSize, stride);
+
+	Atlas = UTexture2D::CreateTransient(atlas_size, atlas_size, PF_B8G8R8A8, TEXT("TwitchEmoteAtlas"));
+	Atlas->SRGB = true;
+	Atlas->Filter = TF_Bilinear;
+	Atlas->AddressX = TA_Clamp;
+	Atlas->AddressY = TA_Clamp;
+	Atlas->NeverStream = true;
+
+	// Start fully transparent
+	FTexture2DMipMap& mip = Atlas->PlatformData->Mips[0];
+	void* mip_data = mip.BulkData.Lock(LOCK_READ_WRITE);
+	FMemory::Memzero(mip_data, mip.BulkData.GetBulkDataSize());
+	mip.BulkData.Unlock();
+	Atlas->UpdateResource();
+
+	Cells.SetNum(CellsPerRow * CellsPerRow);
+	FreeCells.Reserve(Cells.Num());
+	for(int32 cell_index = Cells.Num() - 1; cell_index >= 0; --cell_index)
+	{
+		const int32 x = (cell_index % CellsPerRow) * stride + CellPadding;
+		const int32 y = (cell_index / CellsPerRow) * stride + CellPadding;
+
+		FSlateBrush& brush = Cells[cell_index].Brush;
+		brush.SetResourceObject(Atlas);
+		brush.ImageSize = FVector2D(EmoteSize, EmoteSize);
+		brush.DrawAs = ESlateBrushDrawType::Image;
+		brush.SetUVRegion(FBox2D(FVector2D(x, y) / atlas_size, FVector2D(x + EmoteSize, y + EmoteSize) / atlas_size));
+
+		FreeCells.Add(cell_index);
+	}
+}
+
+void UTwitchEmoteCache::AddToAtlas(const FString& emoteId, TArray<uint8>&& pixels)
+{
+	PendingIds.Remove(emoteId);
+	if(Atlas == nullptr)
+	{
+		CreateAtlas();
+	}
+
+	int32 cell_index;
+	if(FreeCells.Num() > 0)
+	{
+		cell_index = FreeCells.Pop(false);
+	}
+	else
+	{
+		// Evict the least recently used emote
+		cell_index = LruTail;
+		UnlinkCell(cell_index);
+		CellsById.Remove(Cells[cell_index].EmoteId);
+	}
+
+	Cells[cell_index].EmoteId = emoteId;
+	CellsById.Add(emoteId, cell_index);
+	FailedEmotes.Remove(emoteId);
+	TouchCell(cell_index);
+
+	// The render thread frees the copy once uploaded
+	const int32 stride = EmoteSize + CellPadding * 2;
+	FUpdateTextureRegion2D* region = new FUpdateTextureRegion2D((cell_index % CellsPerRow) * stride + CellPadding, (cell_index / CellsPerRow) * stride + CellPadding, 0, 0, EmoteSize, EmoteSize);
+	TArray<uint8>* upload = new TArray<uint8>(MoveTemp(pixels));
+	Atlas->UpdateTextureRegions(0, 1, region, EmoteSize * 4, 4, upload->GetData(), [upload](uint8*, const FUpdateTextureRegion2D* uploadedRegion)
+	{
+		delete upload;
+		delete uploadedRegion;
+	});
+
+	OnEmoteReady.Broadcast(emoteId);
+}
+
+void UTwitchEmoteCache::OnEmoteFailed(const FString& emoteId)
+{
+	PendingIds.Remove(emoteId);
+
+	FFailedEmote& failed = FailedEmotes.FindOrAdd(emoteId);
+	const double delay = FMath::Min(TwitchEmoteRetrySeconds * FMath::Pow(2.0, static_cast<double>(FMath::Min(failed.Failures, 16))), TwitchEmoteMaxRetrySeconds);
+	failed.RetryTime = FPlatformTime::Seconds() + delay;
+	++failed.Failures;
+}
+
+void UTwitchEmoteCache::UnlinkCell(const int32 cellIndex)
+{
+	FCell& cell = Cells[cellIndex];
+	if(cell.Prev != INDEX_NONE)
+	{
+		Cells[cell.Prev].Next = cell.Next;
+	}
+	else if(LruHead == cellIndex)
+	{
+		LruHead = cell.Next;
+	}
+
+	if(cell.Next != INDEX_NONE)
+	{
+		Cells[cell.Next].Prev = cell.Prev;
+	}
+	else if(LruTail == cellIndex)
+	{
+		LruTail = cell.Prev;
+	}
+
+	cell.Prev = INDEX_NONE;
+	cell.Next = INDEX_NONE;
+}
+
+void UTwitchEmoteCache::TouchCell(const int32 cellIndex)
+{
+	if(LruHead == cellIndex)
+	{
+		return;
+	}
+
+	UnlinkCell(cellIndex);
+	FCell& cell = Cells[cellIndex];
+	cell.Next = LruHead;
+	if(LruHead != INDEX_NONE)
+	{
+		Cells[LruHead].Prev = cellIndex;
+	}
+	LruHead = cellIndex;
+	if(LruTail == INDEX_NONE)
+	{
+		LruTail = cellIndex;
+	}
+}
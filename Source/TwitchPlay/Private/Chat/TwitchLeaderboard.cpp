@@ -0,0 +1,267 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchLeaderboard.h"
+#include "Chat/TwitchChatTypes.h"
+
+FTwitchLeaderboard::FTwitchLeaderboard()
+	: FreeList(INDEX_NONE)
+	, Root(INDEX_NONE)
+	, NextSequence(0)
+	, RandomState(0x9e3779b9u)
+	, Revision(0)
+{
+}
+
+void FTwitchLeaderboard::UpdateSize(const int32 node)
+{
+	Nodes[node].Size = 1 + SizeOf(Nodes[node].Left) + SizeOf(Nodes[node].Right);
+}
+
+void FTwitchLeaderboard::Split(const int32 node, const int64 score, const uint64 sequence, int32& leftOut, int32& rightOut)
+{
+	if(node == INDEX_NONE)
+	{
+		leftOut = INDEX_NONE;
+		rightOut = INDEX_NONE;
+		return;
+	}
+
+	if(RanksBefore(Nodes[node], score, sequence))
+	{
+		int32 right_left;
+		Split(Nodes[node].Right, score, sequence, right_left, rightOut);
+		Nodes[node].Right = right_left;
+		leftOut = node;
+	}
+	else
+	{
+		int32 left_right;
+		Split(Nodes[node].Left, score, sequence, leftOut, left_right);
+		Nodes[node].Left = left_right;
+		rightOut = node;
+	}
+	UpdateSize(node);
+}
+
+int32 FTwitchLeaderboard::Merge(const int32 left, const int32 right)
+{
+	if(left == INDEX_NONE)
+	{
+		return right;
+	}
+	if(right == INDEX_NONE)
+	{
+		return left;
+	}
+
+	if(Nodes[left].Priority > Nodes[right].Priority)
+	{
+		const int32 merged = Merge(Nodes[left].Right, right);
+		Nodes[left].Right = merged;
+		UpdateSize(left);
+		return left;
+	}
+
+	const int32 merged = Merge(left, Nodes[right].Left);
+	Nodes[right].Left = merged;
+	UpdateSize(right);
+	return right;
+}
+
+void FTwitchLeaderboard::Insert(const int32 node)
+{
+	FNode& inserted = Nodes[node];
+	inserted.Left = INDEX_NONE;
+	inserted.Right = INDEX_NONE;
+	inserted.Size = 1;
+
+	int32 left, right;
+	Split(Root, inserted.Score, inserted.Sequence, left, right);
+	Root = Merge(Merge(left, node), right);
+}
+
+void FTwitchLeaderboard::Erase(const int32 node)
+{
+	// The node is the first one not ranking before itself, and the only one ranking before its successor sequence
+	const int64 score = Nodes[node].Score;
+	const uint64 sequence = Nodes[node].Sequence;
+	int32 left, middle, right;
+	Split(Root, score, sequence, left, right);
+	Split(right, score, sequence + 1, middle, right);
+	check(middle == node);
+	Root = Merge(left, right);
+}
+
+int32 FTwitchLeaderboard::RankOf(const int32 node) const
+{
+	const FNode& target = Nodes[node];
+	int32 rank = 0;
+	int32 current = Root;
+	while(current != INDEX_NONE)
+	{
+		const FNode& current_node = Nodes[current];
+		if(current == node)
+		{
+			return rank + SizeOf(current_node.Left) + 1;
+		}
+
+		if(RanksBefore(current_node, target.Score, target.Sequence))
+		{
+			rank += SizeOf(current_node.Left) + 1;
+			current = current_node.Right;
+		}
+		else
+		{
+			current = current_node.Left;
+		}
+	}
+
+	return 0;
+}
+
+int32 FTwitchLeaderboard::UpdateScore(const int32 node, const int64 score)
+{
+	Erase(node);
+	Nodes[node].Score = score;
+	Nodes[node].Sequence = NextSequence++;
+	Insert(node);
+	++Revision;
+	return RankOf(node);
+}
+
+int32 FTwitchLeaderboard::FindOrAddNode(const FString& username)
+{
+	const uint64 user_key = FTwitchChatMessage::MakeUserKey(username);
+	if(const int32* existing = NodesByUser.Find(user_key))
+	{
+		return *existing;
+	}
+
+	int32 node = FreeList;
+	if(node != INDEX_NONE)
+	{
+		FreeList = Nodes[node].Right;
+	}
+	else
+	{
+		node = Nodes.AddDefaulted();
+	}
+
+	// Xorshift32
+	RandomState ^= RandomState << 13;
+	RandomState ^= RandomState >> 17;
+	RandomState ^= RandomState << 5;
+
+	FNode& added = Nodes[node];
+	added.Score = 0;
+	added.Sequence = NextSequence++;
+	added.UserKey = user_key;
+	added.Username = username;
+	added.Priority = RandomState;
+	NodesByUser.Add(user_key, node);
+	Insert(node);
+	++Revision;
+	return node;
+}
+
+int32 FTwitchLeaderboard::SetScore(const FString& username, const int64 score)
+{
+	const int32 node = FindOrAddNode(username);
+	return Nodes[node].Score == score ? RankOf(node) : UpdateScore(node, score);
+}
+
+int32 FTwitchLeaderboard::AddScore(const FString& username, const int64 delta)
+{
+	const int32 node = FindOrAddNode(username);
+	return delta == 0 ? RankOf(node) : UpdateScore(node, Nodes[node].Score + delta);
+}
+
+bool FTwitchLeaderboard::Remove(const FString& username)
+{
+	int32 node;
+	if(!NodesByUser.RemoveAndCopyValue(FTwitchChatMessage::MakeUserKey(username), node))
+	{
+		return false;
+	}
+
+	Erase(node);
+	Nodes[node].Username.Empty();
+	Nodes[node].Right = FreeList;
+	FreeList = node;
+	++Revision;
+	return true;
+}
+
+int32 FTwitchLeaderboard::GetRank(const FString& username, int64* scoreOut) const
+{
+	const int32* node = NodesByUser.Find(FTwitchChatMessage::MakeUserKey(username));
+	if(node == nullptr)
+	{
+		return 0;
+	}
+
+	if(scoreOut != nullptr)
+	{
+		*scoreOut = Nodes[*node].Score;
+	}
+	return RankOf(*node);
+}
+
+void FTwitchLeaderboard::GetEntries(const int32 firstRank, const int32 count, TArray<FTwitchLeaderboardEntry>& entriesOut) const
+{
+	entriesOut.Reset();
+	if(firstRank < 1 || firstRank > Num() || count <= 0)
+	{
+		return;
+	}
+
+	// Walk down to the first rank, stacking the nodes that come after it on the way
+	TArray<int32, TInlineAllocator<64>> pending;
+	int32 skip = firstRank - 1;
+	int32 current = Root;
+	while(current != INDEX_NONE)
+	{
+		const int32 left_size = SizeOf(Nodes[current].Left);
+		if(skip < left_size)
+		{
+			pending.Push(current);
+			current = Nodes[current].Left;
+		}
+		else if(skip == left_size)
+		{
+			pending.Push(current);
+			break;
+		}
+		else
+		{
+			skip -= left_size + 1;
+			current = Nodes[current].Right;
+		}
+	}
+
+	// In order from there
+	entriesOut.Reserve(FMath::Min(count, Num() - firstRank + 1));
+	int32 rank = firstRank;
+	while(entriesOut.Num() < count && pending.Num() > 0)
+	{
+		const FNode& node = Nodes[pending.Pop(false)];
+		FTwitchLeaderboardEntry& entry = entriesOut.AddDefaulted_GetRef();
+		entry.Username = node.Username;
+		entry.Score = node.Score;
+		entry.Rank = rank++;
+
+		for(int32 child = node.Right; child != INDEX_NONE; child = Nodes[child].Left)
+		{
+			pending.Push(child);
+		}
+	}
+}
+
+void FTwitchLeaderboard::Reset()
+{
+	Nodes.Reset();
+	NodesByUser.Reset();
+	FreeList = INDEX_NONE;
+	Root = INDEX_NONE;
+	++Revision;
+}
@@ -0,0 +1,95 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchMessageTemplate.h"
+
+FTwitchMessageTemplate::FTwitchMessageTemplate(const FString& pattern)
+	: NumArguments(0)
+{
+	const TCHAR* text = *pattern;
+	const int32 length = pattern.Len();
+	int32 literal_start = 0;
+	auto add_literal = [this, text](const int32 start, const int32 end)
+	{
+		if(end > start)
+		{
+			const int32 offset = Literals.Num();
+			AppendUtf8(text + start, end - start, Literals);
+			Segments.Add(FSegment { offset, Literals.Num() - offset, INDEX_NONE });
+		}
+	};
+
+	for(int32 index = 0; index < length; ++index)
+	{
+		if(text[index] != TEXT('{'))
+		{
+			continue;
+		}
+
+		// Anything but braces around digits is a literal
+		int32 end = index + 1;
+		int32 argument = 0;
+		while(end < length && FChar::IsDigit(text[end]))
+		{
+			argument = argument * 10 + (text[end] - TEXT('0'));
+			++end;
+		}
+		if(end == index + 1 || end >= length || text[end] != TEXT('}'))
+		{
+			continue;
+		}
+
+		add_literal(literal_start, index);
+		Segments.Add(FSegment { 0, 0, argument });
+		NumArguments = FMath::Max(NumArguments, argument + 1);
+		literal_start = end + 1;
+		index = end;
+	}
+	add_literal(literal_start, length);
+
+	Segments.Shrink();
+	Literals.Shrink();
+}
+
+void FTwitchMessageTemplate::Encode(const TArray<FString>& arguments, TArray<uint8>& bufferOut) const
+{
+	for(const FSegment& segment : Segments)
+	{
+		if(segment.Argument == INDEX_NONE)
+		{
+			bufferOut.Append(Literals.GetData() + segment.Offset, segment.Length);
+		}
+		else if(arguments.IsValidIndex(segment.Argument))
+		{
+			AppendUtf8(arguments[segment.Argument], bufferOut);
+		}
+	}
+}
+
+void FTwitchMessageTemplate::AppendUtf8(const TCHAR* text, const int32 length, TArray<uint8>& bufferOut)
+{
+	if(length <= 0)
+	{
+		return;
+	}
+
+	// Size first, then convert in place. Multi-byte characters make the UTF-8 length differ from the TCHAR one.
+	const int32 utf8_length = FTCHARToUTF8_Convert::ConvertedLength(text, length);
+	const int32 offset = bufferOut.AddUninitialized(utf8_length);
+	FTCHARToUTF8_Convert::Convert(reinterpret_cast<ANSICHAR*>(bufferOut.GetData() + offset), utf8_length, text, length);
+
+	// Line breaks would end the IRC line and let the rest through as raw commands (ie. a viewer name or message in an argument).
+	// CR and LF never appear inside a multi-byte UTF-8 sequence, so the bytes can be checked one by one.
+	uint8* bytes = bufferOut.GetData() + offset;
+	for(int32 index = 0; index < utf8_length; ++index)
+	{
+		if(bytes[index] == '\r' || bytes[index] == '\n')
+		{
+			bytes[index] = ' ';
+		}
+	}
+}
+
+void FTwitchMessageTemplate::AppendAnsi(const ANSICHAR* text, TArray<uint8>& bufferOut)
+{
+	bufferOut.Append(reinterpret_cast<const uint8*>(text), FCStringAnsi::Strlen(text));
+}
@@ -0,0 +1,311 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchPollEngine.h"
+#include "Chat/TwitchAssetPrefetcher.h"
+
+FTwitchPollEngine::FTwitchPollEngine()
+	: CommandDelimiter(TEXT("!"))
+	, OptionsDelimiter(TEXT("#"))
+	, NextPollId(0)
+{
+}
+
+int32 FTwitchPollEngine::StartPoll(FTwitchPollDefinition&& definition)
+{
+	if(definition.Command.IsEmpty() || definition.Options.Num() == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	FScopeLock lock(&Lock);
+	const int32 poll_id = NextPollId++;
+	FPoll& poll = Polls.Add(poll_id);
+	poll.EndTime = definition.DurationSeconds > 0.0 ? FPlatformTime::Seconds() + definition.DurationSeconds : 0.0;
+	poll.Tallies.SetNumZeroed(definition.Options.Num());
+	poll.Voters.SetNumZeroed(definition.Options.Num());
+	poll.Definition = MoveTemp(definition);
+	// Announce the empty poll on the next gather
+	poll.Revision = 1;
+
+	RebuildIndex();
+	return poll_id;
+}
+
+bool FTwitchPollEngine::EndPoll(const int32 pollId)
+{
+	FScopeLock lock(&Lock);
+	FPoll* poll = Polls.Find(pollId);
+	if(poll == nullptr || poll->bEnded)
+	{
+		return false;
+	}
+
+	poll->bEnded = true;
+	RebuildIndex();
+	return true;
+}
+
+void FTwitchPollEngine::SetDelimiters(const FString& commandDelimiter, const FString& optionsDelimiter)
+{
+	FScopeLock lock(&Lock);
+	CommandDelimiter = commandDelimiter;
+	OptionsDelimiter = optionsDelimiter;
+}
+
+int32 FTwitchPollEngine::Num() const
+{
+	FScopeLock lock(&Lock);
+	return Polls.Num();
+}
+
+void FTwitchPollEngine::RebuildIndex()
+{
+	VoteIndex.Reset();
+	for(const TPair<int32, FPoll>& entry : Polls)
+	{
+		const FPoll& poll = entry.Value;
+		if(poll.bEnded)
+		{
+			continue;
+		}
+
+		FOptionIndex& option_index = VoteIndex.FindOrAdd(poll.Definition.Command);
+		const TArray<FString>& options = poll.Definition.Options;
+
+		// An option can be voted by name or by number. Keys are case insensitive.
+		// Names are indexed first, so they win over numbers when a poll has numeric options.
+		for(int32 option = 0; option < options.Num(); ++option)
+		{
+			AddPollTarget(option_index.FindOrAdd(options[option]), entry.Key, option);
+		}
+		for(int32 option = 0; option < options.Num(); ++option)
+		{
+			AddPollTarget(option_index.FindOrAdd(FString::FromInt(option + 1)), entry.Key, option);
+		}
+	}
+}
+
+void FTwitchPollEngine::AddPollTarget(TArray<FPollTarget, TInlineAllocator<2>>& targets, const int32 pollId, const int32 option)
+{
+	// A key already claimed by the poll keeps its first option
+	const bool b_taken = targets.ContainsByPredicate([pollId](const FPollTarget& target)
+	{
+		return target.PollId == pollId;
+	});
+
+	if(!b_taken)
+	{
+		targets.Add(FPollTarget { pollId, option });
+	}
+}
+
+void FTwitchPollEngine::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	TArray<FSoftObjectPath> prefetch_assets;
+	TWeakPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> prefetcher;
+	{
+		FScopeLock lock(&Lock);
+		if(VoteIndex.Num() == 0)
+		{
+			return;
+		}
+
+		for(const FTwitchChatMessage& message : messages)
+		{
+			// Senders without the roles of a registered command can't vote with it
+			if(message.bCommandRejected)
+			{
+				continue;
+			}
+
+			// Registered commands were already parsed, other vote commands are parsed here
+			const FOptionIndex* option_index = nullptr;
+			FString vote;
+			if(!message.Command.IsEmpty())
+			{
+				option_index = VoteIndex.Find(message.Command);
+				if(option_index != nullptr && message.Options.Num() > 0)
+				{
+					vote = message.Options[0];
+				}
+			}
+			else
+			{
+				const FString command = FTwitchCommandRules::GetDelimitedString(message.Message, CommandDelimiter);
+				option_index = command.IsEmpty() ? nullptr : VoteIndex.Find(command);
+				if(option_index != nullptr)
+				{
+					vote = FTwitchCommandRules::GetDelimitedString(message.Message, OptionsDelimiter);
+					int32 comma;
+					if(vote.FindChar(TEXT(','), comma))
+					{
+						vote.LeftInline(comma);
+					}
+				}
+			}
+
+			if(option_index == nullptr || vote.IsEmpty())
+			{
+				continue;
+			}
+
+			vote.TrimStartAndEndInline();
+			const TArray<FPollTarget, TInlineAllocator<2>>* targets = option_index->Find(vote);
+			if(targets == nullptr)
+			{
+				continue;
+			}
+
+			for(const FPollTarget& target : *targets)
+			{
+				FPoll& poll = Polls[target.PollId];
+				const int32 previous_leader = poll.LeadingOption;
+				if(!CastVote(poll, target.Option, message) || poll.LeadingOption == previous_leader)
+				{
+					continue;
+				}
+
+				// New leader, start streaming in what its win would need
+				const FTwitchPollDefinition& definition = poll.Definition;
+				if(definition.OptionAssets.IsValidIndex(poll.LeadingOption) && definition.Prefetcher.IsValid())
+				{
+					prefetcher = definition.Prefetcher;
+					for(const FSoftObjectPath& asset : definition.OptionAssets[poll.LeadingOption])
+					{
+						prefetch_assets.AddUnique(asset);
+					}
+				}
+			}
+		}
+	}
+
+	if(prefetch_assets.Num() > 0)
+	{
+		if(TSharedPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> pinned_prefetcher = prefetcher.Pin())
+		{
+			pinned_prefetcher->RequestFromAnyThread(prefetch_assets);
+		}
+	}
+}
+
+bool FTwitchPollEngine::CastVote(FPoll& poll, const int32 option, const FTwitchChatMessage& message)
+{
+	const FTwitchPollDefinition& definition = poll.Definition;
+	if(poll.bEnded || (poll.EndTime > 0.0 && message.ReceivedTime >= poll.EndTime))
+	{
+		return false;
+	}
+
+	if(definition.RequiredRoles != ETwitchUserRole::NONE && !EnumHasAnyFlags(message.Roles, definition.RequiredRoles))
+	{
+		return false;
+	}
+
+	const double bits_weight = static_cast<double>(FMath::Max(message.Bits, 0)) * definition.WeightPerBit;
+	const double weight = (EnumHasAnyFlags(message.Roles, ETwitchUserRole::SUBSCRIBER) ? definition.SubscriberMultiplier : 1.0) + bits_weight;
+
+	if(FPollVote* previous_vote = poll.Votes.Find(message.UserKey))
+	{
+		if(previous_vote->Option == option)
+		{
+			// Voting again only counts the cheer
+			if(bits_weight <= 0.0)
+			{
+				return false;
+			}
+			previous_vote->Weight += bits_weight;
+			poll.Tallies[option] += bits_weight;
+		}
+		else
+		{
+			if(!definition.bAllowVoteChange)
+			{
+				return false;
+			}
+			poll.Tallies[previous_vote->Option] -= previous_vote->Weight;
+			--poll.Voters[previous_vote->Option];
+			previous_vote->Option = option;
+			previous_vote->Weight = weight;
+			poll.Tallies[option] += weight;
+			++poll.Voters[option];
+		}
+	}
+	else
+	{
+		poll.Votes.Add(message.UserKey, FPollVote { option, weight });
+		poll.Tallies[option] += weight;
+		++poll.Voters[option];
+	}
+
+	// Polls have a handful of options, a scan is cheaper than keeping them sorted. Ties keep the current leader.
+	int32 leader = poll.LeadingOption;
+	for(int32 index = 0; index < poll.Tallies.Num(); ++index)
+	{
+		if(leader == INDEX_NONE || poll.Tallies[index] > poll.Tallies[leader])
+		{
+			leader = index;
+		}
+	}
+	poll.LeadingOption = leader;
+
+	++poll.Revision;
+	return true;
+}
+
+void FTwitchPollEngine::FillResult(const int32 pollId, const FPoll& poll, const double now, FTwitchPollResult& resultOut) const
+{
+	resultOut.PollId = pollId;
+	resultOut.Command = poll.Definition.Command;
+	resultOut.Options = poll.Definition.Options;
+	resultOut.Tallies.SetNumUninitialized(poll.Tallies.Num());
+	for(int32 index = 0; index < poll.Tallies.Num(); ++index)
+	{
+		resultOut.Tallies[index] = static_cast<float>(poll.Tallies[index]);
+	}
+	resultOut.Voters = poll.Voters;
+	resultOut.LeadingOption = poll.LeadingOption;
+	resultOut.bIsOpen = !poll.bEnded && (poll.EndTime <= 0.0 || now < poll.EndTime);
+	resultOut.SecondsRemaining = resultOut.bIsOpen && poll.EndTime > 0.0 ? static_cast<float>(poll.EndTime - now) : 0.0f;
+}
+
+bool FTwitchPollEngine::GetResult(const int32 pollId, FTwitchPollResult& resultOut) const
+{
+	FScopeLock lock(&Lock);
+	const FPoll* poll = Polls.Find(pollId);
+	if(poll == nullptr)
+	{
+		return false;
+	}
+
+	FillResult(pollId, *poll, FPlatformTime::Seconds(), resultOut);
+	return true;
+}
+
+void FTwitchPollEngine::GatherResults(TArray<FTwitchPollResult>& updatedOut, TArray<FTwitchPollResult>& endedOut)
+{
+	const double now = FPlatformTime::Seconds();
+	bool b_removed = false;
+
+	FScopeLock lock(&Lock);
+	for(auto it = Polls.CreateIterator(); it; ++it)
+	{
+		FPoll& poll = it->Value;
+		if(poll.bEnded || (poll.EndTime > 0.0 && now >= poll.EndTime))
+		{
+			poll.bEnded = true;
+			FillResult(it->Key, poll, now, endedOut.AddDefaulted_GetRef());
+			it.RemoveCurrent();
+			b_removed = true;
+		}
+		else if(poll.Revision != poll.GatheredRevision)
+		{
+			poll.GatheredRevision = poll.Revision;
+			FillResult(it->Key, poll, now, updatedOut.AddDefaulted_GetRef());
+		}
+	}
+
+	if(b_removed)
+	{
+		RebuildIndex();
+	}
+}
@@ -0,0 +1,107 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchRaffle.h"
+
+FTwitchRaffle::FTwitchRaffle(FTwitchRaffleDefinition&& definition)
+	: Definition(MoveTemp(definition))
+	, Random(Definition.Seed != 0 ? Definition.Seed : FMath::Rand() ^ static_cast<int32>(FPlatformTime::Cycles()))
+	, NumEntrants(0)
+	, bIsOpen(true)
+{
+	Reservoir.Reserve(FMath::Max(Definition.NumWinners, 0));
+}
+
+double FTwitchRaffle::GetRandomFraction()
+{
+	// FRandomStream fractions only have float precision, combine two draws into 53 bits
+	const uint64 high = Random.GetUnsignedInt();
+	const uint64 low = Random.GetUnsignedInt();
+	const uint64 bits = ((high << 21) ^ low) & ((1ull << 53) - 1);
+	return static_cast<double>(bits + 1) / static_cast<double>(1ull << 53);
+}
+
+void FTwitchRaffle::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	FScopeLock lock(&Lock);
+	if(!bIsOpen || Definition.NumWinners <= 0)
+	{
+		return;
+	}
+
+	for(const FTwitchChatMessage& message : messages)
+	{
+		// Senders without the roles of a registered command can't enter with it
+		if(message.bCommandRejected)
+		{
+			continue;
+		}
+
+		// Registered commands were already parsed
+		const bool b_is_entry = message.Command.IsEmpty()
+			? FTwitchCommandRules::GetDelimitedString(message.Message, Definition.CommandDelimiter) == Definition.Command
+			: message.Command == Definition.Command;
+		if(!b_is_entry)
+		{
+			continue;
+		}
+
+		if(Definition.RequiredRoles != ETwitchUserRole::NONE && !EnumHasAnyFlags(message.Roles, Definition.RequiredRoles))
+		{
+			continue;
+		}
+
+		// Only the first entry of each user counts
+		bool b_already_entered;
+		Entered.Add(message.UserKey, &b_already_entered);
+		if(b_already_entered)
+		{
+			continue;
+		}
+		++NumEntrants;
+
+		const double weight = (EnumHasAnyFlags(message.Roles, ETwitchUserRole::SUBSCRIBER) ? Definition.SubscriberWeight : 1.0)
+			+ static_cast<double>(FMath::Max(message.Bits, 0)) * Definition.WeightPerBit;
+		if(weight <= 0.0)
+		{
+			continue;
+		}
+
+		// log(u^(1/w)) keeps the order of the keys without underflowing for large weights
+		const double key = FMath::Loge(GetRandomFraction()) / weight;
+		if(Reservoir.Num() < Definition.NumWinners)
+		{
+			Reservoir.HeapPush(FEntrant { key, message.Username });
+		}
+		else if(key > Reservoir.HeapTop().Key)
+		{
+			FEntrant weakest;
+			Reservoir.HeapPop(weakest, false);
+			Reservoir.HeapPush(FEntrant { key, message.Username });
+		}
+	}
+}
+
+void FTwitchRaffle::Draw(TArray<FString>& winnersOut)
+{
+	FScopeLock lock(&Lock);
+	bIsOpen = false;
+
+	// Highest key first
+	Reservoir.Sort([](const FEntrant& a, const FEntrant& b)
+	{
+		return a.Key > b.Key;
+	});
+
+	winnersOut.Reset(Reservoir.Num());
+	for(FEntrant& entrant : Reservoir)
+	{
+		winnersOut.Add(MoveTemp(entrant.Username));
+	}
+	Reservoir.Reset();
+}
+
+int32 FTwitchRaffle::GetNumEntrants() const
+{
+	FScopeLock lock(&Lock);
+	return NumEntrants;
+}
@@ -0,0 +1,55 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchStats.h"
+
+CSV_DEFINE_CATEGORY_MODULE(TWITCHPLAY_API, TwitchPlay, true);
+
+FTwitchStats::FTwitchStats()
+	: RoundTripMicroseconds(-1)
+	, CsvRecordedDrops(0)
+{
+}
+
+FTwitchStats& FTwitchStats::Get()
+{
+	static FTwitchStats stats;
+	return stats;
+}
+
+FTwitchStatsSnapshot FTwitchStats::TakeSnapshot() const
+{
+	// Each value is read on its own. Values may be a few updates apart, which is fine for monitoring.
+	FTwitchStatsSnapshot snapshot;
+	snapshot.Connected = Connected.GetValue();
+	snapshot.Connections = Connections.GetValue();
+	snapshot.Reconnects = Reconnects.GetValue();
+	snapshot.Disconnects = Disconnects.GetValue();
+	snapshot.LinesReceived = LinesReceived.GetValue();
+	snapshot.MessagesReceived = MessagesReceived.GetValue();
+	snapshot.MessagesFiltered = MessagesFiltered.GetValue();
+	snapshot.ReceiveQueueDepth = ReceiveQueueDepth.GetValue();
+	snapshot.SendQueueDepth = SendQueueDepth.GetValue();
+	snapshot.MessagesSent = MessagesSent.GetValue();
+	snapshot.SendFailures = SendFailures.GetValue();
+	snapshot.RateLimitWaits = RateLimitWaits.GetValue();
+	snapshot.CommandsDropped = CommandsDropped.GetValue();
+	snapshot.CommandsRejected = CommandsRejected.GetValue();
+	snapshot.ParseMicroseconds = ParseMicroseconds.GetValue();
+	snapshot.DispatchLatencyMicroseconds = DispatchLatencyMicroseconds.GetValue();
+	snapshot.RoundTripMicroseconds = RoundTripMicroseconds.GetValue();
+	return snapshot;
+}
+
+void FTwitchStats::RecordCsvFrame()
+{
+#if CSV_PROFILER
+	check(IsInGameThread());
+
+	const int64 drops = MessagesFiltered.GetValue() + CommandsDropped.GetValue();
+	CSV_CUSTOM_STAT(TwitchPlay, Drops, static_cast<int32>(drops - CsvRecordedDrops), ECsvCustomStatOp::Set);
+	CsvRecordedDrops = drops;
+
+	CSV_CUSTOM_STAT(TwitchPlay, ReceiveBacklog, static_cast<int32>(ReceiveQueueDepth.GetValue()), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TwitchPlay, SendQueueDepth, static_cast<int32>(SendQueueDepth.GetValue()), ECsvCustomStatOp::Set);
+#endif
+}
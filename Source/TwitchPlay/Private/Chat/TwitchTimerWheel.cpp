@@ -0,0 +1,247 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchTimerWheel.h"
+
+// Bucket value of timers that are about to fire
+static constexpr int32 TwitchTimerFiringBucket = -2;
+
+FTwitchTimerWheel::FTwitchTimerWheel(const double tickSeconds)
+	: FreeList(INDEX_NONE)
+	, StartTime(Now())
+	, TickSeconds(FMath::Max(tickSeconds, 0.001))
+	, CurrentTick(0)
+	, NumPending(0)
+{
+	for(int32& bucket : Buckets)
+	{
+		bucket = INDEX_NONE;
+	}
+	FMemory::Memzero(Occupied);
+}
+
+uint64 FTwitchTimerWheel::GetTick(const double seconds) const
+{
+	return seconds <= StartTime ? 0 : static_cast<uint64>((seconds - StartTime) / TickSeconds);
+}
+
+FTwitchTimerHandle FTwitchTimerWheel::Schedule(const double delaySeconds, FTimerCallback&& callback)
+{
+	int32 node_index = FreeList;
+	if(node_index != INDEX_NONE)
+	{
+		FreeList = Nodes[node_index].Next;
+	}
+	else
+	{
+		node_index = Nodes.AddDefaulted();
+	}
+
+	// Round up so a timer never fires early. The wheel might lag behind the clock if Advance wasn't called in a while.
+	const uint64 delay_ticks = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(FMath::Max(delaySeconds, 0.0) / TickSeconds)));
+	FTimerNode& node = Nodes[node_index];
+	node.Callback = MoveTemp(callback);
+	node.ExpireTick = FMath::Max(GetTick(Now()) + delay_ticks, CurrentTick + 1);
+	Insert(node_index);
+	++NumPending;
+
+	FTwitchTimerHandle handle;
+	handle.Index = node_index;
+	handle.Serial = node.Serial;
+	return handle;
+}
+
+bool FTwitchTimerWheel::IsPending(const FTwitchTimerHandle& handle) const
+{
+	return Nodes.IsValidIndex(handle.Index) && Nodes[handle.Index].Serial == handle.Serial && Nodes[handle.Index].Bucket != INDEX_NONE;
+}
+
+bool FTwitchTimerWheel::Cancel(FTwitchTimerHandle& handle)
+{
+	if(!IsPending(handle))
+	{
+		handle.Invalidate();
+		return false;
+	}
+
+	FTimerNode& node = Nodes[handle.Index];
+	if(node.Bucket != TwitchTimerFiringBucket)
+	{
+		Unlink(handle.Index);
+	}
+
+	// A timer cancelled by another one firing on the same tick is skipped thanks to the serial bump
+	node.Callback = nullptr;
+	node.Bucket = INDEX_NONE;
+	++node.Serial;
+	node.Next = FreeList;
+	FreeList = handle.Index;
+	--NumPending;
+
+	handle.Invalidate();
+	return true;
+}
+
+void FTwitchTimerWheel::Insert(const int32 nodeIndex)
+{
+	FTimerNode& node = Nodes[nodeIndex];
+	const uint64 delta = node.ExpireTick > CurrentTick ? node.ExpireTick - CurrentTick : 0;
+
+	// Each level is NumSlots times coarser than the one below it
+	int32 level = 0;
+	while(level < NumLevels - 1 && delta >= (1ull << (SlotBits * (level + 1))))
+	{
+		++level;
+	}
+
+	// Timers past the range of the top level land in it anyway and get re-inserted when their slot cascades
+	const int32 slot = static_cast<int32>((node.ExpireTick >> (SlotBits * level)) & (NumSlots - 1));
+	const int32 bucket = level * NumSlots + slot;
+
+	node.Bucket = bucket;
+	node.Prev = INDEX_NONE;
+	node.Next = Buckets[bucket];
+	if(node.Next != INDEX_NONE)
+	{
+		Nodes[node.Next].Prev = nodeIndex;
+	}
+	Buckets[bucket] = nodeIndex;
+	Occupied[level] |= 1ull << slot;
+}
+
+void FTwitchTimerWheel::Unlink(const int32 nodeIndex)
+{
+	FTimerNode& node = Nodes[nodeIndex];
+	if(node.Prev != INDEX_NONE)
+	{
+		Nodes[node.Prev].Next = node.Next;
+	}
+	else
+	{
+		Buckets[node.Bucket] = node.Next;
+		if(node.Next == INDEX_NONE)
+		{
+			Occupied[node.Bucket / NumSlots] &= ~(1ull << (node.Bucket % NumSlots));
+		}
+	}
+
+	if(node.Next != INDEX_NONE)
+	{
+		Nodes[node.Next].Prev = node.Prev;
+	}
+
+	node.Prev = INDEX_NONE;
+	node.Next = INDEX_NONE;
+}
+
+void FTwitchTimerWheel::Cascade(const int32 level)
+{
+	const int32 slot = static_cast<int32>((CurrentTick >> (SlotBits * level)) & (NumSlots - 1));
+	const int32 bucket = level * NumSlots + slot;
+
+	int32 node_index = Buckets[bucket];
+	Buckets[bucket] = INDEX_NONE;
+	Occupied[level] &= ~(1ull << slot);
+
+	while(node_index != INDEX_NONE)
+	{
+		const int32 next = Nodes[node_index].Next;
+		Insert(node_index);
+		node_index = next;
+	}
+}
+
+int32 FTwitchTimerWheel::Expire(const int32 slot)
+{
+	// Detach the whole slot first, callbacks are free to schedule and cancel timers
+	TArray<TPair<int32, uint32>, TInlineAllocator<16>> firing;
+	int32 node_index = Buckets[slot];
+	Buckets[slot] = INDEX_NONE;
+	Occupied[0] &= ~(1ull << slot);
+	while(node_index != INDEX_NONE)
+	{
+		FTimerNode& node = Nodes[node_index];
+		node.Bucket = TwitchTimerFiringBucket;
+		firing.Emplace(node_index, node.Serial);
+		node_index = node.Next;
+	}
+
+	int32 fired = 0;
+	for(const TPair<int32, uint32>& entry : firing)
+	{
+		FTimerNode& node = Nodes[entry.Key];
+		if(node.Serial != entry.Value)
+		{
+			// Cancelled by a timer that fired before it
+			continue;
+		}
+
+		FTimerCallback callback = MoveTemp(node.Callback);
+		node.Callback = nullptr;
+		node.Bucket = INDEX_NONE;
+		++node.Serial;
+		node.Next = FreeList;
+		FreeList = entry.Key;
+		--NumPending;
+
+		++fired;
+		if(callback)
+		{
+			callback();
+		}
+	}
+
+	return fired;
+}
+
+int32 FTwitchTimerWheel::Advance()
+{
+	const uint64 target_tick = GetTick(Now());
+	int32 fired = 0;
+
+	while(CurrentTick < target_tick)
+	{
+		if(NumPending == 0)
+		{
+			// Nothing to fire, skip straight to the current time
+			CurrentTick = target_tick;
+			break;
+		}
+
+		++CurrentTick;
+
+		// Each time a level wraps, the next slot of the level above moves down
+		for(int32 level = 1; level < NumLevels; ++level)
+		{
+			if((CurrentTick & ((1ull << (SlotBits * level)) - 1)) != 0)
+			{
+				break;
+			}
+			Cascade(level);
+		}
+
+		fired += Expire(static_cast<int32>(CurrentTick & (NumSlots - 1)));
+	}
+
+	return fired;
+}
+
+double FTwitchTimerWheel::GetSecondsUntilNextTimer(const double maxSeconds) const
+{
+	if(NumPending == 0)
+	{
+		return maxSeconds;
+	}
+
+	// Rotate the level 0 occupancy so bit 0 is the slot of the next tick
+	const uint32 next_slot = static_cast<uint32>((CurrentTick + 1) & (NumSlots - 1));
+	const uint64 occupied = Occupied[0];
+	const uint64 rotated = next_slot == 0 ? occupied : (occupied >> next_slot) | (occupied << (NumSlots - next_slot));
+
+	// With nothing on level 0 the next thing that can happen is level 0 wrapping and cascading
+	const uint64 ticks_until = rotated != 0
+		? FMath::CountTrailingZeros64(rotated) + 1
+		: NumSlots - (CurrentTick & (NumSlots - 1));
+
+	const double seconds = StartTime + (CurrentTick + ticks_until) * TickSeconds - Now();
+	return FMath::Clamp(seconds, 0.0, maxSeconds);
+}
@@ -0,0 +1,45 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchUserFilter.h"
+#include "Algo/BinarySearch.h"
+#include "Algo/Unique.h"
+
+FTwitchUserFilter::FTwitchUserFilter(const TArray<FString>& users, const bool bInIsAllowlist, const double falsePositiveRate)
+	: bIsAllowlist(bInIsAllowlist)
+{
+	SortedKeys.Reserve(users.Num());
+	for(const FString& user : users)
+	{
+		if(!user.IsEmpty())
+		{
+			SortedKeys.Add(FTwitchChatMessage::MakeUserKey(user));
+		}
+	}
+	SortedKeys.Sort();
+	SortedKeys.SetNum(Algo::Unique(SortedKeys));
+	SortedKeys.Shrink();
+
+	Bloom = FTwitchBloomFilter(SortedKeys.Num(), falsePositiveRate);
+	for(const uint64 key : SortedKeys)
+	{
+		Bloom.Add(key);
+	}
+}
+
+bool FTwitchUserFilter::Contains(const uint64 userKey) const
+{
+	return Bloom.MayContain(userKey) && Algo::BinarySearch(SortedKeys, userKey) != INDEX_NONE;
+}
+
+bool FTwitchUserFilter::IsAllowed(const FTwitchChatMessage& message) const
+{
+	// Lists can hold ids or login names, the message key is the id when the server sent one
+	bool on_list = Contains(message.UserKey);
+	if(!on_list && !message.Username.IsEmpty())
+	{
+		const uint64 name_key = FTwitchChatMessage::MakeUserKey(message.Username);
+		on_list = name_key != message.UserKey && Contains(name_key);
+	}
+
+	return on_list == bIsAllowlist;
+}
@@ -0,0 +1,206 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Chat/TwitchViewerQueue.h"
+
+// Initial number of slots
+static constexpr int32 TwitchViewerQueueMinSlots = 64;
+
+FTwitchViewerQueue::FTwitchViewerQueue(FTwitchViewerQueueDefinition&& definition)
+	: Definition(MoveTemp(definition))
+	, Head(0)
+{
+	Tree.SetNumZeroed(TwitchViewerQueueMinSlots + 1);
+}
+
+void FTwitchViewerQueue::TreeAdd(const int32 slot, const int32 delta)
+{
+	for(int32 index = slot + 1; index < Tree.Num(); index += index & -index)
+	{
+		Tree[index] += delta;
+	}
+}
+
+int32 FTwitchViewerQueue::TreePrefixCount(const int32 slot) const
+{
+	int32 count = 0;
+	for(int32 index = slot + 1; index > 0; index -= index & -index)
+	{
+		count += Tree[index];
+	}
+	return count;
+}
+
+void FTwitchViewerQueue::Compact()
+{
+	// Keep the viewers still in line, in order
+	TArray<FQueueSlot> slots;
+	slots.Reserve(SlotsByUser.Num());
+	for(int32 slot = Head; slot < Slots.Num(); ++slot)
+	{
+		if(Slots[slot].bInLine)
+		{
+			slots.Add(MoveTemp(Slots[slot]));
+		}
+	}
+	Slots = MoveTemp(slots);
+	Head = 0;
+
+	// Twice the viewers in line, so the next compaction is at least as many joins away
+	const int32 capacity = FMath::Max(TwitchViewerQueueMinSlots, Slots.Num() * 2);
+	Tree.Reset(capacity + 1);
+	Tree.SetNumZeroed(capacity + 1);
+	SlotsByUser.Reset();
+	SlotsByName.Reset();
+	for(int32 slot = 0; slot < Slots.Num(); ++slot)
+	{
+		SlotsByUser.Add(Slots[slot].UserKey, slot);
+		SlotsByName.Add(Slots[slot].NameKey, slot);
+
+		// Linear time build, each node pushes its sum to its parent
+		const int32 index = slot + 1;
+		Tree[index] += 1;
+		const int32 parent = index + (index & -index);
+		if(parent < Tree.Num())
+		{
+			Tree[parent] += Tree[index];
+		}
+	}
+	// Nodes past the last slot still need the sums of their children
+	for(int32 index = Slots.Num() + 1; index < Tree.Num(); ++index)
+	{
+		const int32 parent = index + (index & -index);
+		if(parent < Tree.Num())
+		{
+			Tree[parent] += Tree[index];
+		}
+	}
+}
+
+void FTwitchViewerQueue::Join(const FTwitchChatMessage& message)
+{
+	if(SlotsByUser.Contains(message.UserKey))
+	{
+		return;
+	}
+
+	if(Definition.MaxViewers > 0 && SlotsByUser.Num() >= Definition.MaxViewers)
+	{
+		return;
+	}
+
+	if(Slots.Num() + 1 >= Tree.Num())
+	{
+		Compact();
+	}
+
+	const int32 slot = Slots.AddDefaulted();
+	FQueueSlot& queue_slot = Slots[slot];
+	queue_slot.UserKey = message.UserKey;
+	queue_slot.NameKey = FTwitchChatMessage::MakeUserKey(message.Username);
+	queue_slot.Username = message.Username;
+	queue_slot.bInLine = true;
+
+	SlotsByUser.Add(queue_slot.UserKey, slot);
+	SlotsByName.Add(queue_slot.NameKey, slot);
+	TreeAdd(slot, 1);
+}
+
+void FTwitchViewerQueue::RemoveSlot(const int32 slot)
+{
+	FQueueSlot& queue_slot = Slots[slot];
+	SlotsByUser.Remove(queue_slot.UserKey);
+	SlotsByName.Remove(queue_slot.NameKey);
+	queue_slot.bInLine = false;
+	queue_slot.Username.Empty();
+	TreeAdd(slot, -1);
+}
+
+void FTwitchViewerQueue::ProcessMessages(const TArray<FTwitchChatMessage>& messages)
+{
+	FScopeLock lock(&Lock);
+	for(const FTwitchChatMessage& message : messages)
+	{
+		// Senders without the roles of a registered command can't join or leave with it
+		if(message.bCommandRejected)
+		{
+			continue;
+		}
+
+		// Registered commands were already parsed
+		const FString command = message.Command.IsEmpty()
+			? FTwitchCommandRules::GetDelimitedString(message.Message, Definition.CommandDelimiter)
+			: message.Command;
+		if(command.IsEmpty())
+		{
+			continue;
+		}
+
+		if(command == Definition.JoinCommand)
+		{
+			if(Definition.RequiredRoles == ETwitchUserRole::NONE || EnumHasAnyFlags(message.Roles, Definition.RequiredRoles))
+			{
+				Join(message);
+			}
+		}
+		else if(!Definition.LeaveCommand.IsEmpty() && command == Definition.LeaveCommand)
+		{
+			if(const int32* slot = SlotsByUser.Find(message.UserKey))
+			{
+				RemoveSlot(*slot);
+			}
+		}
+	}
+}
+
+void FTwitchViewerQueue::ProcessDepartures(const TArray<FString>& usernames)
+{
+	FScopeLock lock(&Lock);
+	for(const FString& username : usernames)
+	{
+		if(const int32* slot = SlotsByName.Find(FTwitchChatMessage::MakeUserKey(username)))
+		{
+			RemoveSlot(*slot);
+		}
+	}
+}
+
+int32 FTwitchViewerQueue::GetPosition(const FString& username) const
+{
+	FScopeLock lock(&Lock);
+	const int32* slot = SlotsByName.Find(FTwitchChatMessage::MakeUserKey(username));
+	return slot != nullptr ? TreePrefixCount(*slot) : 0;
+}
+
+void FTwitchViewerQueue::Dequeue(const int32 count, TArray<FString>& usernamesOut)
+{
+	FScopeLock lock(&Lock);
+	usernamesOut.Reset();
+	while(usernamesOut.Num() < count && Head < Slots.Num())
+	{
+		if(Slots[Head].bInLine)
+		{
+			usernamesOut.Add(Slots[Head].Username);
+			RemoveSlot(Head);
+		}
+		++Head;
+	}
+}
+
+bool FTwitchViewerQueue::Remove(const FString& username)
+{
+	FScopeLock lock(&Lock);
+	const int32* slot = SlotsByName.Find(FTwitchChatMessage::MakeUserKey(username));
+	if(slot == nullptr)
+	{
+		return false;
+	}
+
+	RemoveSlot(*slot);
+	return true;
+}
+
+int32 FTwitchViewerQueue::Num() const
+{
+	FScopeLock lock(&Lock);
+	return SlotsByUser.Num();
+}
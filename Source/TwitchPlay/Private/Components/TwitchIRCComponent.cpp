@@ -1,603 +1,1920 @@
-// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
-
-#include "Components/TwitchIRCComponent.h"
-
-FTwitchMessageReceiver::FTwitchMessageReceiver()
-	: SendingQueue(MakeUnique<FTwitchSendMessagesQueue>())
-	, ReceivingQueue(MakeUnique<FTwitchReceiveMessagesQueue>())
-	, ConnectionQueue(MakeUnique<FTwitchConnectionQueue>())
-	, ConnectionSocket(nullptr)
-	, MessagesThread(nullptr)
-	, ShouldExit(false)
-	, WaitingForAuth(false)
-	, NumAuthWaits(0)
-	, AccumulationTime(0)
-	, TimeBetweenMessages(1.2f)
-	, NextSendMessageTime(0)
-{
-	
-}
-
-FTwitchMessageReceiver::~FTwitchMessageReceiver()
-{
-	if (ConnectionSocket != nullptr)
-	{
-		ConnectionSocket->Close();
-		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ConnectionSocket);
-		ConnectionSocket = nullptr;
-	}
-
-	SendingQueue = nullptr;
-	ReceivingQueue = nullptr;
-	ConnectionQueue = nullptr;
-	MessagesThread = nullptr;
-}
-
-void FTwitchMessageReceiver::StartConnection(const FString& oauth, const FString& username, const FString& channel, const float timeBetweenMessages)
-{
-	checkf(!MessagesThread, TEXT("FTwitchMessageReceiver::StartConnection called more than once?"));
-	Oauth = oauth;
-	Username = username.ToLower();
-	Channel = channel.ToLower();
-	TimeBetweenMessages = timeBetweenMessages;
-	MessagesThread = FRunnableThread::Create(this, TEXT("FTwitchMessageReceiver"));
-}
-
-inline FString ANSIBytesToString(const uint8* In, int32 Count)
-{
-	FString Result;
-	Result.Empty(Count);
-
-	while (Count)
-	{
-		Result += static_cast<ANSICHAR>(*In);
-
-		++In;
-		Count--;
-	}
-	return Result;
-}
-
-uint32 FTwitchMessageReceiver::Run()
-{
-	if(!ConnectionSocket)
-	{
-		// Create the server connection
-		ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
-		TSharedRef<FInternetAddr> connection_addr = sss->CreateInternetAddr();
-
-		FAddressInfoResult GAIResult = sss->GetAddressInfo(TEXT("irc.twitch.tv"),
-											     nullptr,
-											     EAddressInfoFlags::Default,
-											     NAME_None);
-		if (GAIResult.Results.Num() == 0)
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Could not resolve hostname!")));
-			return 1; // if the host could not be resolved return false
-		}
-
-		connection_addr->SetRawIp(GAIResult.Results[0].Address->GetRawIp());
-
-		// Set connection port
-		const int32 port = 6667; // Standard IRC port
-		connection_addr->SetPort(port);
-
-		FSocket* ret_socket = sss->CreateSocket(NAME_Stream, TEXT("TwitchPlay Socket"), false);
-
-		// Socket creation might fail on certain subsystems
-		if (ret_socket == nullptr)
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Could not create socket!")));
-			return 1;
-		}
-
-		// Setting underlying connection parameters
-		int32 out_size;
-		ret_socket->SetReceiveBufferSize(2 * 1024 * 1024, out_size);
-		ret_socket->SetReuseAddr(true);
-
-		// Try connection
-		const bool b_has_connected = ret_socket->Connect(*connection_addr);
-
-		// If we cannot connect destroy the socket and return
-		if (!b_has_connected)
-		{
-			ret_socket->Close();
-			sss->DestroySocket(ret_socket);
-
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Connection to Twitch IRC failed!")));
-			return 1;
-		}
-
-		ConnectionSocket = ret_socket;
-
-		const bool pass_ok = SendIRCMessage(TEXT("PASS ") + Oauth);
-		const bool nick_ok = SendIRCMessage(TEXT("NICK ") + Username);
-		const bool b_success = pass_ok && nick_ok;
-		if(b_success)
-		{
-			WaitingForAuth = true;
-		}
-		else
-		{
-			ret_socket->Close();
-			sss->DestroySocket(ret_socket);
-
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_CONNECT,
-				TEXT("Could not send initial PASS and NICK messages for Auth")));
-			return 1;
-		}
-	}
-
-	while(WaitingForAuth && !ShouldExit)
-	{
-		FString connectionMessage = ReceiveFromConnection();
-		if(!connectionMessage.IsEmpty())
-		{
-			if(!(connectionMessage.StartsWith(TEXT(":tmi.twitch.tv 001")) && connectionMessage.Contains(TEXT(":Welcome, GLHF!"))))
-			{
-				ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
-				ConnectionSocket->Close();
-				sss->DestroySocket(ConnectionSocket);
-				ConnectionSocket = nullptr;
-			
-				ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, connectionMessage));
-				return 1;
-			}
-
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::CONNECTED, connectionMessage));
-			
-			WaitingForAuth = false;
-
-			if(!Channel.IsEmpty())
-			{
-				const bool join_ok = SendIRCMessage(TEXT("JOIN #") + Channel);
-				if (!join_ok)
-				{
-					ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
-					ConnectionSocket->Close();
-					sss->DestroySocket(ConnectionSocket);
-					ConnectionSocket = nullptr;
-			
-					ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, TEXT("Failed to join channel")));
-					return 1;
-				}
-			}
-
-			bIsConnected = true;
-
-			// Request command capability (If the user has extended bot permissions this means something, else it is mostly ignored)
-			// This allows whispers to function, if the bot account has extendeed permissions.
-			SendIRCMessage(TEXT("CAP REQ :twitch.tv/commands"));
-		}
-		else
-		{
-			// Wait a bit
-			SleepReceiver(0.5f);
-			++NumAuthWaits;
-			if(NumAuthWaits > 4)
-			{
-				NumAuthWaits = 0;
-				ShouldExit = true;
-				ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, TEXT("Server did not respond")));
-			}
-		}
-	}
-
-	while(ConnectionSocket != nullptr && !ShouldExit)
-	{
-		if(ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
-		{
-			FString connectionMessage = ReceiveFromConnection();
-			if (!connectionMessage.IsEmpty())
-			{
-				FTwitchReceiveMessages newMessages;
-				ParseMessage(connectionMessage, newMessages.Usernames, newMessages.Messages);
-				if(newMessages.Messages.Num())
-				{
-					ReceivingQueue->Enqueue(newMessages);
-				}
-			}
-
-			if(NextSendMessageTime <= AccumulationTime)
-			{
-				// Send our messages
-				FTwitchSendMessage sendMessage;
-				if(SendingQueue->Dequeue(sendMessage))
-				{
-					if(sendMessage.Type == ETwitchSendMessageType::CHAT_MESSAGE)
-					{
-						if(!sendMessage.Channel.IsEmpty())
-						{
-							// Specific user private message
-							SendIRCMessage(sendMessage.Message, sendMessage.Channel);
-						}
-						else if(!Channel.IsEmpty())
-						{
-							// To the currently joined channel
-							SendIRCMessage(sendMessage.Message, Channel);
-						}
-						else
-						{
-							ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::ERROR,
-                                TEXT("Cannot send message. No channel specified, and not joined to a channel.")));
-						}
-					}
-					else if(sendMessage.Type == ETwitchSendMessageType::JOIN_MESSAGE)
-					{
-						if(!Channel.IsEmpty())
-						{
-							SendIRCMessage(TEXT("PART #") + Channel);
-						}
-						Channel = sendMessage.Channel;
-						if(!Channel.IsEmpty())
-						{
-							SendIRCMessage(TEXT("JOIN #") + Channel);
-						}
-					}
-
-					NextSendMessageTime = AccumulationTime + TimeBetweenMessages;
-				}
-			}
-			
-			// Sleep a bit before pulling more messages
-			SleepReceiver(0.2f);
-		}
-		else
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Lost connection to server")));
-			ShouldExit = true;
-			bIsConnected = false;
-		}
-	}
-
-	bIsConnected = false;
-	if(ConnectionSocket)
-	{
-		if(ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
-		{
-			if(!Channel.IsEmpty())
-			{
-				// Part ways
-				SendIRCMessage(TEXT("PART #") + Channel);
-			}
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Diconnected by request gracefully")));
-		}
-
-		ConnectionSocket->Close();
-		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ConnectionSocket);
-		ConnectionSocket = nullptr;
-	}
-	
-	return 0;
-}
-
-bool FTwitchMessageReceiver::SendIRCMessage(const FString& message, const FString channel)
-{
-	// Only operate on existing and connected sockets
-	if (ConnectionSocket != nullptr && ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
-	{
-		FString messageOut = message;
-		// If the user specified a receiver format the message appropriately ("PRIVMSG")
-		if (!channel.IsEmpty())
-		{
-			messageOut = FString::Printf(TEXT("PRIVMSG #%s :%s"), *channel, *message);
-		}
-		messageOut += TEXT("\r\n");
-		const TCHAR* serialized_message = GetData(messageOut);
-		const int32 size = FCString::Strlen(serialized_message);
-		int32 out_sent;
-		return ConnectionSocket->Send(reinterpret_cast<const uint8*>(TCHAR_TO_UTF8(serialized_message)), size, out_sent);
-	}
-	
-	return false;
-}
-
-void FTwitchMessageReceiver::Stop()
-{
-	ShouldExit = true;
-}
-
-void FTwitchMessageReceiver::Exit()
-{
-}
-
-void FTwitchMessageReceiver::PullMessages(TArray<FString>& usernamesOut, TArray<FString>& messagesOut)
-{
-	if(ReceivingQueue.IsValid() && !ReceivingQueue->IsEmpty())
-	{
-		FTwitchReceiveMessages message;
-		while(ReceivingQueue->Dequeue(message))
-		{
-			usernamesOut.Append(message.Usernames);
-			messagesOut.Append(message.Messages);
-		}
-	}
-}
-
-void FTwitchMessageReceiver::SendMessage(const ETwitchSendMessageType type, const FString& message, const FString& channel)
-{
-	if(SendingQueue.IsValid())
-	{
-		SendingQueue->Enqueue(FTwitchSendMessage {type, message, channel});
-	}
-}
-
-bool FTwitchMessageReceiver::PullConnectionMessage(ETwitchConnectionMessageType& statusOut, FString& messageOut)
-{
-	TwitchConnectionPair connectionPair;
-	if(ConnectionQueue->Dequeue(connectionPair))
-	{
-		statusOut = connectionPair.Key;
-		messageOut = connectionPair.Value;
-		return true;
-	}
-
-	return false;
-}
-
-void FTwitchMessageReceiver::StopConnection(bool waitTillComplete)
-{
-	if(MessagesThread)
-	{
-		ShouldExit = true;
-		if(waitTillComplete)
-		{
-			MessagesThread->Kill(true);
-		}
-	}
-}
-
-void FTwitchMessageReceiver::SleepReceiver(float seconds)
-{
-	FPlatformProcess::Sleep(seconds);
-	AccumulationTime += seconds;
-}
-
-FString FTwitchMessageReceiver::ReceiveFromConnection() const
-{
-	TArray<uint8> data;
-	uint32 data_size;
-	bool received = false;
-	if (ConnectionSocket->HasPendingData(data_size))
-	{
-		received = true;
-		data.SetNumUninitialized(data_size); // Make space for the data
-		int32 data_read;
-		ConnectionSocket->Recv(data.GetData(), data.Num(), data_read); // Receive the data. Hopefully the buffer is large enough
-	}
-
-	FString connectionMessage;
-	if (received)
-	{
-		connectionMessage = ANSIBytesToString(data.GetData(), data.Num());
-	}
-
-	return connectionMessage;
-}
-
-void FTwitchMessageReceiver::ParseMessage(const FString& message, TArray<FString>& out_sender_username, TArray<FString>& messagesOut)
-{
-	messagesOut.Reset();
-	
-	TArray<FString> message_lines;
-	message.ParseIntoArrayLines(message_lines); // A single "message" from Twitch IRC could include multiple lines. Split them now
-
-	// Parse each line into its parts
-	// Each line from Twitch contains meta information and content
-	// Also need to check if the message is a PING sent from Twitch to check if the connection is alive
-	// This is in the form "PING :tmi.twitch.tv" to which we need to reply with "PONG :tmi.twitch.tv"
-	for (int32 cycle_line = 0; cycle_line < message_lines.Num(); cycle_line++)
-	{
-		// If we receive a PING immediately reply with a PONG and skip the line parsing
-		if (message_lines[cycle_line] == TEXT("PING :tmi.twitch.tv"))
-		{
-			SendIRCMessage(TEXT("PONG :tmi.twitch.tv"));
-			continue; // Skip line parsing
-		}
-
-		// Parsing line
-		// Basic message form is ":twitch_username!twitch_username@twitch_username.tmi.twitch.tv PRIVMSG #channel :message here"
-		// So we can split the message into two parts based off the ":" character: meta[0] and content[1..n]
-		// Also have to account for	possible ":" inside the content itself
-		TArray<FString> message_parts;
-		message_lines[cycle_line].ParseIntoArray(message_parts, TEXT(":"));
-		if(!message_parts.Num())
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]));
-			continue;
-		}
-
-		// Meta parsing
-		// Meta info is split by whitespaces
-		TArray<FString> meta;
-		message_parts[0].ParseIntoArrayWS(meta);
-		if(meta.Num() < 2)
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]));
-			continue;
-		}
-
-		// Assume at this point the message is from a user, but just in case set it beforehand
-		// This is so that we can return an "empty" user if the message was of any other kind
-		// For example, messages from the server (like upon connection) don't have a username
-		FString sender_username;
-		if (meta[1] == TEXT("PRIVMSG")) // Type of message should always be in position 1 (or at least I hope so)
-		{
-			// Username should be the first part before the first "!"
-			meta[0].Split(TEXT("!"), &sender_username, nullptr);
-		}
-
-		if (sender_username.IsEmpty())
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]));
-			continue; // Skip line
-		}
-
-		// Some messages correspond to events sent by the server (JOIN etc.)
-		// In that case the message part is only one
-		if (message_parts.Num() > 1)
-		{
-			// Content of the message is composed by all parts of the message from message_parts[1] on
-			FString message_content = message_parts[1];
-			if (message_parts.Num() > 2)
-			{
-				for (int32 cycle_content = 2; cycle_content < message_parts.Num(); cycle_content++)
-				{
-					// Add back the ":" that was used as the splitter
-					message_content += TEXT(":") + message_parts[cycle_content];
-				}
-			}
-			messagesOut.Add(message_content);
-			out_sender_username.Add(sender_username);
-		}
-		else if(message_parts.Num())
-		{
-			ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::MESSAGE, message_parts[0]));
-		}
-	}
-}
-
-// Sets default values for this component's properties
-UTwitchIRCComponent::UTwitchIRCComponent()
-	: TimeBetweenChatMessages(1.2f)
-	, TwitchMessageReceiver(nullptr)
-{
-	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.bStartWithTickEnabled = false;
-}
-
-void UTwitchIRCComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
-
-	if(TwitchMessageReceiver.IsValid())
-	{
-		bool stillConnected = true;
-		ETwitchConnectionMessageType status; FString message;
-		while(TwitchMessageReceiver->PullConnectionMessage(status, message))
-		{
-			OnConnectionMessage.Broadcast(status, message);
-			if(status == ETwitchConnectionMessageType::FAILED_TO_CONNECT ||
-				status == ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE ||
-				status == ETwitchConnectionMessageType::DISCONNECTED)
-			{
-				stillConnected = false;
-			}
-		}
-
-		if(!stillConnected)
-		{
-			PrimaryComponentTick.SetTickFunctionEnable(false);
-			TwitchMessageReceiver = nullptr;
-		}
-		else
-		{
-			TArray<FString> usernames; TArray<FString> messages;
-			TwitchMessageReceiver->PullMessages(usernames, messages);
-			check(usernames.Num() == messages.Num());
-			for(int32 messageIndex = 0; messageIndex < messages.Num(); ++messageIndex)
-			{
-				OnMessageReceived.Broadcast(messages[messageIndex], usernames[messageIndex]);
-			}
-		}
-	}
-	else
-	{
-		PrimaryComponentTick.SetTickFunctionEnable(false);
-	}
-}
-
-void UTwitchIRCComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
-{
-	Super::EndPlay(EndPlayReason);
-
-	if(TwitchMessageReceiver.IsValid())
-	{
-		TwitchMessageReceiver->StopConnection(true);
-	}
-}
-
-void UTwitchIRCComponent::Connect(const FString& oauth, const FString& username, const FString& channel)
-{
-	if(TwitchMessageReceiver.IsValid())
-	{
-		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Already connected / connecting / pending!"));
-		return;
-	}
-	if(oauth.IsEmpty() || username.IsEmpty())
-	{
-		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Invalid connection parameters. Check your strings."));
-		return;
-	}
-
-	// Create the connection and messaging thread
-	TwitchMessageReceiver = MakeUnique<FTwitchMessageReceiver>();
-	TwitchMessageReceiver->StartConnection(oauth, username, channel, TimeBetweenChatMessages);
-	// Tick our component which pulls messages off the queue
-	PrimaryComponentTick.SetTickFunctionEnable(true);
-}
-
-bool UTwitchIRCComponent::SendChatMessage(const FString& message, const FString channel)
-{
-	if(TwitchMessageReceiver.IsValid())
-	{
-		TwitchMessageReceiver->SendMessage(ETwitchSendMessageType::CHAT_MESSAGE, message, channel);
-		return true;
-	}
-
-	return false;
-}
-
-bool UTwitchIRCComponent::SendWhisper(const FString& userName, const FString& message, const FString channel)
-{
-	if(TwitchMessageReceiver.IsValid())
-	{
-		const FString whisperMessage = FString::Printf(TEXT("/w %s %s"), *userName, *message);
-		TwitchMessageReceiver->SendMessage(ETwitchSendMessageType::CHAT_MESSAGE, whisperMessage, channel);
-		return true;
-	}
-
-	return false;
-}
-
-void UTwitchIRCComponent::JoinChannel(const FString& channel)
-{
-	if(!TwitchMessageReceiver.IsValid())
-	{
-		return;
-	}
-
-	TwitchMessageReceiver->SendMessage(ETwitchSendMessageType::JOIN_MESSAGE, TEXT(""), channel);
-}
-
-void UTwitchIRCComponent::Disconnect()
-{
-	if(!TwitchMessageReceiver.IsValid())
-	{
-		return;
-	}
-	
-	TwitchMessageReceiver->StopConnection(false);
-}
-
-bool UTwitchIRCComponent::IsConnected() const
-{
-	return TwitchMessageReceiver.IsValid() && TwitchMessageReceiver->IsConnected();
-}
-
-bool UTwitchIRCComponent::IsPendingConnection() const
-{
-	return TwitchMessageReceiver.IsValid() && !TwitchMessageReceiver->IsConnected();
-}
-
-bool UTwitchIRCComponent::GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const
-{
-	if(!TwitchMessageReceiver.IsValid())
-	{
-		return false;
-	}
-
-	TwitchMessageReceiver->GetConnectionInfo(oauthOut, usernameOut, channelOut);
-	return true;
-}
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Components/TwitchIRCComponent.h"
+#include "Chat/TwitchAssetPrefetcher.h"
+#include "Chat/TwitchStats.h"
+#include "Async/Async.h"
+#if WITH_EDITOR
+#include "TwitchPieSessions.h"
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogTwitchPlay, Log, All);
+
+// Seconds to wait for the server to answer the login
+static constexpr double TwitchAuthTimeoutSeconds = 2.5;
+
+// Twitch PINGs about every 5 minutes. If nothing at all was heard for longer, PING the server ourselves.
+static constexpr double TwitchKeepAliveIdleSeconds = 330.0;
+
+// Seconds the server has to answer our PING before the connection is considered lost
+static constexpr double TwitchKeepAliveReplySeconds = 15.0;
+
+// Seconds between the PINGs that measure the round trip to the server
+static constexpr double TwitchRoundTripProbeSeconds = 60.0;
+
+// Bytes the socket can leave unsent before the server is considered gone
+static constexpr int32 TwitchMaxUnsentBytes = 256 * 1024;
+
+FTwitchMessageReceiver::FTwitchMessageReceiver()
+	: SendingQueue(MakeUnique<FTwitchSendMessagesQueue>())
+	, ReceivingQueue(MakeUnique<FTwitchReceiveMessagesQueue>())
+	, ConnectionQueue(MakeUnique<FTwitchConnectionQueue>())
+	, ReceiverTasks(MakeUnique<FTwitchReceiverTaskQueue>())
+	, ConnectionSocket(nullptr)
+	, MessagesThread(nullptr)
+	, ShouldExit(false)
+	, bConnectionLost(false)
+	, SendEvent(FPlatformProcess::GetSynchEventFromPool(false))
+	, Role(ETwitchConnectionRole::READ_WRITE)
+	, bBuildDisplayLines(false)
+	, bIsAnonymous(false)
+	, WaitingForAuth(false)
+	, TimeBetweenMessages(1.2f)
+	, bSendAllowed(true)
+	, PingSentTime(0.0)
+	, bIsShared(false)
+	, bSessionConnected(false)
+	, bIsFinished(false)
+{
+	
+}
+
+FTwitchMessageReceiver::~FTwitchMessageReceiver()
+{
+	// The shared connection must not reach a follower that is gone
+	if(Source.IsValid())
+	{
+		StopConnection(true);
+	}
+
+	// The thread owns the socket and the queues until it is done with them
+	if(MessagesThread != nullptr)
+	{
+		StopConnection(true);
+		delete MessagesThread;
+		MessagesThread = nullptr;
+	}
+
+	if (ConnectionSocket != nullptr)
+	{
+		ConnectionSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ConnectionSocket);
+		ConnectionSocket = nullptr;
+	}
+
+	// Whatever is left in the queues no longer counts as waiting
+	FTwitchStats& stats = FTwitchStats::Get();
+	FTwitchReceiveMessages received;
+	while(ReceivingQueue->Dequeue(received))
+	{
+		stats.ReceiveQueueDepth.Subtract(received.Messages.Num());
+	}
+	FTwitchSendMessage sendMessage;
+	while(SendingQueue->Dequeue(sendMessage))
+	{
+		stats.SendQueueDepth.Decrement();
+	}
+
+	SendingQueue = nullptr;
+	ReceivingQueue = nullptr;
+	ConnectionQueue = nullptr;
+	ReceiverTasks = nullptr;
+
+	FPlatformProcess::ReturnSynchEventToPool(SendEvent);
+	SendEvent = nullptr;
+}
+
+void FTwitchMessageReceiver::StartConnection(const FString& oauth, const FString& username, const FString& channel, const float timeBetweenMessages,
+	const ETwitchConnectionRole role)
+{
+	checkf(!MessagesThread, TEXT("FTwitchMessageReceiver::StartConnection called more than once?"));
+	Role = role;
+	Oauth = oauth;
+	Username = username.ToLower();
+	Channel = channel.ToLower();
+	TimeBetweenMessages = timeBetweenMessages;
+	MessagesThread = FRunnableThread::Create(this, TEXT("FTwitchMessageReceiver"));
+}
+
+void FTwitchMessageReceiver::StartAnonymousConnection(const FString& channel)
+{
+	// Twitch accepts any "justinfan" nick without a PASS as a read-only login
+	bIsAnonymous = true;
+	StartConnection(TEXT(""), FString::Printf(TEXT("justinfan%d"), FMath::RandRange(10000, 99999)), channel, 0.0f, ETwitchConnectionRole::READ_ONLY);
+}
+
+void FTwitchMessageReceiver::StartFollowing(const TSharedRef<FTwitchMessageReceiver, ESPMode::ThreadSafe>& source)
+{
+	checkf(!MessagesThread && !Source.IsValid(), TEXT("FTwitchMessageReceiver::StartFollowing called on a started receiver?"));
+	Role = source->Role;
+	bIsAnonymous = source->bIsAnonymous;
+	Oauth = source->Oauth;
+	Username = source->Username;
+	Channel = source->Channel;
+	TimeBetweenMessages = source->TimeBetweenMessages;
+	Source = source;
+	source->AddFollower(*this);
+}
+
+uint32 FTwitchMessageReceiver::Run()
+{
+	if(!ConnectionSocket)
+	{
+		// Create the server connection
+		ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		TSharedRef<FInternetAddr> connection_addr = sss->CreateInternetAddr();
+
+		FAddressInfoResult GAIResult = sss->GetAddressInfo(TEXT("irc.twitch.tv"),
+											     nullptr,
+											     EAddressInfoFlags::Default,
+											     NAME_None);
+		if (GAIResult.Results.Num() == 0)
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Could not resolve hostname!"));
+			return 1; // if the host could not be resolved return false
+		}
+
+		connection_addr->SetRawIp(GAIResult.Results[0].Address->GetRawIp());
+
+		// Set connection port
+		const int32 port = 6667; // Standard IRC port
+		connection_addr->SetPort(port);
+
+		FSocket* ret_socket = sss->CreateSocket(NAME_Stream, TEXT("TwitchPlay Socket"), false);
+
+		// Socket creation might fail on certain subsystems
+		if (ret_socket == nullptr)
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Could not create socket!"));
+			return 1;
+		}
+
+		// Setting underlying connection parameters
+		// Write connections only ever read server replies and PINGs, so they trade receive buffer for send buffer
+		int32 out_size;
+		if(Role == ETwitchConnectionRole::WRITE_ONLY)
+		{
+			ret_socket->SetReceiveBufferSize(64 * 1024, out_size);
+			ret_socket->SetSendBufferSize(256 * 1024, out_size);
+		}
+		else
+		{
+			ret_socket->SetReceiveBufferSize(2 * 1024 * 1024, out_size);
+		}
+		ret_socket->SetReuseAddr(true);
+
+		// Try connection
+		const bool b_has_connected = ret_socket->Connect(*connection_addr);
+
+		// If we cannot connect destroy the socket and return
+		if (!b_has_connected)
+		{
+			ret_socket->Close();
+			sss->DestroySocket(ret_socket);
+
+			PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_CONNECT, TEXT("Connection to Twitch IRC failed!"));
+			return 1;
+		}
+
+		ConnectionSocket = ret_socket;
+
+		// Anonymous logins must not send a PASS
+		const bool pass_ok = bIsAnonymous || SendIRCMessage(TEXT("PASS ") + Oauth);
+		const bool nick_ok = SendIRCMessage(TEXT("NICK ") + Username);
+		const bool b_success = pass_ok && nick_ok;
+		if(b_success)
+		{
+			WaitingForAuth = true;
+		}
+		else
+		{
+			ret_socket->Close();
+			sss->DestroySocket(ret_socket);
+
+			PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_CONNECT,
+				TEXT("Could not send initial PASS and NICK messages for Auth"));
+			return 1;
+		}
+	}
+
+	bool bAuthTimedOut = false;
+	FTwitchTimerHandle authTimer = Timers.Schedule(TwitchAuthTimeoutSeconds, [&bAuthTimedOut]()
+	{
+		bAuthTimedOut = true;
+	});
+
+	while(WaitingForAuth && !ShouldExit)
+	{
+		FString connectionMessage = ReceiveFromConnection();
+		if(!connectionMessage.IsEmpty())
+		{
+			if(!(connectionMessage.StartsWith(TEXT(":tmi.twitch.tv 001")) && connectionMessage.Contains(TEXT(":Welcome, GLHF!"))))
+			{
+				ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+				ConnectionSocket->Close();
+				sss->DestroySocket(ConnectionSocket);
+				ConnectionSocket = nullptr;
+			
+				PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, connectionMessage);
+				return 1;
+			}
+
+			PostConnectionMessage(ETwitchConnectionMessageType::CONNECTED, connectionMessage);
+			
+			WaitingForAuth = false;
+			ResetKeepAlive();
+
+			if(!Channel.IsEmpty())
+			{
+				const bool join_ok = SendIRCMessage(TEXT("JOIN #") + Channel);
+				if (!join_ok)
+				{
+					ISocketSubsystem* sss = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+					ConnectionSocket->Close();
+					sss->DestroySocket(ConnectionSocket);
+					ConnectionSocket = nullptr;
+			
+					PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, TEXT("Failed to join channel"));
+					return 1;
+				}
+			}
+
+			SetConnected(true);
+			FTwitchStats::Get().Connections.Increment();
+			ScheduleRoundTripProbe();
+
+			// Request tags so the badges of the sender come along with each message
+			SendIRCMessage(TEXT("CAP REQ :twitch.tv/tags"));
+
+			// Request membership so chat stages learn about users leaving the channel
+			if(Role != ETwitchConnectionRole::WRITE_ONLY)
+			{
+				SendIRCMessage(TEXT("CAP REQ :twitch.tv/membership"));
+			}
+
+			// Request command capability (If the user has extended bot permissions this means something, else it is mostly ignored)
+			// This allows whispers to function, if the bot account has extendeed permissions.
+			if(!bIsAnonymous)
+			{
+				SendIRCMessage(TEXT("CAP REQ :twitch.tv/commands"));
+			}
+		}
+		else
+		{
+			// Wait for the reply, or the auth deadline
+			if(UnsentBytes.Num() > 0)
+			{
+				SendUnsentBytes();
+			}
+			WaitForIncomingData(static_cast<float>(Timers.GetSecondsUntilNextTimer(0.5)));
+			Timers.Advance();
+			if(bAuthTimedOut)
+			{
+				ShouldExit = true;
+				PostConnectionMessage(ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE, TEXT("Server did not respond"));
+			}
+		}
+	}
+
+	// The deadline refers to this stack frame, make sure it can't fire later
+	Timers.Cancel(authTimer);
+
+	while(ConnectionSocket != nullptr && !ShouldExit)
+	{
+		if(ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
+		{
+			RunReceiverTasks();
+
+			FString connectionMessage = ReceiveFromConnection();
+			if (!connectionMessage.IsEmpty())
+			{
+				// Anything from the server proves the connection is alive
+				ResetKeepAlive();
+
+				const uint64 parse_start = FPlatformTime::Cycles64();
+
+				FTwitchReceiveMessages newMessages;
+				TArray<FString> departures;
+				ParseMessage(connectionMessage, newMessages.Messages, departures);
+				// Write connections still parse to answer PINGs, but chat is read on the read connection
+				if((newMessages.Messages.Num() || departures.Num()) && Role != ETwitchConnectionRole::WRITE_ONLY)
+				{
+					if(bIsShared)
+					{
+						DeliverToFollowers(MoveTemp(newMessages.Messages), departures);
+					}
+					else
+					{
+						ProcessReceived(MoveTemp(newMessages.Messages), departures);
+					}
+				}
+
+				FTwitchStats::Get().ParseMicroseconds.Add(static_cast<int64>(FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - parse_start) * 1000000.0));
+			}
+
+			// Fire due timers: send pacing, keepalive, announcements
+			Timers.Advance();
+
+			if(UnsentBytes.Num() > 0)
+			{
+				SendUnsentBytes();
+			}
+
+			if(bSendAllowed)
+			{
+				SendNextMessage();
+			}
+			
+			// Sleep until there's something to do, but no later than the next timer
+			double nextTimer = Timers.GetSecondsUntilNextTimer(0.2);
+			if(bIsShared)
+			{
+				// Command batches of the followers close on this thread too
+				nextTimer = AdvanceFollowerTimers(nextTimer);
+			}
+			const float maxWait = static_cast<float>(nextTimer);
+			if(Role == ETwitchConnectionRole::WRITE_ONLY)
+			{
+				// Wake up when a message is queued and allowed to be sent
+				WaitForSendWork(maxWait);
+			}
+			else
+			{
+				// Wake up as soon as data arrives
+				WaitForIncomingData(maxWait);
+			}
+		}
+		else
+		{
+			LoseConnection(TEXT("Socket closed by the server"));
+		}
+	}
+
+	SetConnected(false);
+	if(ConnectionSocket)
+	{
+		// A lost connection was already reported, and the socket may still look connected with nobody on the other end
+		if(!bConnectionLost && ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
+		{
+			if(!Channel.IsEmpty())
+			{
+				// Part ways
+				SendIRCMessage(TEXT("PART #") + Channel);
+			}
+			PostConnectionMessage(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Diconnected by request gracefully"));
+		}
+
+		ConnectionSocket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ConnectionSocket);
+		ConnectionSocket = nullptr;
+	}
+	
+	return 0;
+}
+
+bool FTwitchMessageReceiver::SendIRCMessage(const FString& message, const FString channel)
+{
+	// Only operate on existing and connected sockets
+	if (ConnectionSocket != nullptr && ConnectionSocket->GetConnectionState() == ESocketConnectionState::SCS_Connected)
+	{
+		SendBuffer.Reset();
+		// If the user specified a receiver format the message appropriately ("PRIVMSG")
+		if (!channel.IsEmpty())
+		{
+			FTwitchMessageTemplate::AppendAnsi("PRIVMSG #", SendBuffer);
+			FTwitchMessageTemplate::AppendUtf8(channel, SendBuffer);
+			FTwitchMessageTemplate::AppendAnsi(" :", SendBuffer);
+		}
+		FTwitchMessageTemplate::AppendUtf8(message, SendBuffer);
+		FTwitchMessageTemplate::AppendAnsi("\r\n", SendBuffer);
+		return FlushSendBuffer();
+	}
+	
+	return false;
+}
+
+bool FTwitchMessageReceiver::SendChatLine(const FTwitchSendMessage& message, const FString& channel)
+{
+	if(!message.Template.IsValid())
+	{
+		return SendIRCMessage(message.Message, channel);
+	}
+
+	if(ConnectionSocket == nullptr || ConnectionSocket->GetConnectionState() != ESocketConnectionState::SCS_Connected)
+	{
+		return false;
+	}
+
+	SendBuffer.Reset();
+	FTwitchMessageTemplate::AppendAnsi("PRIVMSG #", SendBuffer);
+	FTwitchMessageTemplate::AppendUtf8(channel, SendBuffer);
+	FTwitchMessageTemplate::AppendAnsi(" :", SendBuffer);
+	if(!message.WhisperTarget.IsEmpty())
+	{
+		FTwitchMessageTemplate::AppendAnsi("/w ", SendBuffer);
+		FTwitchMessageTemplate::AppendUtf8(message.WhisperTarget, SendBuffer);
+		FTwitchMessageTemplate::AppendAnsi(" ", SendBuffer);
+	}
+	message.Template->Encode(message.Arguments, SendBuffer);
+	FTwitchMessageTemplate::AppendAnsi("\r\n", SendBuffer);
+	return FlushSendBuffer();
+}
+
+bool FTwitchMessageReceiver::FlushSendBuffer()
+{
+	if(bConnectionLost)
+	{
+		return false;
+	}
+
+	// Lines must reach the socket whole and in order, so a line waits behind the unsent tail of the previous ones
+	if(UnsentBytes.Num() + SendBuffer.Num() > TwitchMaxUnsentBytes)
+	{
+		LoseConnection(TEXT("Server stopped taking messages"));
+		return false;
+	}
+	UnsentBytes.Append(SendBuffer);
+	return SendUnsentBytes();
+}
+
+bool FTwitchMessageReceiver::SendUnsentBytes()
+{
+	// The size is in UTF-8 bytes, a partial send is resumed where it stopped
+	int32 total_sent = 0;
+	bool b_failed = false;
+	while(total_sent < UnsentBytes.Num())
+	{
+		int32 out_sent = 0;
+		if(!ConnectionSocket->Send(UnsentBytes.GetData() + total_sent, UnsentBytes.Num() - total_sent, out_sent))
+		{
+			// A full socket buffer is retried on the next loop, anything else loses the connection
+			b_failed = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetLastErrorCode() != SE_EWOULDBLOCK;
+			break;
+		}
+		if(out_sent <= 0)
+		{
+			break;
+		}
+		total_sent += out_sent;
+	}
+	UnsentBytes.RemoveAt(0, total_sent, false);
+
+	if(b_failed)
+	{
+		LoseConnection(TEXT("Could not send to server"));
+		return false;
+	}
+	return true;
+}
+
+void FTwitchMessageReceiver::LoseConnection(const FString& reason)
+{
+	// Report it once, whichever path noticed it first
+	if(bConnectionLost)
+	{
+		return;
+	}
+	bConnectionLost = true;
+	ShouldExit = true;
+	UnsentBytes.Reset();
+
+	PostConnectionMessage(ETwitchConnectionMessageType::ERROR, reason);
+	PostConnectionMessage(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Lost connection to server"));
+	SetConnected(false);
+	FTwitchStats::Get().Disconnects.Increment();
+}
+
+void FTwitchMessageReceiver::Stop()
+{
+	ShouldExit = true;
+	SendEvent->Trigger();
+}
+
+void FTwitchMessageReceiver::Exit()
+{
+	// Followers must hear that the shared connection ended, whichever way it did
+	if(bIsShared)
+	{
+		FScopeLock lock(&FollowersLock);
+		if(FinalMessage.Value.IsEmpty())
+		{
+			FinalMessage = TwitchConnectionPair(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Shared connection ended"));
+			for(FTwitchMessageReceiver* follower : Followers)
+			{
+				follower->DeliverConnectionMessage(FinalMessage.Key, FinalMessage.Value);
+			}
+			bSessionConnected = false;
+		}
+	}
+	bIsFinished = true;
+}
+
+void FTwitchMessageReceiver::PullMessages(TArray<FTwitchChatMessage>& messagesOut)
+{
+	if(ReceivingQueue.IsValid() && !ReceivingQueue->IsEmpty())
+	{
+		FTwitchReceiveMessages message;
+		while(ReceivingQueue->Dequeue(message))
+		{
+			FTwitchStats::Get().ReceiveQueueDepth.Subtract(message.Messages.Num());
+			messagesOut.Append(MoveTemp(message.Messages));
+		}
+	}
+}
+
+bool FTwitchMessageReceiver::SendMessage(const ETwitchSendMessageType type, const FString& message, const FString& channel)
+{
+	if(Source.IsValid())
+	{
+		return Source->SendMessage(type, message, channel);
+	}
+
+	// Anonymous and read connections can only read, reject chat before it reaches the socket
+	if(!CanSendChat() && type == ETwitchSendMessageType::CHAT_MESSAGE)
+	{
+		return false;
+	}
+
+	if(SendingQueue.IsValid())
+	{
+		FTwitchStats::Get().SendQueueDepth.Increment();
+		SendingQueue->Enqueue(FTwitchSendMessage {type, message, channel});
+		SendEvent->Trigger();
+		return true;
+	}
+
+	return false;
+}
+
+bool FTwitchMessageReceiver::SendMessage(FTwitchSendMessage&& message)
+{
+	if(Source.IsValid())
+	{
+		return Source->SendMessage(MoveTemp(message));
+	}
+
+	if(!CanSendChat() && message.Type == ETwitchSendMessageType::CHAT_MESSAGE)
+	{
+		return false;
+	}
+
+	if(SendingQueue.IsValid())
+	{
+		FTwitchStats::Get().SendQueueDepth.Increment();
+		SendingQueue->Enqueue(MoveTemp(message));
+		SendEvent->Trigger();
+		return true;
+	}
+
+	return false;
+}
+
+bool FTwitchMessageReceiver::PullConnectionMessage(ETwitchConnectionMessageType& statusOut, FString& messageOut)
+{
+	TwitchConnectionPair connectionPair;
+	if(ConnectionQueue->Dequeue(connectionPair))
+	{
+		statusOut = connectionPair.Key;
+		messageOut = connectionPair.Value;
+		return true;
+	}
+
+	return false;
+}
+
+void FTwitchMessageReceiver::StopConnection(bool waitTillComplete)
+{
+	if(Source.IsValid())
+	{
+		// The announcements of this world must not outlive it on a connection other worlds keep open
+		for(const int32 announcementId : FollowerAnnouncements)
+		{
+			Source->CancelAnnouncement(announcementId);
+		}
+		FollowerAnnouncements.Empty();
+
+		// Leave the shared connection, the last follower closes it
+		if(Source->RemoveFollower(*this) == 0)
+		{
+			Source->StopConnection(waitTillComplete);
+		}
+		Source = nullptr;
+
+		// Detached, the game thread is the only one queueing on this receiver now
+		bIsConnected = false;
+		ConnectionQueue->Enqueue(TwitchConnectionPair(ETwitchConnectionMessageType::DISCONNECTED, TEXT("Left the shared connection")));
+		return;
+	}
+
+	if(MessagesThread)
+	{
+		ShouldExit = true;
+		SendEvent->Trigger();
+		if(waitTillComplete)
+		{
+			MessagesThread->Kill(true);
+		}
+	}
+}
+
+void FTwitchMessageReceiver::SetCommandRules(const FTwitchCommandRulesPtr& rules)
+{
+	FScopeLock lock(&CommandRulesLock);
+	CommandRules = rules;
+}
+
+void FTwitchMessageReceiver::SetUserFilter(const FTwitchUserFilterPtr& filter)
+{
+	FScopeLock lock(&UserFilterLock);
+	UserFilter = filter;
+}
+
+void FTwitchMessageReceiver::SetChatStages(const FTwitchChatStagesPtr& stages)
+{
+	FScopeLock lock(&ChatStagesLock);
+	ChatStages = stages;
+}
+
+void FTwitchMessageReceiver::ApplyUserFilter(TArray<FTwitchChatMessage>& messages)
+{
+	FTwitchUserFilterPtr filter;
+	{
+		FScopeLock lock(&UserFilterLock);
+		filter = UserFilter;
+	}
+
+	if(filter.IsValid())
+	{
+		const int32 filtered = messages.RemoveAll([&filter](const FTwitchChatMessage& message)
+		{
+			return !filter->IsAllowed(message);
+		});
+		FTwitchStats::Get().MessagesFiltered.Add(filtered);
+	}
+}
+
+FTwitchCommandRulesPtr FTwitchMessageReceiver::GetCommandRules()
+{
+	FScopeLock lock(&CommandRulesLock);
+	return CommandRules;
+}
+
+void FTwitchMessageReceiver::ApplyCommandRules(const FTwitchCommandRulesPtr& rules, TArray<FTwitchChatMessage>& messages)
+{
+	if(!rules.IsValid())
+	{
+		return;
+	}
+
+	// Assets of the commands found are streamed in while the commands travel to the game thread
+	FTwitchAssetPrefetcherPtr prefetcher = rules->Prefetcher.Pin();
+	TArray<FSoftObjectPath> prefetch_assets;
+
+	// Commands the sender is not allowed to use are cleared here, the game thread only sees authorized commands
+	int32 rejected = 0;
+	for(FTwitchChatMessage& message : messages)
+	{
+		bool b_rejected;
+		const FTwitchCommandRule* rule = rules->ParseCommand(message.Message, message.Roles, message.Command, message.Options, &b_rejected);
+		if(rule != nullptr && prefetcher.IsValid())
+		{
+			rules->GetCommandAssets(message.Command, message.Options, prefetch_assets);
+		}
+		message.bCommandRejected = b_rejected;
+		rejected += b_rejected ? 1 : 0;
+	}
+	if(rejected > 0)
+	{
+		FTwitchStats::Get().CommandsRejected.Add(rejected);
+	}
+
+	// One request for the whole batch
+	if(prefetch_assets.Num() > 0)
+	{
+		prefetcher->RequestFromAnyThread(prefetch_assets);
+	}
+}
+
+void FTwitchMessageReceiver::ApplyChatStages(const TArray<FTwitchChatMessage>& messages)
+{
+	FTwitchChatStagesPtr stages;
+	{
+		FScopeLock lock(&ChatStagesLock);
+		stages = ChatStages;
+	}
+
+	if(stages.IsValid())
+	{
+		for(const FTwitchChatStagePtr& stage : *stages)
+		{
+			stage->ProcessMessages(messages);
+		}
+	}
+}
+
+void FTwitchMessageReceiver::ApplyChatDepartures(const TArray<FString>& usernames)
+{
+	FTwitchChatStagesPtr stages;
+	{
+		FScopeLock lock(&ChatStagesLock);
+		stages = ChatStages;
+	}
+
+	if(stages.IsValid())
+	{
+		for(const FTwitchChatStagePtr& stage : *stages)
+		{
+			stage->ProcessDepartures(usernames);
+		}
+	}
+}
+
+void FTwitchMessageReceiver::CoalesceCommands(const FTwitchCommandRulesPtr& rules, TArray<FTwitchChatMessage>& messages)
+{
+	if(!rules.IsValid())
+	{
+		return;
+	}
+
+	// Commands that coalesce are taken out of the batch, they are queued once their window closes
+	int32 kept = 0;
+	for(int32 index = 0; index < messages.Num(); ++index)
+	{
+		FTwitchChatMessage& message = messages[index];
+		const FTwitchCommandRule* rule = message.Command.IsEmpty() ? nullptr : rules->Commands.Find(message.Command);
+		if(rule != nullptr && rule->CoalesceSeconds > 0.0f)
+		{
+			CoalesceCommand(MoveTemp(message), *rule);
+			continue;
+		}
+
+		if(kept != index)
+		{
+			messages[kept] = MoveTemp(message);
+		}
+		++kept;
+	}
+	messages.SetNum(kept, false);
+}
+
+void FTwitchMessageReceiver::CoalesceCommand(FTwitchChatMessage&& message, const FTwitchCommandRule& rule)
+{
+	FString key = message.Command;
+	for(const FString& option : message.Options)
+	{
+		key += TEXT("\n");
+		key += option;
+	}
+
+	if(FTwitchChatMessage* batch = CoalescingBatches.Find(key))
+	{
+		++batch->Count;
+		if(batch->Senders.Num() < rule.MaxCoalescedSenders)
+		{
+			batch->Senders.AddUnique(message.Username);
+		}
+		return;
+	}
+
+	// First of its kind, it becomes the batch
+	message.bIsCoalesced = true;
+	message.Count = 1;
+	if(rule.MaxCoalescedSenders > 0)
+	{
+		message.Senders.Add(message.Username);
+	}
+	CoalescingBatches.Add(key, MoveTemp(message));
+
+	Timers.Schedule(rule.CoalesceSeconds, [this, key]()
+	{
+		FTwitchReceiveMessages flushed;
+		flushed.Messages.AddDefaulted();
+		if(CoalescingBatches.RemoveAndCopyValue(key, flushed.Messages[0]))
+		{
+			FTwitchStats::Get().ReceiveQueueDepth.Increment();
+			ReceivingQueue->Enqueue(MoveTemp(flushed));
+		}
+	});
+}
+
+void FTwitchMessageReceiver::WaitForIncomingData(float maxSeconds)
+{
+	ConnectionSocket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(maxSeconds));
+}
+
+void FTwitchMessageReceiver::WaitForSendWork(float maxSeconds)
+{
+	// Sleep until something is queued. While rate limited the send timer bounds maxSeconds.
+	const bool bHasWork = !SendingQueue->IsEmpty() || AnnouncementSends.Num() > 0;
+	if(!bHasWork || !bSendAllowed)
+	{
+		SendEvent->Wait(FTimespan::FromSeconds(maxSeconds));
+	}
+}
+
+void FTwitchMessageReceiver::RunOnReceiverThread(TFunction<void()>&& task)
+{
+	if(ReceiverTasks.IsValid())
+	{
+		ReceiverTasks->Enqueue(MoveTemp(task));
+		SendEvent->Trigger();
+	}
+}
+
+void FTwitchMessageReceiver::RunReceiverTasks()
+{
+	TFunction<void()> task;
+	while(ReceiverTasks->Dequeue(task))
+	{
+		task();
+	}
+}
+
+void FTwitchMessageReceiver::SendNextMessage()
+{
+	// Send our messages
+	FTwitchSendMessage sendMessage;
+	if(AnnouncementSends.Num() > 0)
+	{
+		sendMessage = MoveTemp(AnnouncementSends[0]);
+		AnnouncementSends.RemoveAt(0);
+	}
+	else if(SendingQueue->Dequeue(sendMessage))
+	{
+		FTwitchStats::Get().SendQueueDepth.Decrement();
+	}
+	else
+	{
+		return;
+	}
+
+	if(sendMessage.Type == ETwitchSendMessageType::CHAT_MESSAGE)
+	{
+		if(!sendMessage.Channel.IsEmpty())
+		{
+			// Specific user private message
+			CountSend(SendChatLine(sendMessage, sendMessage.Channel));
+		}
+		else if(!Channel.IsEmpty())
+		{
+			// To the currently joined channel
+			CountSend(SendChatLine(sendMessage, Channel));
+		}
+		else
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::ERROR,
+				TEXT("Cannot send message. No channel specified, and not joined to a channel."));
+		}
+	}
+	else if(sendMessage.Type == ETwitchSendMessageType::JOIN_MESSAGE)
+	{
+		if(!Channel.IsEmpty())
+		{
+			SendIRCMessage(TEXT("PART #") + Channel);
+		}
+		Channel = sendMessage.Channel;
+		if(!Channel.IsEmpty())
+		{
+			SendIRCMessage(TEXT("JOIN #") + Channel);
+		}
+	}
+
+	// Hold further messages until the time between messages has passed
+	bSendAllowed = false;
+	Timers.Schedule(TimeBetweenMessages, [this]()
+	{
+		bSendAllowed = true;
+		if(!SendingQueue->IsEmpty() || AnnouncementSends.Num() > 0)
+		{
+			FTwitchStats::Get().RateLimitWaits.Increment();
+		}
+	});
+}
+
+void FTwitchMessageReceiver::CountSend(const bool bSent)
+{
+	FTwitchStats& stats = FTwitchStats::Get();
+	if(bSent)
+	{
+		stats.MessagesSent.Increment();
+	}
+	else
+	{
+		stats.SendFailures.Increment();
+	}
+}
+
+void FTwitchMessageReceiver::PostConnectionMessage(const ETwitchConnectionMessageType type, const FString& message)
+{
+	if(!bIsShared)
+	{
+		ConnectionQueue->Enqueue(TwitchConnectionPair(type, message));
+		return;
+	}
+
+	FScopeLock lock(&FollowersLock);
+	if(type == ETwitchConnectionMessageType::CONNECTED)
+	{
+		bSessionConnected = true;
+	}
+	else if(type == ETwitchConnectionMessageType::FAILED_TO_CONNECT || type == ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE
+		|| type == ETwitchConnectionMessageType::DISCONNECTED)
+	{
+		bSessionConnected = false;
+		FinalMessage = TwitchConnectionPair(type, message);
+	}
+
+	for(FTwitchMessageReceiver* follower : Followers)
+	{
+		follower->DeliverConnectionMessage(type, message);
+	}
+}
+
+void FTwitchMessageReceiver::DeliverConnectionMessage(const ETwitchConnectionMessageType type, const FString& message)
+{
+	// Followers don't own a connection, they only mirror the state of the shared one and stay out of the connected stat
+	if(type == ETwitchConnectionMessageType::CONNECTED)
+	{
+		bIsConnected = true;
+	}
+	else if(type == ETwitchConnectionMessageType::FAILED_TO_CONNECT || type == ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE
+		|| type == ETwitchConnectionMessageType::DISCONNECTED)
+	{
+		bIsConnected = false;
+	}
+	ConnectionQueue->Enqueue(TwitchConnectionPair(type, message));
+}
+
+void FTwitchMessageReceiver::ProcessReceived(TArray<FTwitchChatMessage>&& messages, const TArray<FString>& departures)
+{
+	if(departures.Num())
+	{
+		ApplyChatDepartures(departures);
+	}
+	if(messages.Num() == 0)
+	{
+		return;
+	}
+
+	ApplyUserFilter(messages);
+	const FTwitchCommandRulesPtr rules = GetCommandRules();
+	ApplyCommandRules(rules, messages);
+	ApplyChatStages(messages);
+	CoalesceCommands(rules, messages);
+	if(messages.Num())
+	{
+		FTwitchStats::Get().ReceiveQueueDepth.Add(messages.Num());
+		ReceivingQueue->Enqueue(FTwitchReceiveMessages {MoveTemp(messages)});
+	}
+}
+
+void FTwitchMessageReceiver::DeliverToFollowers(TArray<FTwitchChatMessage>&& messages, const TArray<FString>& departures)
+{
+	FScopeLock lock(&FollowersLock);
+	for(int32 index = 0; index < Followers.Num(); ++index)
+	{
+		// Each world filters and authorizes with its own rules, so each gets its own copy. The last one takes the parsed messages.
+		if(index == Followers.Num() - 1)
+		{
+			Followers[index]->ProcessReceived(MoveTemp(messages), departures);
+		}
+		else
+		{
+			Followers[index]->ProcessReceived(TArray<FTwitchChatMessage>(messages), departures);
+		}
+	}
+}
+
+double FTwitchMessageReceiver::AdvanceFollowerTimers(const double maxSeconds)
+{
+	double next_timer = maxSeconds;
+	FScopeLock lock(&FollowersLock);
+	for(FTwitchMessageReceiver* follower : Followers)
+	{
+		follower->Timers.Advance();
+		next_timer = follower->Timers.GetSecondsUntilNextTimer(next_timer);
+	}
+	return next_timer;
+}
+
+void FTwitchMessageReceiver::AddFollower(FTwitchMessageReceiver& follower)
+{
+	FScopeLock lock(&FollowersLock);
+	Followers.Add(&follower);
+
+	// Display lines are built once for everyone as soon as one follower wants them
+	if(follower.bBuildDisplayLines)
+	{
+		bBuildDisplayLines = true;
+	}
+
+	// Late followers catch up with the state of the connection
+	if(bSessionConnected)
+	{
+		follower.DeliverConnectionMessage(ETwitchConnectionMessageType::CONNECTED, TEXT("Joined the shared connection"));
+	}
+	else if(!FinalMessage.Value.IsEmpty())
+	{
+		follower.DeliverConnectionMessage(FinalMessage.Key, FinalMessage.Value);
+	}
+}
+
+int32 FTwitchMessageReceiver::RemoveFollower(FTwitchMessageReceiver& follower)
+{
+	FScopeLock lock(&FollowersLock);
+	Followers.Remove(&follower);
+	return Followers.Num();
+}
+
+void FTwitchMessageReceiver::SetConnected(const bool bConnected)
+{
+	if(bIsConnected != bConnected)
+	{
+		bIsConnected = bConnected;
+		if(bConnected)
+		{
+			FTwitchStats::Get().Connected.Increment();
+		}
+		else
+		{
+			FTwitchStats::Get().Connected.Decrement();
+		}
+	}
+}
+
+void FTwitchMessageReceiver::SendPing()
+{
+	if(SendIRCMessage(TEXT("PING :tmi.twitch.tv")))
+	{
+		PingSentTime = FTwitchTimerWheel::Now();
+	}
+}
+
+void FTwitchMessageReceiver::ScheduleRoundTripProbe()
+{
+	Timers.Schedule(TwitchRoundTripProbeSeconds, [this]()
+	{
+		SendPing();
+		ScheduleRoundTripProbe();
+	});
+}
+
+void FTwitchMessageReceiver::ResetKeepAlive()
+{
+	Timers.Cancel(KeepAliveTimer);
+	KeepAliveTimer = Timers.Schedule(TwitchKeepAliveIdleSeconds, [this]()
+	{
+		// The server has been quiet for too long, PING it and give it a few seconds to answer
+		SendPing();
+		KeepAliveTimer = Timers.Schedule(TwitchKeepAliveReplySeconds, [this]()
+		{
+			LoseConnection(TEXT("Server stopped responding"));
+		});
+	});
+}
+
+int32 FTwitchMessageReceiver::ScheduleAnnouncement(const FString& message, const FString& channel, const float delaySeconds, const float repeatSeconds)
+{
+	if(Source.IsValid())
+	{
+		const int32 announcementId = Source->ScheduleAnnouncement(message, channel, delaySeconds, repeatSeconds);
+		if(announcementId != INDEX_NONE)
+		{
+			FollowerAnnouncements.Add(announcementId);
+		}
+		return announcementId;
+	}
+
+	if(!CanSendChat())
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 announcementId = NextAnnouncementId.Increment();
+	RunOnReceiverThread([this, announcementId, message, channel, delaySeconds, repeatSeconds]()
+	{
+		Announcements.Add(announcementId, Timers.Schedule(delaySeconds, [this, announcementId, message, channel, repeatSeconds]()
+		{
+			FireAnnouncement(announcementId, message, channel, repeatSeconds);
+		}));
+	});
+	return announcementId;
+}
+
+void FTwitchMessageReceiver::FireAnnouncement(const int32 announcementId, const FString& message, const FString& channel, const float repeatSeconds)
+{
+	AnnouncementSends.Add(FTwitchSendMessage {ETwitchSendMessageType::CHAT_MESSAGE, message, channel});
+
+	if(repeatSeconds > 0.0f)
+	{
+		Announcements.Add(announcementId, Timers.Schedule(repeatSeconds, [this, announcementId, message, channel, repeatSeconds]()
+		{
+			FireAnnouncement(announcementId, message, channel, repeatSeconds);
+		}));
+	}
+	else
+	{
+		Announcements.Remove(announcementId);
+	}
+}
+
+void FTwitchMessageReceiver::CancelAnnouncement(const int32 announcementId)
+{
+	if(Source.IsValid())
+	{
+		FollowerAnnouncements.RemoveSwap(announcementId);
+		Source->CancelAnnouncement(announcementId);
+		return;
+	}
+
+	RunOnReceiverThread([this, announcementId]()
+	{
+		FTwitchTimerHandle handle;
+		if(Announcements.RemoveAndCopyValue(announcementId, handle))
+		{
+			Timers.Cancel(handle);
+		}
+	});
+}
+
+FString FTwitchMessageReceiver::ReceiveFromConnection()
+{
+	uint32 data_size;
+	if (ConnectionSocket->HasPendingData(data_size))
+	{
+		// Append behind the partial line left by the previous receive
+		const int32 offset = ReceiveBuffer.Num();
+		ReceiveBuffer.AddUninitialized(data_size);
+		int32 data_read = 0;
+		ConnectionSocket->Recv(ReceiveBuffer.GetData() + offset, data_size, data_read);
+		ReceiveBuffer.SetNum(offset + FMath::Max(data_read, 0), false);
+	}
+
+	// Only decode complete lines. A line cut by the TCP segment, and any UTF-8 sequence in it, waits for the rest.
+	int32 lines_end = ReceiveBuffer.Num();
+	while (lines_end > 0 && ReceiveBuffer[lines_end - 1] != '\n')
+	{
+		--lines_end;
+	}
+
+	FString connectionMessage;
+	if (lines_end > 0)
+	{
+		const FUTF8ToTCHAR converted(reinterpret_cast<const ANSICHAR*>(ReceiveBuffer.GetData()), lines_end);
+		connectionMessage = FString(converted.Length(), converted.Get());
+		ReceiveBuffer.RemoveAt(0, lines_end, false);
+	}
+
+	return connectionMessage;
+}
+
+void FTwitchMessageReceiver::ParseTags(FString& line, FTwitchChatMessage& messageOut, FTwitchDisplayTags* displayTagsOut)
+{
+	// Tagged lines are in the form "@key=value;key=value :twitch_username!twitch_username@... PRIVMSG #channel :message here"
+	int32 tags_end;
+	if(!line.StartsWith(TEXT("@")) || !line.FindChar(TEXT(' '), tags_end))
+	{
+		return;
+	}
+
+	TArray<FString> tags;
+	line.Mid(1, tags_end - 1).ParseIntoArray(tags, TEXT(";"));
+	line = line.RightChop(tags_end + 1);
+
+	for(const FString& tag : tags)
+	{
+		FString key, value;
+		if(!tag.Split(TEXT("="), &key, &value) || value.IsEmpty())
+		{
+			continue;
+		}
+
+		if(key == TEXT("badges"))
+		{
+			// Only a handful of distinct badge sets show up in a channel, intern them instead of parsing each one
+			if(const ETwitchUserRole* cached_roles = BadgeRolesCache.Find(value))
+			{
+				messageOut.Roles = *cached_roles;
+			}
+			else
+			{
+				if(BadgeRolesCache.Num() >= 4096)
+				{
+					BadgeRolesCache.Reset();
+				}
+				messageOut.Roles = FTwitchCommandRules::GetRolesFromBadges(value);
+				BadgeRolesCache.Add(value, messageOut.Roles);
+			}
+		}
+		else if(key == TEXT("user-id"))
+		{
+			messageOut.UserKey = FTwitchChatMessage::MakeUserKey(value);
+		}
+		else if(key == TEXT("bits"))
+		{
+			messageOut.Bits = FCString::Atoi(*value);
+		}
+		else if(displayTagsOut != nullptr)
+		{
+			if(key == TEXT("emotes"))
+			{
+				displayTagsOut->Emotes = MoveTemp(value);
+			}
+			else if(key == TEXT("color"))
+			{
+				displayTagsOut->Color = MoveTemp(value);
+			}
+			else if(key == TEXT("display-name"))
+			{
+				displayTagsOut->DisplayName = MoveTemp(value);
+			}
+		}
+	}
+}
+
+void FTwitchMessageReceiver::ParseMessage(const FString& message, TArray<FTwitchChatMessage>& messagesOut, TArray<FString>& departuresOut)
+{
+	messagesOut.Reset();
+	departuresOut.Reset();
+	
+	TArray<FString> message_lines;
+	message.ParseIntoArrayLines(message_lines); // A single "message" from Twitch IRC could include multiple lines. Split them now
+	FTwitchStats::Get().LinesReceived.Add(message_lines.Num());
+
+	const double received_time = FTwitchTimerWheel::Now();
+	const bool b_build_display_lines = bBuildDisplayLines;
+
+	// Parse each line into its parts
+	// Each line from Twitch contains meta information and content
+	// Also need to check if the message is a PING sent from Twitch to check if the connection is alive
+	// This is in the form "PING :tmi.twitch.tv" to which we need to reply with "PONG :tmi.twitch.tv"
+	for (int32 cycle_line = 0; cycle_line < message_lines.Num(); cycle_line++)
+	{
+		// If we receive a PING immediately reply with a PONG and skip the line parsing
+		if (message_lines[cycle_line] == TEXT("PING :tmi.twitch.tv"))
+		{
+			SendIRCMessage(TEXT("PONG :tmi.twitch.tv"));
+			continue; // Skip line parsing
+		}
+
+		// Tags come first and may contain ":" themselves, take them off before splitting the line
+		FTwitchChatMessage chat_message;
+		FTwitchDisplayTags display_tags;
+		ParseTags(message_lines[cycle_line], chat_message, b_build_display_lines ? &display_tags : nullptr);
+
+		// Parsing line
+		// Basic message form is ":twitch_username!twitch_username@twitch_username.tmi.twitch.tv PRIVMSG #channel :message here"
+		// So we can split the message into two parts based off the ":" character: meta[0] and content[1..n]
+		// Also have to account for	possible ":" inside the content itself
+		TArray<FString> message_parts;
+		message_lines[cycle_line].ParseIntoArray(message_parts, TEXT(":"));
+		if(!message_parts.Num())
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]);
+			continue;
+		}
+
+		// Meta parsing
+		// Meta info is split by whitespaces
+		TArray<FString> meta;
+		message_parts[0].ParseIntoArrayWS(meta);
+		if(meta.Num() < 2)
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]);
+			continue;
+		}
+
+		// Reply to our own PING, nothing to report but the round trip
+		if(meta[1] == TEXT("PONG"))
+		{
+			if(PingSentTime > 0.0)
+			{
+				FTwitchStats::Get().RoundTripMicroseconds.Set(static_cast<int64>((received_time - PingSentTime) * 1000000.0));
+				PingSentTime = 0.0;
+			}
+			continue;
+		}
+
+		// Membership lines, in the form ":twitch_username!twitch_username@twitch_username.tmi.twitch.tv PART #channel"
+		// Joins are only requested for the parts, they are not reported
+		if(meta[1] == TEXT("JOIN") || meta[1] == TEXT("PART"))
+		{
+			FString departed_username;
+			if(meta[1] == TEXT("PART") && meta[0].Split(TEXT("!"), &departed_username, nullptr))
+			{
+				departuresOut.Add(MoveTemp(departed_username));
+			}
+			continue;
+		}
+
+		// Timeouts and bans are in the form ":tmi.twitch.tv CLEARCHAT #channel :twitch_username", a whole chat clear has no username
+		// They are still reported as server messages below
+		if(meta[1] == TEXT("CLEARCHAT") && message_parts.Num() > 1)
+		{
+			departuresOut.Add(message_parts[1].TrimStartAndEnd());
+		}
+
+		// Assume at this point the message is from a user, but just in case set it beforehand
+		// This is so that we can return an "empty" user if the message was of any other kind
+		// For example, messages from the server (like upon connection) don't have a username
+		FString sender_username;
+		if (meta[1] == TEXT("PRIVMSG")) // Type of message should always be in position 1 (or at least I hope so)
+		{
+			// Username should be the first part before the first "!"
+			meta[0].Split(TEXT("!"), &sender_username, nullptr);
+		}
+
+		if (sender_username.IsEmpty())
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::MESSAGE, message_lines[cycle_line]);
+			continue; // Skip line
+		}
+
+		// Some messages correspond to events sent by the server (JOIN etc.)
+		// In that case the message part is only one
+		if (message_parts.Num() > 1)
+		{
+			// Content of the message is composed by all parts of the message from message_parts[1] on
+			FString message_content = message_parts[1];
+			if (message_parts.Num() > 2)
+			{
+				for (int32 cycle_content = 2; cycle_content < message_parts.Num(); cycle_content++)
+				{
+					// Add back the ":" that was used as the splitter
+					message_content += TEXT(":") + message_parts[cycle_content];
+				}
+			}
+			if(chat_message.UserKey == 0)
+			{
+				// Untagged message, intern the name instead
+				chat_message.UserKey = FTwitchChatMessage::MakeUserKey(sender_username);
+			}
+			if(b_build_display_lines)
+			{
+				TSharedRef<FTwitchChatDisplayLine, ESPMode::ThreadSafe> display = MakeShared<FTwitchChatDisplayLine, ESPMode::ThreadSafe>();
+				display->DisplayName = display_tags.DisplayName.IsEmpty() ? sender_username : MoveTemp(display_tags.DisplayName);
+				if(!display_tags.Color.IsEmpty())
+				{
+					display->NameColor = FLinearColor(FColor::FromHex(display_tags.Color));
+					display->bHasNameColor = true;
+				}
+				FTwitchChatDisplayLine::BuildRuns(message_content, display_tags.Emotes, display->Runs);
+				chat_message.Display = display;
+			}
+			chat_message.Username = MoveTemp(sender_username);
+			chat_message.ReceivedTime = received_time;
+			chat_message.Message = MoveTemp(message_content);
+			messagesOut.Add(MoveTemp(chat_message));
+		}
+		else if(message_parts.Num())
+		{
+			PostConnectionMessage(ETwitchConnectionMessageType::MESSAGE, message_parts[0]);
+		}
+	}
+
+	FTwitchStats::Get().MessagesReceived.Add(messagesOut.Num());
+}
+
+// Sets default values for this component's properties
+UTwitchIRCComponent::UTwitchIRCComponent()
+	: TimeBetweenChatMessages(1.2f)
+	, bSplitReadWriteConnections(false)
+	, bAnonymousReadConnection(false)
+	, ChatHistorySize(0)
+	, bIndexChatHistory(false)
+	, bBuildDisplayLines(false)
+	, bAggregateChat(false)
+	, AggregatesName(TEXT("Chat"))
+	, HeatmapCommand(TEXT("tap"))
+	, HeatmapSize(16)
+	, NumTopEmotes(8)
+	, AggregatesHalfLife(2.0f)
+	, TwitchMessageReceiver(nullptr)
+	, TwitchWriteReceiver(nullptr)
+	, UserFilterGeneration(0)
+	, bHasConnected(false)
+{
+#if WITH_EDITORONLY_DATA
+	bSharePIEConnection = false;
+#endif
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	EmoteCache = CreateDefaultSubobject<UTwitchEmoteCache>(TEXT("EmoteCache"));
+}
+
+void UTwitchIRCComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if(TwitchMessageReceiver.IsValid())
+	{
+		bool stillConnected = PullConnectionMessages(*TwitchMessageReceiver);
+		if(TwitchWriteReceiver.IsValid())
+		{
+			stillConnected = PullConnectionMessages(*TwitchWriteReceiver) && stillConnected;
+		}
+
+		if(!stillConnected)
+		{
+			// The thread may still be closing its socket after posting the disconnect, wait for it before releasing the receiver.
+			// Split connections live and die together.
+			TwitchMessageReceiver->StopConnection(true);
+			if(TwitchWriteReceiver.IsValid())
+			{
+				TwitchWriteReceiver->StopConnection(true);
+			}
+			PrimaryComponentTick.SetTickFunctionEnable(false);
+			TwitchMessageReceiver = nullptr;
+			TwitchWriteReceiver = nullptr;
+			HandleDisconnected();
+		}
+		else
+		{
+			CSV_SCOPED_TIMING_STAT(TwitchPlay, Dispatch);
+
+			TArray<FTwitchChatMessage> messages;
+			TwitchMessageReceiver->PullMessages(messages);
+			CSV_CUSTOM_STAT(TwitchPlay, MessagesDispatched, messages.Num(), ECsvCustomStatOp::Accumulate);
+			if(messages.Num() > 0)
+			{
+				// Time the oldest message of the frame waited since it was read. Coalesced batches wait for their window on purpose.
+				const double now = FTwitchTimerWheel::Now();
+				double latency = 0.0;
+				for(const FTwitchChatMessage& chatMessage : messages)
+				{
+					if(!chatMessage.bIsCoalesced)
+					{
+						latency = FMath::Max(latency, now - chatMessage.ReceivedTime);
+					}
+				}
+				FTwitchStats::Get().DispatchLatencyMicroseconds.Set(static_cast<int64>(latency * 1000000.0));
+			}
+			for(const FTwitchChatMessage& chatMessage : messages)
+			{
+				// Merged commands are a single dispatch, not chat messages
+				if(!chatMessage.bIsCoalesced)
+				{
+					OnMessageReceived.Broadcast(chatMessage.Message, chatMessage.Username);
+					if(chatMessage.Display.IsValid())
+					{
+						OnChatLineReceived.Broadcast(chatMessage.Message, chatMessage.Username, *chatMessage.Display);
+					}
+				}
+				HandleChatMessage(chatMessage);
+			}
+
+			PublishChatAggregates(DeltaTime);
+		}
+	}
+	else
+	{
+		PrimaryComponentTick.SetTickFunctionEnable(false);
+	}
+}
+
+bool UTwitchIRCComponent::PullConnectionMessages(FTwitchMessageReceiver& receiver)
+{
+	bool stillConnected = true;
+	ETwitchConnectionMessageType status; FString message;
+	while(receiver.PullConnectionMessage(status, message))
+	{
+		OnConnectionMessage.Broadcast(status, message);
+		if(status == ETwitchConnectionMessageType::CONNECTED && &receiver == TwitchMessageReceiver.Get())
+		{
+			if(bHasConnected)
+			{
+				FTwitchStats::Get().Reconnects.Increment();
+			}
+			bHasConnected = true;
+		}
+		if(status == ETwitchConnectionMessageType::FAILED_TO_CONNECT ||
+			status == ETwitchConnectionMessageType::FAILED_TO_AUTHENTICATE ||
+			status == ETwitchConnectionMessageType::DISCONNECTED)
+		{
+			stillConnected = false;
+		}
+	}
+
+	return stillConnected;
+}
+
+void UTwitchIRCComponent::SetCommandRules(const FTwitchCommandRulesPtr& rules)
+{
+	CommandRules = rules;
+	if(TwitchMessageReceiver.IsValid())
+	{
+		TwitchMessageReceiver->SetCommandRules(rules);
+	}
+	if(ChatAggregator.IsValid() && rules.IsValid())
+	{
+		ChatAggregator->SetDelimiters(rules->CommandDelimiter, rules->OptionsDelimiter);
+	}
+}
+
+void UTwitchIRCComponent::SetUserBlocklist(const TArray<FString>& users)
+{
+	BuildUserFilter(users, false);
+}
+
+void UTwitchIRCComponent::SetUserAllowlist(const TArray<FString>& users)
+{
+	BuildUserFilter(users, true);
+}
+
+void UTwitchIRCComponent::ClearUserFilter()
+{
+	++UserFilterGeneration;
+	SetUserFilter(nullptr);
+}
+
+void UTwitchIRCComponent::BuildUserFilter(const TArray<FString>& users, const bool bIsAllowlist)
+{
+	const int32 generation = ++UserFilterGeneration;
+	TWeakObjectPtr<UTwitchIRCComponent> weakThis(this);
+
+	// Sorting and hashing hundreds of thousands of users would hitch, build the filter on a worker and swap it in when done
+	Async(EAsyncExecution::ThreadPool, [weakThis, users, bIsAllowlist, generation]()
+	{
+		FTwitchUserFilterPtr filter = MakeShared<const FTwitchUserFilter, ESPMode::ThreadSafe>(users, bIsAllowlist);
+		AsyncTask(ENamedThreads::GameThread, [weakThis, filter, generation]()
+		{
+			UTwitchIRCComponent* component = weakThis.Get();
+			if(component != nullptr && component->UserFilterGeneration == generation)
+			{
+				component->SetUserFilter(filter);
+			}
+		});
+	});
+}
+
+void UTwitchIRCComponent::SetUserFilter(const FTwitchUserFilterPtr& filter)
+{
+	UserFilter = filter;
+	if(TwitchMessageReceiver.IsValid())
+	{
+		TwitchMessageReceiver->SetUserFilter(filter);
+	}
+}
+
+void UTwitchIRCComponent::AddChatStage(const FTwitchChatStagePtr& stage)
+{
+	if(stage.IsValid())
+	{
+		ChatStages.AddUnique(stage);
+		PublishChatStages();
+	}
+}
+
+void UTwitchIRCComponent::RemoveChatStage(const FTwitchChatStagePtr& stage)
+{
+	if(ChatStages.Remove(stage) > 0)
+	{
+		PublishChatStages();
+	}
+}
+
+void UTwitchIRCComponent::PublishChatStages()
+{
+	if(TwitchMessageReceiver.IsValid())
+	{
+		TwitchMessageReceiver->SetChatStages(ChatStages.Num() > 0 ? MakeShared<const TArray<FTwitchChatStagePtr>, ESPMode::ThreadSafe>(ChatStages) : nullptr);
+	}
+}
+
+void UTwitchIRCComponent::CreateReadReceiver()
+{
+	TwitchMessageReceiver = MakeUnique<FTwitchMessageReceiver>();
+	TwitchMessageReceiver->SetCommandRules(CommandRules);
+	TwitchMessageReceiver->SetUserFilter(UserFilter);
+	TwitchMessageReceiver->SetBuildDisplayLines(bBuildDisplayLines);
+	if(!ChatHistory.IsValid() && ChatHistorySize > 0)
+	{
+		ChatHistory = MakeShared<FTwitchChatHistory, ESPMode::ThreadSafe>(ChatHistorySize, bIndexChatHistory);
+		ChatStages.Add(ChatHistory);
+	}
+	if(!ChatAggregator.IsValid() && bAggregateChat)
+	{
+		ChatAggregator = MakeShared<FTwitchChatAggregator, ESPMode::ThreadSafe>(HeatmapCommand, HeatmapSize, NumTopEmotes, AggregatesHalfLife);
+		if(CommandRules.IsValid())
+		{
+			ChatAggregator->SetDelimiters(CommandRules->CommandDelimiter, CommandRules->OptionsDelimiter);
+		}
+		ChatStages.Add(ChatAggregator);
+	}
+	PublishChatStages();
+}
+
+#if WITH_EDITOR
+bool UTwitchIRCComponent::ShouldSharePIEConnection() const
+{
+	const UWorld* world = GetWorld();
+	return bSharePIEConnection && world != nullptr && world->WorldType == EWorldType::PIE;
+}
+#endif
+
+FTwitchMessageReceiver* UTwitchIRCComponent::GetSendingReceiver() const
+{
+	return TwitchWriteReceiver.IsValid() ? TwitchWriteReceiver.Get() : TwitchMessageReceiver.Get();
+}
+
+void UTwitchIRCComponent::PublishChatAggregates(const float deltaSeconds)
+{
+	if(!ChatAggregator.IsValid())
+	{
+		return;
+	}
+
+	TSharedRef<FTwitchChatAggregates, ESPMode::ThreadSafe> aggregates = ChatAggregator->TakeSnapshot(deltaSeconds);
+
+	// Where the top emotes are in the emote atlas. Also gets them loading.
+	if(EmoteCache != nullptr)
+	{
+		for(int32 index = 0; index < aggregates->TopEmoteIds.Num(); ++index)
+		{
+			if(const FSlateBrush* brush = EmoteCache->FindBrush(aggregates->TopEmoteIds[index]))
+			{
+				const FBox2D uv_region = brush->GetUVRegion();
+				aggregates->TopEmoteUVs[index] = FVector4(uv_region.Min.X, uv_region.Min.Y, uv_region.Max.X, uv_region.Max.Y);
+			}
+		}
+	}
+
+	FTwitchChatAggregator::Publish(AggregatesName, this, GetWorld(), aggregates);
+}
+
+void UTwitchIRCComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if(ChatAggregator.IsValid())
+	{
+		FTwitchChatAggregator::Unpublish(AggregatesName, this);
+	}
+
+	if(TwitchMessageReceiver.IsValid())
+	{
+		TwitchMessageReceiver->StopConnection(true);
+	}
+	if(TwitchWriteReceiver.IsValid())
+	{
+		TwitchWriteReceiver->StopConnection(true);
+	}
+}
+
+void UTwitchIRCComponent::Connect(const FString& oauth, const FString& username, const FString& channel)
+{
+	if(TwitchMessageReceiver.IsValid())
+	{
+		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Already connected / connecting / pending!"));
+		return;
+	}
+	if(oauth.IsEmpty() || username.IsEmpty())
+	{
+		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Invalid connection parameters. Check your strings."));
+		return;
+	}
+
+#if WITH_EDITOR
+	if(ShouldSharePIEConnection())
+	{
+		if(bSplitReadWriteConnections)
+		{
+			UE_LOG(LogTwitchPlay, Warning, TEXT("TwitchPlay: %s shares the PIE connection, bSplitReadWriteConnections and bAnonymousReadConnection are ignored"),
+				*GetPathName());
+		}
+		CreateReadReceiver();
+		FTwitchPieSessions::Get().Follow(*TwitchMessageReceiver, oauth, username, channel, TimeBetweenChatMessages, false);
+		PrimaryComponentTick.SetTickFunctionEnable(true);
+		return;
+	}
+#endif
+
+	if(bSplitReadWriteConnections)
+	{
+		// Dedicated read connection, optionally anonymous so it does not use the bot account
+		CreateReadReceiver();
+		if(bAnonymousReadConnection)
+		{
+			TwitchMessageReceiver->StartAnonymousConnection(channel);
+		}
+		else
+		{
+			TwitchMessageReceiver->StartConnection(oauth, username, channel, TimeBetweenChatMessages, ETwitchConnectionRole::READ_ONLY);
+		}
+
+		// Authenticated write connection with its own loop
+		TwitchWriteReceiver = MakeUnique<FTwitchMessageReceiver>();
+		TwitchWriteReceiver->StartConnection(oauth, username, channel, TimeBetweenChatMessages, ETwitchConnectionRole::WRITE_ONLY);
+	}
+	else
+	{
+		// Create the connection and messaging thread
+		CreateReadReceiver();
+		TwitchMessageReceiver->StartConnection(oauth, username, channel, TimeBetweenChatMessages);
+	}
+	// Tick our component which pulls messages off the queue
+	PrimaryComponentTick.SetTickFunctionEnable(true);
+}
+
+void UTwitchIRCComponent::ConnectAnonymous(const FString& channel)
+{
+	if(TwitchMessageReceiver.IsValid())
+	{
+		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Already connected / connecting / pending!"));
+		return;
+	}
+
+	// Create the read-only connection and messaging thread
+	CreateReadReceiver();
+#if WITH_EDITOR
+	if(ShouldSharePIEConnection())
+	{
+		FTwitchPieSessions::Get().Follow(*TwitchMessageReceiver, TEXT(""), TEXT(""), channel, 0.0f, true);
+	}
+	else
+#endif
+	{
+		TwitchMessageReceiver->StartAnonymousConnection(channel);
+	}
+	// Tick our component which pulls messages off the queue
+	PrimaryComponentTick.SetTickFunctionEnable(true);
+}
+
+bool UTwitchIRCComponent::SendChatMessage(const FString& message, const FString channel)
+{
+	if(FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver())
+	{
+		if(!sendingReceiver->CanSendChat())
+		{
+			OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Cannot send messages on an anonymous read-only connection."));
+			return false;
+		}
+		return sendingReceiver->SendMessage(ETwitchSendMessageType::CHAT_MESSAGE, message, channel);
+	}
+
+	return false;
+}
+
+int32 UTwitchIRCComponent::ScheduleAnnouncement(const FString& message, const float delaySeconds, const float repeatSeconds, const FString channel)
+{
+	FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver();
+	if(sendingReceiver == nullptr || !sendingReceiver->CanSendChat())
+	{
+		return INDEX_NONE;
+	}
+
+	return sendingReceiver->ScheduleAnnouncement(message, channel, delaySeconds, repeatSeconds);
+}
+
+void UTwitchIRCComponent::CancelAnnouncement(const int32 announcementId)
+{
+	if(FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver())
+	{
+		sendingReceiver->CancelAnnouncement(announcementId);
+	}
+}
+
+bool UTwitchIRCComponent::SendWhisper(const FString& userName, const FString& message, const FString channel)
+{
+	if(FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver())
+	{
+		if(!sendingReceiver->CanSendChat())
+		{
+			OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Cannot send whispers on an anonymous read-only connection."));
+			return false;
+		}
+		const FString whisperMessage = FString::Printf(TEXT("/w %s %s"), *userName, *message);
+		return sendingReceiver->SendMessage(ETwitchSendMessageType::CHAT_MESSAGE, whisperMessage, channel);
+	}
+
+	return false;
+}
+
+int32 UTwitchIRCComponent::RegisterMessageTemplate(const FString& pattern)
+{
+	return MessageTemplates.Add(MakeShared<const FTwitchMessageTemplate, ESPMode::ThreadSafe>(pattern));
+}
+
+bool UTwitchIRCComponent::SendTemplateMessage(const int32 templateId, const TArray<FString>& arguments, const FString channel)
+{
+	return SendTemplate(FString(), templateId, arguments, channel);
+}
+
+bool UTwitchIRCComponent::SendTemplateWhisper(const FString& userName, const int32 templateId, const TArray<FString>& arguments, const FString channel)
+{
+	return SendTemplate(userName, templateId, arguments, channel);
+}
+
+bool UTwitchIRCComponent::SendTemplate(const FString& userName, const int32 templateId, const TArray<FString>& arguments, const FString& channel)
+{
+	if(!MessageTemplates.IsValidIndex(templateId))
+	{
+		OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, FString::Printf(TEXT("Unknown message template %d."), templateId));
+		return false;
+	}
+
+	if(FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver())
+	{
+		if(!sendingReceiver->CanSendChat())
+		{
+			OnConnectionMessage.Broadcast(ETwitchConnectionMessageType::ERROR, TEXT("Cannot send messages on an anonymous read-only connection."));
+			return false;
+		}
+
+		FTwitchSendMessage sendMessage { ETwitchSendMessageType::CHAT_MESSAGE, FString(), channel };
+		sendMessage.Template = MessageTemplates[templateId];
+		sendMessage.Arguments = arguments;
+		sendMessage.WhisperTarget = userName;
+		return sendingReceiver->SendMessage(MoveTemp(sendMessage));
+	}
+
+	return false;
+}
+
+void UTwitchIRCComponent::JoinChannel(const FString& channel)
+{
+	if(!TwitchMessageReceiver.IsValid())
+	{
+		return;
+	}
+
+	TwitchMessageReceiver->SendMessage(ETwitchSendMessageType::JOIN_MESSAGE, TEXT(""), channel);
+	if(TwitchWriteReceiver.IsValid())
+	{
+		TwitchWriteReceiver->SendMessage(ETwitchSendMessageType::JOIN_MESSAGE, TEXT(""), channel);
+	}
+}
+
+void UTwitchIRCComponent::Disconnect()
+{
+	if(!TwitchMessageReceiver.IsValid())
+	{
+		return;
+	}
+	
+	TwitchMessageReceiver->StopConnection(false);
+	if(TwitchWriteReceiver.IsValid())
+	{
+		TwitchWriteReceiver->StopConnection(false);
+	}
+}
+
+bool UTwitchIRCComponent::IsConnected() const
+{
+	return TwitchMessageReceiver.IsValid() && TwitchMessageReceiver->IsConnected() &&
+		(!TwitchWriteReceiver.IsValid() || TwitchWriteReceiver->IsConnected());
+}
+
+bool UTwitchIRCComponent::IsPendingConnection() const
+{
+	return TwitchMessageReceiver.IsValid() && !IsConnected();
+}
+
+bool UTwitchIRCComponent::IsAnonymous() const
+{
+	const FTwitchMessageReceiver* sendingReceiver = GetSendingReceiver();
+	return sendingReceiver != nullptr && sendingReceiver->IsAnonymous();
+}
+
+bool UTwitchIRCComponent::GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const
+{
+	if(!TwitchMessageReceiver.IsValid())
+	{
+		return false;
+	}
+
+	// The sending connection is the one logged in with the bot account
+	GetSendingReceiver()->GetConnectionInfo(oauthOut, usernameOut, channelOut);
+	return true;
+}
+
+void UTwitchIRCComponent::SearchChatHistory(const FString& text, const FString& username, const int32 maxResults, TArray<FTwitchChatHistoryEntry>& resultsOut) const
+{
+	resultsOut.Reset();
+	if(ChatHistory.IsValid())
+	{
+		ChatHistory->Search(text, username, maxResults, resultsOut);
+	}
+}
+
+void UTwitchIRCComponent::GetRecentChatHistory(const int32 count, TArray<FTwitchChatHistoryEntry>& messagesOut) const
+{
+	messagesOut.Reset();
+	if(ChatHistory.IsValid() && count > 0)
+	{
+		const uint64 newest_id = ChatHistory->GetNewestId();
+		const uint64 first_id = newest_id > static_cast<uint64>(count) ? newest_id - count + 1 : 1;
+		ChatHistory->GetRecords(first_id, count, messagesOut);
+	}
+}
@@ -1,137 +1,507 @@
-// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
-
-#define DEBUG_MSG(msg) GEngine->AddOnScreenDebugMessage( -1 , 6 , FColor::Red , msg ) 
-
-#include "Components/TwitchPlayComponent.h"
-
-UTwitchPlayComponent::UTwitchPlayComponent()
-{
-	bound_events_ = TMap<FString, FOnCommandReceived>();
-	OnMessageReceived.AddDynamic(this, &UTwitchPlayComponent::MessageReceivedHandler);
-}
-
-void UTwitchPlayComponent::SetupEncapsulationChars(const FString& _command_char, const FString& _options_char)
-{
-	command_encapsulation_char_ = _command_char;
-	options_encapsulation_char_ = _options_char;
-}
-
-bool UTwitchPlayComponent::RegisterCommand(const FString& _command_name, const FOnCommandReceived& _callback_function, FString& _out_result)
-{
-	// No reason to register an empty command
-	if (_command_name.IsEmpty())
-	{
-		_out_result = TEXT("Command type string is invalid");
-		return false;
-	}
-
-	// Pointer to the command in the event map, if present
-	// If the command is found I can use this to switch from the previous function and bind the new one
-	FOnCommandReceived* registered_command = bound_events_.Find(_command_name);
-
-	// If the command we want to register is already in the event map 
-	// copy the new delegate object info into it   
-	// For optimization purposes don't delete the entry in order to create a new one.
-	if (registered_command != nullptr)
-	{
-		*registered_command = _callback_function;
-		_out_result = _command_name + TEXT(" command registered. It overwrote a previous registration of the same type");
-	}
-	else
-	{
-		// If the command is not registered yet create a new entry for it
-		// and copy the incoming delegate object info to the new delegate object
-		bound_events_.Add(_command_name, _callback_function);
-		_out_result = _command_name + TEXT(" command registered");
-	}
-	return true;
-}
-
-bool UTwitchPlayComponent::UnregisterCommand(const FString& _command_name, FString& _out_result)
-{
-	// No reason to unregister an empty command 
-	if (_command_name == "")
-	{
-		_out_result = TEXT("Command type string is invalid");
-		return false;
-	}
-
-	if (bound_events_.Remove(_command_name) == 0)
-	{
-		_out_result = TEXT("No command of this type was registered");
-		return false;
-	}
-	
-	_out_result = _command_name + TEXT(" unregistered");
-	return true;
-}
-
-void UTwitchPlayComponent::MessageReceivedHandler(const FString & _message, const FString & _username)
-{
-	const FString command = GetCommandString(_message);
-
-	// No reason to search for the command in the event map, there isn't any
-	if (command.IsEmpty())
-	{
-		return;
-	}
-
-	FOnCommandReceived* registered_command = bound_events_.Find(command);
-
-	// If the command was registered proceed with finding any command options
-	// Then fire the event
-	if (registered_command != nullptr)
-	{
-		TArray<FString> command_options;
-		GetCommandOptionsStrings(_message, command_options);
-		registered_command->ExecuteIfBound(command, command_options, _username);
-	}
-}
-
-FString GetDelimitedString(const FString & _in_string, const FString & _delimiter)
-{
-	// No delimited string can be found on an empty string
-	if (_in_string.IsEmpty())
-	{
-		return TEXT("");
-	}
-
-	// Where does the delimiter start?
-	// Remember that the delimiter can be more than 1 character, so we need to add
-	// the delimiter length to find the actual start of the delimited string
-	const int32 command_start_index = _in_string.Find(_delimiter);
-
-	// If the message did not contain any start delimiter no command can be found
-	// Also, if the start delimiter is at the end of the string no command can be found
-	if (command_start_index == INDEX_NONE || command_start_index + _delimiter.Len() == _in_string.Len())
-	{
-		return TEXT("");
-	}
-
-	// Search for the end of the command delimiter
-	// The starting position for the search is the index of the previous delimiter plus 
-	// the actual length of the delimiter (start search from at least one char ahead)
-	const int32 command_end_index = _in_string.Find(_delimiter, ESearchCase::IgnoreCase, ESearchDir::FromStart, command_start_index + _delimiter.Len());
-
-	// If we did not find an end delimiter no encapsulated string can be found
-	if (command_end_index == INDEX_NONE)
-	{
-		return TEXT("");
-	}
-
-	// If we have the two delimiter positions get the string inbetween them
-	return _in_string.Mid(command_start_index + _delimiter.Len(), (command_end_index - (command_start_index + _delimiter.Len())));
-}
-
-FString UTwitchPlayComponent::GetCommandString(const FString & _message) const
-{
-	// Only the first command is accepted
-	FString ret_command = GetDelimitedString(_message, command_encapsulation_char_);
-	return ret_command;
-}
-
-void UTwitchPlayComponent::GetCommandOptionsStrings(const FString & _message, TArray<FString>& optionsOut) const
-{
-	const FString options = GetDelimitedString(_message, options_encapsulation_char_);
-	options.ParseIntoArray(optionsOut, TEXT(","));
-}
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#define DEBUG_MSG(msg) GEngine->AddOnScreenDebugMessage( -1 , 6 , FColor::Red , msg ) 
+
+#include "Components/TwitchPlayComponent.h"
+#include "Chat/TwitchStats.h"
+#include "Chat/TwitchCommandProfiler.h"
+
+DECLARE_CYCLE_STAT(TEXT("Command Dispatch"), STAT_TwitchPlayCommandDispatch, STATGROUP_TwitchPlay);
+
+UTwitchPlayComponent::UTwitchPlayComponent()
+{
+	bound_events_ = TMap<FString, FOnCommandReceived>();
+}
+
+void UTwitchPlayComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	// The encapsulation chars can be written directly from blueprints, make sure the receiver thread parses with the current ones
+	if (command_rules_.CommandDelimiter != command_encapsulation_char_ || command_rules_.OptionsDelimiter != options_encapsulation_char_)
+	{
+		PublishCommandRules();
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	DispatchPendingCommands();
+
+	PublishPollResults();
+
+	PublishChatterBatch();
+
+	if (asset_prefetcher_.IsValid())
+	{
+		asset_prefetcher_->SetRetainSeconds(prefetch_retain_seconds_);
+		asset_prefetcher_->ReleaseUnused();
+	}
+}
+
+void UTwitchPlayComponent::SetupEncapsulationChars(const FString& _command_char, const FString& _options_char)
+{
+	command_encapsulation_char_ = _command_char;
+	options_encapsulation_char_ = _options_char;
+	PublishCommandRules();
+}
+
+bool UTwitchPlayComponent::RegisterCommand(const FString& _command_name, const FOnCommandReceived& _callback_function, FString& _out_result, int32 _required_roles)
+{
+	// No reason to register an empty command
+	if (_command_name.IsEmpty())
+	{
+		_out_result = TEXT("Command type string is invalid");
+		return false;
+	}
+
+	// Pointer to the command in the event map, if present
+	// If the command is found I can use this to switch from the previous function and bind the new one
+	FOnCommandReceived* registered_command = bound_events_.Find(_command_name);
+
+	// If the command we want to register is already in the event map 
+	// copy the new delegate object info into it   
+	// For optimization purposes don't delete the entry in order to create a new one.
+	if (registered_command != nullptr)
+	{
+		*registered_command = _callback_function;
+		_out_result = _command_name + TEXT(" command registered. It overwrote a previous registration of the same type");
+	}
+	else
+	{
+		// If the command is not registered yet create a new entry for it
+		// and copy the incoming delegate object info to the new delegate object
+		bound_events_.Add(_command_name, _callback_function);
+		_out_result = _command_name + TEXT(" command registered");
+	}
+
+	// A command dispatches either one way or the other
+	bound_coalesced_events_.Remove(_command_name);
+
+	FTwitchCommandRule& rule = command_rules_.Commands.FindOrAdd(_command_name);
+	rule.RequiredRoles = static_cast<ETwitchUserRole>(_required_roles);
+	rule.CoalesceSeconds = 0.0f;
+	rule.MaxCoalescedSenders = 0;
+	PublishCommandRules();
+	return true;
+}
+
+bool UTwitchPlayComponent::RegisterCoalescedCommand(const FString& _command_name, const FOnCoalescedCommandReceived& _callback_function, FString& _out_result,
+	float _window_seconds, int32 _max_senders, int32 _required_roles)
+{
+	// No reason to register an empty command
+	if (_command_name.IsEmpty())
+	{
+		_out_result = TEXT("Command type string is invalid");
+		return false;
+	}
+
+	if (_window_seconds <= 0.0f)
+	{
+		_out_result = TEXT("Coalescing window must be above 0 seconds");
+		return false;
+	}
+
+	const bool b_overwrote = bound_events_.Remove(_command_name) > 0 || bound_coalesced_events_.Contains(_command_name);
+	bound_coalesced_events_.Add(_command_name, _callback_function);
+	_out_result = _command_name + (b_overwrote ? TEXT(" command registered. It overwrote a previous registration of the same type") : TEXT(" command registered"));
+
+	FTwitchCommandRule& rule = command_rules_.Commands.FindOrAdd(_command_name);
+	rule.RequiredRoles = static_cast<ETwitchUserRole>(_required_roles);
+	rule.CoalesceSeconds = _window_seconds;
+	rule.MaxCoalescedSenders = FMath::Max(_max_senders, 0);
+	PublishCommandRules();
+	return true;
+}
+
+bool UTwitchPlayComponent::UnregisterCommand(const FString& _command_name, FString& _out_result)
+{
+	// No reason to unregister an empty command 
+	if (_command_name == "")
+	{
+		_out_result = TEXT("Command type string is invalid");
+		return false;
+	}
+
+	if (bound_events_.Remove(_command_name) + bound_coalesced_events_.Remove(_command_name) == 0)
+	{
+		_out_result = TEXT("No command of this type was registered");
+		return false;
+	}
+
+	command_rules_.Commands.Remove(_command_name);
+	PublishCommandRules();
+	
+	_out_result = _command_name + TEXT(" unregistered");
+	return true;
+}
+
+void UTwitchPlayComponent::SetCommandPrefetchAssets(const FString& _command_name, const TArray<FSoftObjectPath>& _assets, const FString& _option)
+{
+	if (_command_name.IsEmpty())
+	{
+		return;
+	}
+
+	if (!asset_prefetcher_.IsValid())
+	{
+		asset_prefetcher_ = FTwitchAssetPrefetcher::Create(prefetch_retain_seconds_);
+		command_rules_.Prefetcher = asset_prefetcher_;
+	}
+
+	FTwitchCommandAssets& command_assets = command_rules_.CommandAssets.FindOrAdd(_command_name);
+	if (_option.IsEmpty())
+	{
+		command_assets.Assets = _assets;
+	}
+	else
+	{
+		command_assets.OptionAssets.Add(_option, _assets);
+	}
+	PublishCommandRules();
+}
+
+void UTwitchPlayComponent::ClearCommandPrefetchAssets(const FString& _command_name)
+{
+	if (command_rules_.CommandAssets.Remove(_command_name) > 0)
+	{
+		PublishCommandRules();
+	}
+}
+
+int32 UTwitchPlayComponent::StartPoll(const FString& _command_name, const TArray<FString>& _options, float _duration_seconds, float _subscriber_multiplier,
+	float _weight_per_bit, bool _allow_vote_change, int32 _required_roles)
+{
+	if (!poll_engine_.IsValid())
+	{
+		poll_engine_ = MakeShared<FTwitchPollEngine, ESPMode::ThreadSafe>();
+		poll_engine_->SetDelimiters(command_encapsulation_char_, options_encapsulation_char_);
+		AddChatStage(poll_engine_);
+	}
+
+	FTwitchPollDefinition definition;
+	definition.Command = _command_name;
+	definition.Options = _options;
+	definition.DurationSeconds = FMath::Max(_duration_seconds, 0.0f);
+	definition.RequiredRoles = static_cast<ETwitchUserRole>(_required_roles);
+	definition.SubscriberMultiplier = _subscriber_multiplier;
+	definition.WeightPerBit = FMath::Max(_weight_per_bit, 0.0f);
+	definition.bAllowVoteChange = _allow_vote_change;
+
+	// Assets annotated on the vote command per option are prefetched when that option takes the lead
+	if (asset_prefetcher_.IsValid() && command_rules_.CommandAssets.Contains(_command_name))
+	{
+		definition.Prefetcher = asset_prefetcher_;
+		definition.OptionAssets.SetNum(_options.Num());
+		for (int32 option = 0; option < _options.Num(); ++option)
+		{
+			command_rules_.GetCommandAssets(_command_name, { _options[option] }, definition.OptionAssets[option]);
+		}
+	}
+
+	return poll_engine_->StartPoll(MoveTemp(definition));
+}
+
+bool UTwitchPlayComponent::EndPoll(int32 _poll_id)
+{
+	return poll_engine_.IsValid() && poll_engine_->EndPoll(_poll_id);
+}
+
+bool UTwitchPlayComponent::GetPollResult(int32 _poll_id, FTwitchPollResult& _out_result) const
+{
+	return poll_engine_.IsValid() && poll_engine_->GetResult(_poll_id, _out_result);
+}
+
+int32 UTwitchPlayComponent::StartRaffle(const FString& _command_name, int32 _num_winners, float _subscriber_weight,
+	float _weight_per_bit, int32 _required_roles)
+{
+	if (_command_name.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	FTwitchRaffleDefinition definition;
+	definition.Command = _command_name;
+	definition.CommandDelimiter = command_encapsulation_char_;
+	definition.NumWinners = FMath::Max(_num_winners, 1);
+	definition.RequiredRoles = static_cast<ETwitchUserRole>(_required_roles);
+	definition.SubscriberWeight = _subscriber_weight;
+	definition.WeightPerBit = FMath::Max(_weight_per_bit, 0.0f);
+
+	const int32 raffle_id = next_raffle_id_++;
+	FTwitchRafflePtr raffle = MakeShared<FTwitchRaffle, ESPMode::ThreadSafe>(MoveTemp(definition));
+	raffles_.Add(raffle_id, raffle);
+	AddChatStage(raffle);
+	return raffle_id;
+}
+
+bool UTwitchPlayComponent::DrawRaffle(int32 _raffle_id, TArray<FString>& _out_winners)
+{
+	FTwitchRafflePtr raffle;
+	if (!raffles_.RemoveAndCopyValue(_raffle_id, raffle))
+	{
+		return false;
+	}
+
+	RemoveChatStage(raffle);
+	raffle->Draw(_out_winners);
+	return true;
+}
+
+int32 UTwitchPlayComponent::GetRaffleEntrants(int32 _raffle_id) const
+{
+	const FTwitchRafflePtr* raffle = raffles_.Find(_raffle_id);
+	return raffle != nullptr ? (*raffle)->GetNumEntrants() : INDEX_NONE;
+}
+
+int32 UTwitchPlayComponent::StartViewerQueue(const FString& _join_command, const FString& _leave_command, int32 _max_viewers, int32 _required_roles)
+{
+	if (_join_command.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	FTwitchViewerQueueDefinition definition;
+	definition.JoinCommand = _join_command;
+	definition.LeaveCommand = _leave_command;
+	definition.CommandDelimiter = command_encapsulation_char_;
+	definition.MaxViewers = FMath::Max(_max_viewers, 0);
+	definition.RequiredRoles = static_cast<ETwitchUserRole>(_required_roles);
+
+	const int32 queue_id = next_viewer_queue_id_++;
+	FTwitchViewerQueuePtr queue = MakeShared<FTwitchViewerQueue, ESPMode::ThreadSafe>(MoveTemp(definition));
+	viewer_queues_.Add(queue_id, queue);
+	AddChatStage(queue);
+	return queue_id;
+}
+
+bool UTwitchPlayComponent::StopViewerQueue(int32 _queue_id)
+{
+	FTwitchViewerQueuePtr queue;
+	if (!viewer_queues_.RemoveAndCopyValue(_queue_id, queue))
+	{
+		return false;
+	}
+
+	RemoveChatStage(queue);
+	return true;
+}
+
+bool UTwitchPlayComponent::DequeueViewers(int32 _queue_id, int32 _count, TArray<FString>& _out_usernames)
+{
+	const FTwitchViewerQueuePtr* queue = viewer_queues_.Find(_queue_id);
+	if (queue == nullptr)
+	{
+		return false;
+	}
+
+	(*queue)->Dequeue(_count, _out_usernames);
+	return true;
+}
+
+bool UTwitchPlayComponent::RemoveQueuedViewer(int32 _queue_id, const FString& _username)
+{
+	const FTwitchViewerQueuePtr* queue = viewer_queues_.Find(_queue_id);
+	return queue != nullptr && (*queue)->Remove(_username);
+}
+
+int32 UTwitchPlayComponent::GetViewerQueuePosition(int32 _queue_id, const FString& _username) const
+{
+	const FTwitchViewerQueuePtr* queue = viewer_queues_.Find(_queue_id);
+	return queue != nullptr ? (*queue)->GetPosition(_username) : 0;
+}
+
+int32 UTwitchPlayComponent::GetViewerQueueLength(int32 _queue_id) const
+{
+	const FTwitchViewerQueuePtr* queue = viewer_queues_.Find(_queue_id);
+	return queue != nullptr ? (*queue)->Num() : INDEX_NONE;
+}
+
+int32 UTwitchPlayComponent::AddViewerScore(const FString& _username, int64 _delta)
+{
+	return _username.IsEmpty() ? 0 : leaderboard_.AddScore(_username, _delta);
+}
+
+int32 UTwitchPlayComponent::SetViewerScore(const FString& _username, int64 _score)
+{
+	return _username.IsEmpty() ? 0 : leaderboard_.SetScore(_username, _score);
+}
+
+bool UTwitchPlayComponent::RemoveViewerScore(const FString& _username)
+{
+	return leaderboard_.Remove(_username);
+}
+
+int32 UTwitchPlayComponent::GetViewerRank(const FString& _username, int64& _out_score) const
+{
+	_out_score = 0;
+	return leaderboard_.GetRank(_username, &_out_score);
+}
+
+void UTwitchPlayComponent::GetLeaderboardEntries(int32 _first_rank, int32 _count, TArray<FTwitchLeaderboardEntry>& _out_entries) const
+{
+	leaderboard_.GetEntries(_first_rank, _count, _out_entries);
+}
+
+int32 UTwitchPlayComponent::GetLeaderboardRevision() const
+{
+	return static_cast<int32>(leaderboard_.GetRevision());
+}
+
+int32 UTwitchPlayComponent::GetLeaderboardSize() const
+{
+	return leaderboard_.Num();
+}
+
+void UTwitchPlayComponent::ResetLeaderboard()
+{
+	leaderboard_.Reset();
+}
+
+void UTwitchPlayComponent::StartChatterTracking(int32 _max_chatters)
+{
+	StopChatterTracking();
+	chatter_tracker_ = MakeShared<FTwitchChatterTracker, ESPMode::ThreadSafe>(_max_chatters);
+	AddChatStage(chatter_tracker_);
+}
+
+void UTwitchPlayComponent::StopChatterTracking()
+{
+	if (chatter_tracker_.IsValid())
+	{
+		RemoveChatStage(chatter_tracker_);
+		chatter_tracker_ = nullptr;
+	}
+}
+
+int32 UTwitchPlayComponent::GetNumChatters() const
+{
+	return chatter_tracker_.IsValid() ? chatter_tracker_->Num() : 0;
+}
+
+void UTwitchPlayComponent::GetCommandCosts(int32 _count, TArray<FTwitchCommandCost>& _out_costs) const
+{
+	FTwitchCommandProfiler::Get().GetTopOffenders(_count, _out_costs);
+}
+
+void UTwitchPlayComponent::PublishChatterBatch()
+{
+	if (chatter_tracker_.IsValid() && chatter_tracker_->GatherBatch(chatter_batch_))
+	{
+		on_chatters_updated_.Broadcast(chatter_batch_);
+	}
+}
+
+void UTwitchPlayComponent::PublishPollResults()
+{
+	if (!poll_engine_.IsValid())
+	{
+		return;
+	}
+
+	TArray<FTwitchPollResult> updated_polls;
+	TArray<FTwitchPollResult> ended_polls;
+	poll_engine_->GatherResults(updated_polls, ended_polls);
+
+	for (const FTwitchPollResult& result : updated_polls)
+	{
+		on_poll_updated_.Broadcast(result);
+	}
+
+	// Chat aggregates follow the poll updated last
+	if (updated_polls.Num() > 0 && GetChatAggregator().IsValid())
+	{
+		GetChatAggregator()->SetVoteTallies(updated_polls.Last().Tallies);
+	}
+	for (const FTwitchPollResult& result : ended_polls)
+	{
+		on_poll_ended_.Broadcast(result);
+	}
+}
+
+void UTwitchPlayComponent::HandleChatMessage(const FTwitchChatMessage& _message)
+{
+	// No reason to search for the command in the event map, there isn't any
+	// Unregistered and unauthorized commands were already cleared by the receiver thread
+	if (_message.Command.IsEmpty())
+	{
+		return;
+	}
+
+	// Under a dispatch budget commands wait their turn in the priority queue
+	if (max_commands_per_tick_ > 0)
+	{
+		// Cheers get their own room past the backlog, so a burst of them can't grow the queue without bound either
+		const int32 backlog_limit = _message.Bits > 0 ? max_command_backlog_ + max_cheer_backlog_ : max_command_backlog_;
+		if (pending_commands_.Num() >= backlog_limit)
+		{
+			FTwitchStats::Get().CommandsDropped.Increment();
+			return;
+		}
+
+		const double boost = FMath::Min(static_cast<double>(_message.Bits) * seconds_per_bit_, static_cast<double>(max_bits_boost_seconds_));
+		pending_commands_.HeapPush(FPendingCommand { _message.ReceivedTime - boost, pending_sequence_++, _message });
+		return;
+	}
+
+	DispatchCommand(_message);
+}
+
+void UTwitchPlayComponent::HandleDisconnected()
+{
+	if (pending_commands_.Num() > 0)
+	{
+		FTwitchStats::Get().CommandsDropped.Add(pending_commands_.Num());
+		pending_commands_.Empty();
+	}
+}
+
+void UTwitchPlayComponent::DispatchPendingCommands()
+{
+	CSV_SCOPED_TIMING_STAT(TwitchPlay, Dispatch);
+
+	// Budget may have been switched off while commands were waiting, then flush them all
+	int32 budget = max_commands_per_tick_ > 0 ? max_commands_per_tick_ : pending_commands_.Num();
+	while (budget-- > 0 && pending_commands_.Num() > 0)
+	{
+		FPendingCommand next;
+		pending_commands_.HeapPop(next, false);
+		DispatchCommand(next.message);
+	}
+
+	CSV_CUSTOM_STAT(TwitchPlay, CommandBacklog, pending_commands_.Num(), ECsvCustomStatOp::Accumulate);
+}
+
+void UTwitchPlayComponent::DispatchCommand(const FTwitchChatMessage& _message)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TwitchPlayCommandDispatch);
+
+	// Per command costs, only while TwitchPlay.ProfileCommands is set
+	FTwitchCommandProfiler::FScope profile_scope(_message.Command);
+
+	// Batches of identical commands merged by the receiver thread
+	if (_message.bIsCoalesced)
+	{
+		if (FOnCoalescedCommandReceived* registered_batch = bound_coalesced_events_.Find(_message.Command))
+		{
+			registered_batch->ExecuteIfBound(_message.Command, _message.Options, _message.Count, _message.Senders);
+		}
+		return;
+	}
+
+	FOnCommandReceived* registered_command = bound_events_.Find(_message.Command);
+
+	// If the command is still registered fire the event
+	if (registered_command != nullptr)
+	{
+		registered_command->ExecuteIfBound(_message.Command, _message.Options, _message.Username);
+	}
+}
+
+void UTwitchPlayComponent::PublishCommandRules()
+{
+	command_rules_.CommandDelimiter = command_encapsulation_char_;
+	command_rules_.OptionsDelimiter = options_encapsulation_char_;
+	if (poll_engine_.IsValid())
+	{
+		poll_engine_->SetDelimiters(command_encapsulation_char_, options_encapsulation_char_);
+	}
+	SetCommandRules(MakeShared<const FTwitchCommandRules, ESPMode::ThreadSafe>(command_rules_));
+}
@@ -0,0 +1,94 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "TwitchMetricsEndpoint.h"
+#include "Chat/TwitchStats.h"
+#include "HttpServerModule.h"
+#include "HttpServerResponse.h"
+#include "HttpPath.h"
+#include "IHttpRouter.h"
+
+FTwitchMetricsEndpoint::~FTwitchMetricsEndpoint()
+{
+	Stop();
+}
+
+bool FTwitchMetricsEndpoint::Start(const uint32 port)
+{
+	Stop();
+
+	FHttpServerModule& http_server = FHttpServerModule::Get();
+	Router = http_server.GetHttpRouter(port);
+	if(!Router.IsValid())
+	{
+		return false;
+	}
+
+	RouteHandle = Router->BindRoute(FHttpPath(TEXT("/metrics")), EHttpServerRequestVerbs::VERB_GET,
+		[](const FHttpServerRequest& request, const FHttpResultCallback& onComplete)
+		{
+			onComplete(FHttpServerResponse::Create(FormatMetrics(FTwitchStats::Get().TakeSnapshot()), TEXT("text/plain; version=0.0.4")));
+			return true;
+		});
+	if(!RouteHandle.IsValid())
+	{
+		Router.Reset();
+		return false;
+	}
+
+	http_server.StartAllListeners();
+	Port = port;
+	return true;
+}
+
+void FTwitchMetricsEndpoint::Stop()
+{
+	if(Router.IsValid() && RouteHandle.IsValid())
+	{
+		Router->UnbindRoute(RouteHandle);
+	}
+	RouteHandle.Reset();
+	Router.Reset();
+	Port = 0;
+}
+
+FString FTwitchMetricsEndpoint::FormatMetrics(const FTwitchStatsSnapshot& snapshot)
+{
+	FString metrics;
+	metrics.Reserve(2048);
+	auto add_metric = [&metrics](const TCHAR* name, const TCHAR* type, const TCHAR* help, const FString& value)
+	{
+		metrics += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s %s\n%s %s\n"), name, help, name, type, name, *value);
+	};
+	auto add_int = [&add_metric](const TCHAR* name, const TCHAR* type, const TCHAR* help, const int64 value)
+	{
+		add_metric(name, type, help, FString::Printf(TEXT("%lld"), value));
+	};
+
+	add_int(TEXT("twitchplay_connected"), TEXT("gauge"), TEXT("Twitch connections logged in."), snapshot.Connected);
+	add_int(TEXT("twitchplay_connections_total"), TEXT("counter"), TEXT("Successful logins."), snapshot.Connections);
+	add_int(TEXT("twitchplay_reconnects_total"), TEXT("counter"), TEXT("Logins of a component that had been connected before."), snapshot.Reconnects);
+	add_int(TEXT("twitchplay_disconnects_total"), TEXT("counter"), TEXT("Connections lost without being asked to disconnect."), snapshot.Disconnects);
+	add_int(TEXT("twitchplay_lines_received_total"), TEXT("counter"), TEXT("IRC lines read from the server."), snapshot.LinesReceived);
+	add_int(TEXT("twitchplay_messages_received_total"), TEXT("counter"), TEXT("Chat messages parsed."), snapshot.MessagesReceived);
+	add_int(TEXT("twitchplay_messages_filtered_total"), TEXT("counter"), TEXT("Chat messages dropped by the user filter."), snapshot.MessagesFiltered);
+	add_int(TEXT("twitchplay_commands_dropped_total"), TEXT("counter"), TEXT("Commands dropped because the command backlog was full."), snapshot.CommandsDropped);
+	add_int(TEXT("twitchplay_commands_rejected_total"), TEXT("counter"), TEXT("Registered commands sent without the required roles."), snapshot.CommandsRejected);
+	add_metric(TEXT("twitchplay_parse_seconds_total"), TEXT("counter"), TEXT("Time spent parsing and filtering chat."),
+		FString::Printf(TEXT("%.6f"), static_cast<double>(snapshot.ParseMicroseconds) / 1000000.0));
+	add_metric(TEXT("twitchplay_dispatch_latency_seconds"), TEXT("gauge"), TEXT("Longest wait between reading a message and dispatching it, last frame with messages."),
+		FString::Printf(TEXT("%.6f"), static_cast<double>(snapshot.DispatchLatencyMicroseconds) / 1000000.0));
+	add_int(TEXT("twitchplay_receive_queue_depth"), TEXT("gauge"), TEXT("Chat messages waiting for the game thread."), snapshot.ReceiveQueueDepth);
+	add_int(TEXT("twitchplay_send_queue_depth"), TEXT("gauge"), TEXT("Chat messages waiting to be sent."), snapshot.SendQueueDepth);
+	add_int(TEXT("twitchplay_messages_sent_total"), TEXT("counter"), TEXT("Chat messages written to the socket."), snapshot.MessagesSent);
+	add_int(TEXT("twitchplay_send_failures_total"), TEXT("counter"), TEXT("Chat messages the socket refused."), snapshot.SendFailures);
+	add_int(TEXT("twitchplay_rate_limit_waits_total"), TEXT("counter"), TEXT("Sends held back by the time between messages."), snapshot.RateLimitWaits);
+
+	// No sample until the first PONG came back
+	if(snapshot.RoundTripMicroseconds >= 0)
+	{
+		add_metric(TEXT("twitchplay_round_trip_seconds"), TEXT("gauge"), TEXT("Round trip of the last PING sent to the server."),
+			FString::Printf(TEXT("%.6f"), static_cast<double>(snapshot.RoundTripMicroseconds) / 1000000.0));
+	}
+
+	return metrics;
+}
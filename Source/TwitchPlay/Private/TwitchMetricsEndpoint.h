@@ -0,0 +1,36 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HttpRouteHandle.h"
+
+class IHttpRouter;
+struct FTwitchStatsSnapshot;
+
+/**
+ * Serves the Twitch stats on a local HTTP port under /metrics, in the Prometheus text format.
+ * Each scrape only reads a snapshot of the stats counters.
+ */
+class FTwitchMetricsEndpoint
+{
+public:
+
+	~FTwitchMetricsEndpoint();
+
+	// Starts serving on a port, stops serving on the previous one
+	bool Start(const uint32 port);
+
+	void Stop();
+
+	uint32 GetPort() const { return Port; }
+
+	// Formats a snapshot in the Prometheus text format
+	static FString FormatMetrics(const FTwitchStatsSnapshot& snapshot);
+
+private:
+
+	TSharedPtr<IHttpRouter> Router;
+	FHttpRouteHandle RouteHandle;
+	uint32 Port = 0;
+};
@@ -0,0 +1,66 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "TwitchPieSessions.h"
+
+#if WITH_EDITOR
+
+#include "Components/TwitchIRCComponent.h"
+
+FTwitchPieSessions& FTwitchPieSessions::Get()
+{
+	static FTwitchPieSessions sessions;
+	return sessions;
+}
+
+void FTwitchPieSessions::Follow(FTwitchMessageReceiver& follower, const FString& oauth, const FString& username, const FString& channel,
+	const float timeBetweenMessages, const bool bAnonymous)
+{
+	check(IsInGameThread());
+
+	ClosingSessions.RemoveAll([](const FSharedReceiver& session)
+	{
+		return session->IsFinished();
+	});
+
+	const FString key = FString::Printf(TEXT("%s#%s"), bAnonymous ? TEXT("") : *username.ToLower(), *channel.ToLower());
+	FSharedReceiver& session = Sessions.FindOrAdd(key);
+
+	// A connection that is ending can't be followed, it is replaced
+	if(session.IsValid() && session->IsStopping())
+	{
+		ClosingSessions.Add(session);
+		session = nullptr;
+	}
+
+	if(!session.IsValid())
+	{
+		session = MakeShared<FTwitchMessageReceiver, ESPMode::ThreadSafe>();
+		session->SetShared(true);
+		if(bAnonymous)
+		{
+			session->StartAnonymousConnection(channel);
+		}
+		else
+		{
+			session->StartConnection(oauth, username, channel, timeBetweenMessages);
+		}
+	}
+
+	follower.StartFollowing(session.ToSharedRef());
+}
+
+void FTwitchPieSessions::Shutdown()
+{
+	for(TPair<FString, FSharedReceiver>& session : Sessions)
+	{
+		session.Value->StopConnection(true);
+	}
+	for(const FSharedReceiver& session : ClosingSessions)
+	{
+		session->StopConnection(true);
+	}
+	Sessions.Empty();
+	ClosingSessions.Empty();
+}
+
+#endif
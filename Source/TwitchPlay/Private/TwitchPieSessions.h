@@ -0,0 +1,45 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+
+class FTwitchMessageReceiver;
+
+/**
+ * Shares Twitch connections between the worlds of a multi-client PIE session.
+ * The first world to connect opens the connection, the others follow it, so they start without logging in
+ * and chat is parsed once. Each follower still runs its own filter, commands and stages.
+ * The connection closes when its last follower leaves. Only used from the game thread.
+ */
+class FTwitchPieSessions
+{
+public:
+
+	static FTwitchPieSessions& Get();
+
+	/**
+	 * Makes a receiver follow the connection of an account to a channel, opening the connection if there is none.
+	 * @param follower - The receiver, not started yet
+	 * @param bAnonymous - Follow the anonymous read-only connection to the channel. Oauth and username are unused.
+	 */
+	void Follow(FTwitchMessageReceiver& follower, const FString& oauth, const FString& username, const FString& channel,
+		const float timeBetweenMessages, const bool bAnonymous);
+
+	// Closes the connections that are left, waiting for their threads
+	void Shutdown();
+
+private:
+
+	using FSharedReceiver = TSharedPtr<FTwitchMessageReceiver, ESPMode::ThreadSafe>;
+
+	// Open connections, by account and channel
+	TMap<FString, FSharedReceiver> Sessions;
+
+	// Connections that are closing, kept until their thread is done
+	TArray<FSharedReceiver> ClosingSessions;
+};
+
+#endif
@@ -1,11 +1,69 @@
-// Copyright 1998-2015 Epic Games, Inc. All Rights Reserved.
-
-#include "TwitchPlay.h"
-
-void FTwitchPlayModule::StartupModule()
-{}
-
-void FTwitchPlayModule::ShutdownModule()
-{}
-
+// Copyright 1998-2015 Epic Games, Inc. All Rights Reserved.
+
+#include "TwitchPlay.h"
+#include "TwitchMetricsEndpoint.h"
+#include "Chat/TwitchStats.h"
+#include "Misc/CoreDelegates.h"
+#if WITH_EDITOR
+#include "TwitchPieSessions.h"
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogTwitchPlay, Log, All);
+
+static TAutoConsoleVariable<int32> CVarTwitchPlayMetricsPort(
+	TEXT("TwitchPlay.MetricsPort"),
+	0,
+	TEXT("Local HTTP port serving the TwitchPlay stats under /metrics, in the Prometheus text format. 0 disables the endpoint."),
+	ECVF_Default);
+
+void FTwitchPlayModule::StartupModule()
+{
+	CVarTwitchPlayMetricsPort.AsVariable()->SetOnChangedCallback(FConsoleVariableDelegate::CreateRaw(this, &FTwitchPlayModule::OnMetricsPortChanged));
+	OnMetricsPortChanged(CVarTwitchPlayMetricsPort.AsVariable());
+
+#if CSV_PROFILER
+	CsvFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([]()
+	{
+		FTwitchStats::Get().RecordCsvFrame();
+	});
+#endif
+}
+
+void FTwitchPlayModule::ShutdownModule()
+{
+	CVarTwitchPlayMetricsPort.AsVariable()->SetOnChangedCallback(FConsoleVariableDelegate());
+	MetricsEndpoint.Reset();
+
+	FCoreDelegates::OnEndFrame.Remove(CsvFrameHandle);
+
+#if WITH_EDITOR
+	FTwitchPieSessions::Get().Shutdown();
+#endif
+}
+
+void FTwitchPlayModule::OnMetricsPortChanged(IConsoleVariable* variable)
+{
+	const int32 port = variable->GetInt();
+	if(port <= 0 || port > 65535)
+	{
+		MetricsEndpoint.Reset();
+		return;
+	}
+
+	if(MetricsEndpoint.IsValid() && MetricsEndpoint->GetPort() == static_cast<uint32>(port))
+	{
+		return;
+	}
+
+	if(!MetricsEndpoint.IsValid())
+	{
+		MetricsEndpoint = MakeShared<FTwitchMetricsEndpoint>();
+	}
+	if(!MetricsEndpoint->Start(port))
+	{
+		UE_LOG(LogTwitchPlay, Warning, TEXT("TwitchPlay: could not serve metrics on port %d"), port);
+		MetricsEndpoint.Reset();
+	}
+}
+
 IMPLEMENT_MODULE(FTwitchPlayModule, TwitchPlay)
\ No newline at end of file
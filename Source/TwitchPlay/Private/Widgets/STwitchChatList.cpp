@@ -0,0 +1,211 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Widgets/STwitchChatList.h"
+#include "Styling/CoreStyle.h"
+#include "Widgets/SBoxPanel.h"
+#include "Widgets/Text/STextBlock.h"
+#include "Widgets/Layout/SWrapBox.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Images/SImage.h"
+#include "Chat/TwitchEmoteCache.h"
+
+void STwitchChatList::Construct(const FArguments& InArgs)
+{
+	History = InArgs._History;
+	EmoteCache = InArgs._EmoteCache;
+	LastShownId = 0;
+	MaxMessages = FMath::Max(InArgs._MaxMessages, 1);
+	Font = InArgs._Font.HasValidFont() ? InArgs._Font : FCoreStyle::GetDefaultFontStyle("Regular", 10);
+	UsernameColor = InArgs._UsernameColor;
+	MessageColor = InArgs._MessageColor;
+	bAutoScroll = InArgs._bAutoScroll;
+
+	ChildSlot
+	[
+		SAssignNew(ListView, SListView<FTwitchChatListItemPtr>)
+		.ListItemsSource(&Items)
+		.SelectionMode(ESelectionMode::None)
+		.OnGenerateRow(this, &STwitchChatList::GenerateRow)
+	];
+}
+
+void STwitchChatList::ClearMessages()
+{
+	FreeItems.Append(Items);
+	Items.Reset();
+	ListView->RequestListRefresh();
+}
+
+void STwitchChatList::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+	AppendNewRecords();
+}
+
+void STwitchChatList::AppendNewRecords()
+{
+	const FTwitchChatHistoryPtr history = History.Get();
+	if(history != ShownHistory.Pin())
+	{
+		ShownHistory = history;
+		LastShownId = 0;
+		ClearMessages();
+	}
+
+	if(!history.IsValid())
+	{
+		return;
+	}
+
+	const uint64 newest_id = history->GetNewestId();
+	if(newest_id <= LastShownId)
+	{
+		return;
+	}
+
+	// Only the last MaxMessages can be shown, skip whatever came and went since the last frame
+	const uint64 max_messages = static_cast<uint64>(MaxMessages);
+	const uint64 first_id = FMath::Max(LastShownId + 1, newest_id >= max_messages ? newest_id - max_messages + 1 : 1);
+	history->GetRecords(first_id, MaxMessages, NewRecords);
+	LastShownId = newest_id;
+	if(NewRecords.Num() == 0)
+	{
+		return;
+	}
+
+	const bool b_follow = bAutoScroll && ListView->GetScrollDistanceRemaining().Y <= KINDA_SMALL_NUMBER;
+
+	// Drop the oldest items in one go and keep them for reuse
+	const int32 overflow = Items.Num() + NewRecords.Num() - MaxMessages;
+	if(overflow > 0)
+	{
+		FreeItems.Append(Items.GetData(), overflow);
+		Items.RemoveAt(0, overflow, false);
+	}
+
+	for(FTwitchChatHistoryEntry& record : NewRecords)
+	{
+		// The list view may still hold dropped items until its refresh
+		FTwitchChatListItemPtr item;
+		while(FreeItems.Num() > 0 && !item.IsValid())
+		{
+			item = FreeItems.Pop(false);
+			if(!item.IsUnique())
+			{
+				item.Reset();
+			}
+		}
+
+		if(item.IsValid())
+		{
+			*item = MoveTemp(record);
+		}
+		else
+		{
+			item = MakeShared<FTwitchChatHistoryEntry>(MoveTemp(record));
+		}
+		Items.Add(MoveTemp(item));
+	}
+	NewRecords.Reset();
+
+	ListView->RequestListRefresh();
+	if(b_follow)
+	{
+		ListView->ScrollToBottom();
+	}
+}
+
+TSharedRef<ITableRow> STwitchChatList::GenerateRow(FTwitchChatListItemPtr item, const TSharedRef<STableViewBase>& ownerTable)
+{
+	// Display lines come with the name and color picked by the sender
+	const FTwitchChatDisplayLine* display = item->Display.Get();
+	const FString& name = display != nullptr ? display->DisplayName : item->Username;
+	const FSlateColor name_color = display != nullptr && display->bHasNameColor ? FSlateColor(display->NameColor) : UsernameColor;
+
+	UTwitchEmoteCache* emote_cache = EmoteCache.Get();
+	const bool b_has_emotes = display != nullptr && emote_cache != nullptr && display->Runs.ContainsByPredicate([](const FTwitchDisplayRun& run)
+	{
+		return run.Type == ETwitchDisplayRunType::EMOTE;
+	});
+	TSharedPtr<SWidget> content;
+	if(b_has_emotes)
+	{
+		content = MakeEmoteContent(*item, *display, emote_cache);
+	}
+	else
+	{
+		content = SNew(STextBlock)
+			.Font(Font)
+			.ColorAndOpacity(MessageColor)
+			.AutoWrapText(true)
+			.Text(FText::FromString(item->Message));
+	}
+
+	return SNew(STableRow<FTwitchChatListItemPtr>, ownerTable)
+		.ShowSelection(false)
+		[
+			SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			[
+				SNew(STextBlock)
+				.Font(Font)
+				.ColorAndOpacity(name_color)
+				.Text(FText::FromString(name + TEXT(": ")))
+			]
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.0f)
+			[
+				content.ToSharedRef()
+			]
+		];
+}
+
+TSharedRef<SWidget> STwitchChatList::MakeEmoteContent(const FTwitchChatHistoryEntry& item, const FTwitchChatDisplayLine& display, UTwitchEmoteCache* emoteCache) const
+{
+	TSharedRef<SWrapBox> wrap_box = SNew(SWrapBox).UseAllottedWidth(true);
+	const TWeakObjectPtr<UTwitchEmoteCache> weak_cache(emoteCache);
+	for(const FTwitchDisplayRun& run : display.Runs)
+	{
+		if(run.Type == ETwitchDisplayRunType::EMOTE)
+		{
+			// Looked up each paint, the emote may still be loading or its atlas cell may be reused later
+			const FString emote_id = run.EmoteId;
+			emoteCache->RequestEmote(emote_id);
+			wrap_box->AddSlot()
+			.VAlign(VAlign_Center)
+			[
+				SNew(SBox)
+				.WidthOverride(emoteCache->EmoteSize)
+				.HeightOverride(emoteCache->EmoteSize)
+				[
+					SNew(SImage)
+					.Image_Lambda([weak_cache, emote_id]() -> const FSlateBrush*
+					{
+						UTwitchEmoteCache* cache = weak_cache.Get();
+						return cache != nullptr ? cache->FindBrush(emote_id) : nullptr;
+					})
+				]
+			];
+			continue;
+		}
+
+		// A block per word, so text wraps between emotes
+		TArray<FString> words;
+		item.Message.Mid(run.Start, run.Length).ParseIntoArrayWS(words);
+		for(FString& word : words)
+		{
+			wrap_box->AddSlot()
+			.VAlign(VAlign_Center)
+			.Padding(0.0f, 0.0f, 4.0f, 0.0f)
+			[
+				SNew(STextBlock)
+				.Font(Font)
+				.ColorAndOpacity(MessageColor)
+				.Text(FText::FromString(MoveTemp(word)))
+			];
+		}
+	}
+
+	return wrap_box;
+}
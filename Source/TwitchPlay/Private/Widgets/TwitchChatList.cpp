@@ -0,0 +1,70 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Widgets/TwitchChatList.h"
+#include "Widgets/STwitchChatList.h"
+#include "Components/TwitchIRCComponent.h"
+#include "Styling/CoreStyle.h"
+
+#define LOCTEXT_NAMESPACE "TwitchPlay"
+
+UTwitchChatList::UTwitchChatList(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+	, MaxMessages(200)
+	, bAutoScroll(true)
+	, Font(FCoreStyle::GetDefaultFontStyle("Regular", 10))
+	, UsernameColor(FLinearColor(0.57f, 0.27f, 1.0f))
+	, MessageColor(FLinearColor::White)
+{
+}
+
+void UTwitchChatList::SetChatComponent(UTwitchIRCComponent* component)
+{
+	ChatComponent = component;
+}
+
+void UTwitchChatList::ClearMessages()
+{
+	if(MyChatList.IsValid())
+	{
+		MyChatList->ClearMessages();
+	}
+}
+
+FTwitchChatHistoryPtr UTwitchChatList::GetChatHistory() const
+{
+	return ChatComponent.IsValid() ? ChatComponent->GetChatHistory() : nullptr;
+}
+
+UTwitchEmoteCache* UTwitchChatList::GetEmoteCache() const
+{
+	return ChatComponent.IsValid() ? ChatComponent->EmoteCache : nullptr;
+}
+
+TSharedRef<SWidget> UTwitchChatList::RebuildWidget()
+{
+	MyChatList = SNew(STwitchChatList)
+		.History_UObject(this, &UTwitchChatList::GetChatHistory)
+		.EmoteCache_UObject(this, &UTwitchChatList::GetEmoteCache)
+		.MaxMessages(MaxMessages)
+		.Font(Font)
+		.UsernameColor(UsernameColor)
+		.MessageColor(MessageColor)
+		.bAutoScroll(bAutoScroll);
+
+	return MyChatList.ToSharedRef();
+}
+
+void UTwitchChatList::ReleaseSlateResources(bool bReleaseChildren)
+{
+	Super::ReleaseSlateResources(bReleaseChildren);
+	MyChatList.Reset();
+}
+
+#if WITH_EDITOR
+const FText UTwitchChatList::GetPaletteCategory()
+{
+	return LOCTEXT("TwitchPlay", "TwitchPlay");
+}
+#endif
+
+#undef LOCTEXT_NAMESPACE
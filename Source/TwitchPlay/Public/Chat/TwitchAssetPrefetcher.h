@@ -0,0 +1,62 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+
+/**
+ * Starts async streaming of the assets chat commands are about to need, so they are resident by the time the command handler runs.
+ * Requests can come from any thread. Streaming is always started on the game thread.
+ * Loaded assets are kept resident for a while after their last request.
+ */
+class TWITCHPLAY_API FTwitchAssetPrefetcher : public TSharedFromThis<FTwitchAssetPrefetcher, ESPMode::ThreadSafe>
+{
+public:
+
+	/**
+	 * Creates a prefetcher. The receiver thread pins it while requesting, so its last reference may be dropped there:
+	 * it is then deleted on the game thread, where its streaming handles and manager belong.
+	 * @param retainSeconds - Seconds assets are kept resident after their last request
+	 */
+	static TSharedRef<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> Create(const float retainSeconds = 60.0f);
+
+	~FTwitchAssetPrefetcher();
+
+	/**
+	 * Asks for the assets to be streamed in. Can be called from any thread.
+	 * Assets that were requested recently are skipped without leaving the calling thread.
+	 */
+	void RequestFromAnyThread(const TArray<FSoftObjectPath>& assets);
+
+	/**
+	 * Releases the assets that were not requested for longer than the retain time. Game thread only.
+	 */
+	void ReleaseUnused();
+
+	void SetRetainSeconds(const float retainSeconds) { RetainSeconds = retainSeconds; }
+
+private:
+
+	explicit FTwitchAssetPrefetcher(const float retainSeconds);
+
+	// Starts streaming on the game thread
+	void StartStreaming(const TArray<FSoftObjectPath>& assets);
+
+	struct FPrefetchedAsset
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		double LastRequestTime = 0.0;
+	};
+
+	// Streaming and keeping the assets resident
+	FStreamableManager StreamableManager;
+
+	// Assets requested so far. Guarded by AssetsLock.
+	TMap<FSoftObjectPath, FPrefetchedAsset> Assets;
+	FCriticalSection AssetsLock;
+
+	float RetainSeconds;
+};
+
+using FTwitchAssetPrefetcherPtr = TSharedPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe>;
@@ -0,0 +1,44 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Bloom filter over interned user keys.
+ * Answers "definitely not seen" or "probably seen" in a few bit tests, with memory fixed at construction
+ * whatever the number of keys added.
+ */
+class TWITCHPLAY_API FTwitchBloomFilter
+{
+public:
+
+	/**
+	 * @param expectedKeys - Number of keys the filter is sized for. More keys raise the false positive rate.
+	 * @param falsePositiveRate - Rate of "probably seen" answers for keys that were never added, at the expected number of keys
+	 */
+	FTwitchBloomFilter(const int32 expectedKeys = 0, const double falsePositiveRate = 0.01);
+
+	// Adds a key. Returns true if the key was probably added before.
+	bool Add(const uint64 key);
+
+	// False means the key was definitely never added
+	bool MayContain(const uint64 key) const;
+
+	// Removes all the keys
+	void Reset();
+
+	// Size of the filter in bytes
+	SIZE_T GetAllocatedSize() const { return Bits.GetAllocatedSize(); }
+
+private:
+
+	// Bits, the number of bits is a power of two
+	TArray<uint64> Bits;
+
+	// Mask of the bit index
+	uint64 Mask;
+
+	// Number of bits set per key
+	int32 NumHashes;
+};
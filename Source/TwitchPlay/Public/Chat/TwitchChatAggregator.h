@@ -0,0 +1,123 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+
+class UObject;
+class UWorld;
+
+// Chat activity summed up once per frame. Snapshots are immutable, so any thread can read one while the next is being made.
+struct FTwitchChatAggregates
+{
+	// Chat messages per second, smoothed
+	float MessagesPerSecond = 0.0f;
+
+	// Chat messages received since the previous snapshot
+	int32 NewMessages = 0;
+
+	// Most used emotes lately, most used first
+	TArray<FString> TopEmoteIds;
+
+	// Decayed use count of each top emote
+	TArray<float> TopEmoteCounts;
+
+	// Region of each top emote in the emote atlas (min u, min v, max u, max v), zero while the emote is loading
+	TArray<FVector4> TopEmoteUVs;
+
+	// Decayed count of the positions sent with the heatmap command, row by row, scaled so the hottest cell is 1
+	TArray<float> Heatmap;
+
+	// Number of cells on each side of the heatmap
+	int32 HeatmapSize = 0;
+
+	// Share of the votes of each option of the poll updated last, adding up to 1
+	TArray<float> VoteShares;
+};
+
+using FTwitchChatAggregatesPtr = TSharedPtr<const FTwitchChatAggregates, ESPMode::ThreadSafe>;
+
+/**
+ * Receive pipeline stage counting messages, emotes and heatmap positions on the receiver thread.
+ * The game thread folds the counts into decayed totals once per frame and publishes the snapshot under a name,
+ * so readers like particle systems scale with chat without any per-message work.
+ * Emotes are counted from the display lines, so the IRC component must build them.
+ */
+class TWITCHPLAY_API FTwitchChatAggregator final : public ITwitchChatStage
+{
+public:
+
+	/**
+	 * @param heatmapCommand - Command sending a position to the heatmap, with the coordinates from 0 to 1 as options (ie. !tap#0.25,0.8#)
+	 * @param heatmapSize - Number of cells on each side of the heatmap
+	 * @param numTopEmotes - Number of top emotes in the snapshots
+	 * @param halfLifeSeconds - Seconds for the counts to decay to half
+	 */
+	FTwitchChatAggregator(const FString& heatmapCommand, const int32 heatmapSize, const int32 numTopEmotes, const float halfLifeSeconds);
+
+	// Sets the delimiters the heatmap command is parsed with when it is not a registered command
+	void SetDelimiters(const FString& commandDelimiter, const FString& optionsDelimiter);
+
+	// Sets the vote tallies of the next snapshots. Game thread only.
+	void SetVoteTallies(const TArray<float>& tallies);
+
+	/**
+	 * Folds what was received since the last call into a new snapshot. Game thread only, once per frame.
+	 * The snapshot can be completed (ie. with the emote UVs) before it is published.
+	 */
+	TSharedRef<FTwitchChatAggregates, ESPMode::ThreadSafe> TakeSnapshot(const float deltaSeconds);
+
+	/**
+	 * Publishes a snapshot under a name, replacing the previous one of the same owner. Can be called from any thread.
+	 * Several worlds (ie. multi-client PIE) can publish under the same name, each reader gets the snapshot of its own world.
+	 * @param name - Name the readers look the snapshot up with
+	 * @param owner - Object publishing the snapshot
+	 * @param world - World the snapshot belongs to
+	 * @param aggregates - The snapshot
+	 */
+	static void Publish(const FName name, const UObject* owner, const UWorld* world, const FTwitchChatAggregatesPtr& aggregates);
+
+	// Removes the snapshot an owner published under a name, leaving the snapshots of other owners alone
+	static void Unpublish(const FName name, const UObject* owner);
+
+	/**
+	 * Gets the snapshot published under a name for a world, null if none. Can be called from any thread.
+	 * Falls back to a snapshot of another world, so editor previews still follow the game being played.
+	 */
+	static FTwitchChatAggregatesPtr GetPublished(const FName name, const UWorld* world);
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+
+private:
+
+	// Reads the heatmap cell of a message, INDEX_NONE if it isn't the heatmap command
+	int32 GetHeatmapCell(const FTwitchChatMessage& message) const;
+
+	const FString HeatmapCommand;
+	const int32 HeatmapSize;
+	const int32 NumTopEmotes;
+	const float HalfLifeSeconds;
+
+	// Counted by the receiver thread since the last snapshot
+	int32 PendingMessages;
+	TMap<FString, int32> PendingEmotes;
+	TArray<int32> PendingHeat;
+
+	FString CommandDelimiter;
+	FString OptionsDelimiter;
+
+	// Guards the pending counts and the delimiters
+	mutable FCriticalSection Lock;
+
+	// Decayed totals. Only touched by the game thread.
+	float MessagesPerSecond;
+	TMap<FString, float> EmoteCounts;
+	TArray<float> Heat;
+	TArray<float> VoteShares;
+};
+
+using FTwitchChatAggregatorPtr = TSharedPtr<FTwitchChatAggregator, ESPMode::ThreadSafe>;
@@ -0,0 +1,74 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TwitchChatDisplay.generated.h"
+
+UENUM(BlueprintType)
+enum class ETwitchDisplayRunType : uint8
+{
+	// Plain text
+	TEXT,
+	// An emote, to show as an image instead of its text
+	EMOTE,
+};
+
+// A span of a chat message shown with a single style
+USTRUCT(BlueprintType)
+struct FTwitchDisplayRun
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	ETwitchDisplayRunType Type = ETwitchDisplayRunType::TEXT;
+
+	// First character of the run in the message
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	int32 Start = 0;
+
+	// Number of characters in the run
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	int32 Length = 0;
+
+	// Twitch id of the emote, for emote runs
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	FString EmoteId;
+};
+
+/**
+ * How a chat line is displayed, worked out by the receiver thread from the message tags.
+ * The runs cover the whole message in order, so UI code only has to create a text or image element per run.
+ */
+USTRUCT(BlueprintType)
+struct FTwitchChatDisplayLine
+{
+	GENERATED_BODY()
+
+	// Name to show for the sender, from the display-name tag or else the username
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	FString DisplayName;
+
+	// Color the sender picked for their name
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	FLinearColor NameColor = FLinearColor::White;
+
+	// False if the sender never picked a color, NameColor should then be replaced by a default one
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	bool bHasNameColor = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Display")
+	TArray<FTwitchDisplayRun> Runs;
+
+	/**
+	 * Splits a message into text and emote runs.
+	 * Emote positions in the tag count unicode code points, they are converted to positions in the message characters.
+	 * Malformed, overlapping or out of range emotes are shown as text.
+	 * @param message - Content of the message
+	 * @param emotesTag - Value of the emotes tag, ie. "25:0-4,12-16/1902:6-10"
+	 * @param runsOut - The runs
+	 */
+	static TWITCHPLAY_API void BuildRuns(const FString& message, const FString& emotesTag, TArray<FTwitchDisplayRun>& runsOut);
+};
+
+using FTwitchChatDisplayLinePtr = TSharedPtr<const FTwitchChatDisplayLine, ESPMode::ThreadSafe>;
@@ -0,0 +1,114 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+#include "Chat/TwitchChatDisplay.h"
+#include "TwitchChatHistory.generated.h"
+
+class FTwitchChatIndex;
+
+// A chat message kept in the history
+USTRUCT(BlueprintType)
+struct FTwitchChatHistoryEntry
+{
+	GENERATED_BODY()
+
+	// Id of the record, increasing with each message received
+	UPROPERTY(BlueprintReadOnly, Category = "History")
+	int64 RecordId = 0;
+
+	// Username of who sent the message
+	UPROPERTY(BlueprintReadOnly, Category = "History")
+	FString Username;
+
+	// Content of the message
+	UPROPERTY(BlueprintReadOnly, Category = "History")
+	FString Message;
+
+	// Roles of the sender (ETwitchUserRole flags)
+	UPROPERTY(BlueprintReadOnly, Category = "History", meta = (Bitmask, BitmaskEnum = "ETwitchUserRole"))
+	int32 Roles = 0;
+
+	// When the message was received, UTC
+	UPROPERTY(BlueprintReadOnly, Category = "History")
+	FDateTime ReceivedAt;
+
+	// How to display the message, null unless the IRC component builds display lines
+	FTwitchChatDisplayLinePtr Display;
+};
+
+/**
+ * Ring of the last received chat messages, filled on the receiver thread.
+ * Records get increasing ids. Once the ring is full each new message overwrites the oldest one.
+ * Readers on any thread share a read lock, so the game thread can page through history while chat keeps arriving.
+ * Optionally an inverted index is kept up to date on a background thread to search the history.
+ */
+class TWITCHPLAY_API FTwitchChatHistory final : public ITwitchChatStage
+{
+public:
+
+	/**
+	 * @param capacity - Number of messages kept
+	 * @param bIndexed - If true, keeps an inverted index of the words and senders to search with
+	 */
+	FTwitchChatHistory(const int32 capacity, const bool bIndexed);
+	~FTwitchChatHistory();
+
+	/**
+	 * Gets a record, if it is still in the ring.
+	 * @return Whether the record was found
+	 */
+	bool GetRecord(const uint64 recordId, FTwitchChatHistoryEntry& recordOut) const;
+
+	/**
+	 * Gets consecutive records, skipping the ones that are no longer in the ring.
+	 * @param firstId - Id of the first record
+	 * @param count - Maximum number of records
+	 * @param recordsOut - The records, oldest first
+	 */
+	void GetRecords(const uint64 firstId, const int32 count, TArray<FTwitchChatHistoryEntry>& recordsOut) const;
+
+	// Id of the oldest record in the ring, 0 if empty
+	uint64 GetOldestId() const;
+
+	// Id of the newest record in the ring, 0 if empty
+	uint64 GetNewestId() const;
+
+	int32 GetCapacity() const { return Records.Num(); }
+
+	bool IsIndexed() const { return Index.IsValid(); }
+
+	/**
+	 * Finds the newest messages containing all the words of a text and/or sent by a user.
+	 * Uses the index when there is one, else scans the whole ring.
+	 * @param text - Words to look for, case insensitive
+	 * @param username - Sender to look for, empty for anyone
+	 * @param maxResults - Maximum number of messages
+	 * @param resultsOut - The messages found, newest first
+	 */
+	void Search(const FString& text, const FString& username, const int32 maxResults, TArray<FTwitchChatHistoryEntry>& resultsOut) const;
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+
+private:
+
+	// Id of the oldest record, with the lock held
+	uint64 GetOldestIdLocked() const;
+
+	// Records, a record lives in slot id % capacity
+	TArray<FTwitchChatHistoryEntry> Records;
+
+	uint64 NewestId;
+
+	mutable FRWLock Lock;
+
+	// Search index, only if indexed
+	TUniquePtr<FTwitchChatIndex> Index;
+};
+
+using FTwitchChatHistoryPtr = TSharedPtr<FTwitchChatHistory, ESPMode::ThreadSafe>;
@@ -0,0 +1,82 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+
+class FTwitchChatHistory;
+
+/**
+ * Inverted index of a chat history, from each word and sender to the ids of the records containing it.
+ * New records are tokenized and indexed on its own thread, so the receiver thread only has to wake it up.
+ * Posting lists are sorted by id, so the ids that fell out of the history ring are pruned from their front
+ * by a sweep that visits a bounded number of lists each time.
+ */
+class TWITCHPLAY_API FTwitchChatIndex final : public FRunnable
+{
+public:
+
+	explicit FTwitchChatIndex(const FTwitchChatHistory& history);
+	virtual ~FTwitchChatIndex();
+
+	// Wakes up the index thread to index the new records. Can be called from any thread.
+	void NotifyAppended();
+
+	/**
+	 * Finds the records containing all the tokens. Can be called from any thread.
+	 * @param tokens - Tokens, as made by Tokenize or MakeSenderToken
+	 * @param oldestId - Ids below this are no longer in the history
+	 * @param maxResults - Maximum number of ids
+	 * @param recordIdsOut - Ids found, newest first
+	 */
+	void Find(const TArray<FString>& tokens, const uint64 oldestId, const int32 maxResults, TArray<uint64>& recordIdsOut) const;
+
+	// Splits a text into lowercase word tokens, without duplicates
+	static void Tokenize(const FString& text, TArray<FString>& tokensOut);
+
+	// Token of the records sent by a user
+	static FString MakeSenderToken(const FString& username) { return TEXT("@") + username.ToLower(); }
+
+	//
+	// FRunnable interface.
+	//
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+
+	struct FPostingList
+	{
+		FString Token;
+		// Record ids, increasing. The ones before Head were pruned.
+		TArray<uint64> Ids;
+		int32 Head = 0;
+	};
+
+	// Indexes the records appended since the last call
+	void IndexNewRecords();
+
+	// Prunes the ids that fell out of the history from a bounded number of posting lists
+	void Prune(const uint64 oldestId, const int32 maxLists);
+
+	const FTwitchChatHistory& History;
+
+	// Posting list of each token
+	TMap<FString, int32> TokenLists;
+	TArray<FPostingList> Postings;
+	TArray<int32> FreePostings;
+
+	// Next posting list to prune
+	int32 PruneCursor;
+
+	// Newest record indexed. Only touched by the index thread.
+	uint64 LastIndexedId;
+
+	// The index thread writes, searches read
+	mutable FRWLock Lock;
+
+	FEvent* WorkEvent;
+	FRunnableThread* Thread;
+	FThreadSafeBool bShouldExit;
+};
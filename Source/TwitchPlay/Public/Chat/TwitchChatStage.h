@@ -0,0 +1,35 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatTypes.h"
+
+/**
+ * A stage of the receive pipeline. Each batch of chat messages goes through the installed stages on the receiver thread,
+ * after the user filter and the command rules and before identical commands are coalesced, so stages see every single call.
+ * Stages outlive connections and can be read from the game thread, so they guard their own state.
+ */
+class ITwitchChatStage
+{
+public:
+
+	virtual ~ITwitchChatStage() {}
+
+	/**
+	 * Called on the receiver thread with each batch of received chat messages.
+	 * @param messages - The messages, with registered commands already parsed and authorized
+	 */
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) = 0;
+
+	/**
+	 * Called on the receiver thread when users leave the channel (PART), or are timed out or banned (CLEARCHAT).
+	 * @param usernames - Login names of the users, lowercase
+	 */
+	virtual void ProcessDepartures(const TArray<FString>& usernames) {}
+};
+
+using FTwitchChatStagePtr = TSharedPtr<ITwitchChatStage, ESPMode::ThreadSafe>;
+
+// Immutable snapshot of the installed stages, published to the receiver thread
+using FTwitchChatStagesPtr = TSharedPtr<const TArray<FTwitchChatStagePtr>, ESPMode::ThreadSafe>;
@@ -0,0 +1,169 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+#include "TwitchChatTypes.generated.h"
+
+class FTwitchAssetPrefetcher;
+struct FTwitchChatDisplayLine;
+
+/**
+ * Roles a chat user can have, interned from the user's badge set.
+ * Used as a bitmask so permission checks are a single AND.
+ */
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class ETwitchUserRole : uint8
+{
+	NONE = 0 UMETA(Hidden),
+	// Owner of the channel. Broadcasters are also given the MODERATOR role.
+	BROADCASTER = 1 << 0,
+	// Channel moderator
+	MODERATOR = 1 << 1,
+	// Channel VIP
+	VIP = 1 << 2,
+	// Channel subscriber. Founders are also given the SUBSCRIBER role.
+	SUBSCRIBER = 1 << 3,
+	// One of the first subscribers of the channel
+	FOUNDER = 1 << 4,
+	// Twitch staff, admins and global moderators
+	STAFF = 1 << 5,
+	// Twitch partner
+	PARTNER = 1 << 6,
+	// Turbo or Prime user
+	TURBO = 1 << 7,
+};
+ENUM_CLASS_FLAGS(ETwitchUserRole);
+
+/**
+ * A single chat message received from Twitch, along with what the receiver thread
+ * already worked out about it.
+ */
+struct FTwitchChatMessage
+{
+	// Username of who sent the message
+	FString Username;
+
+	// Content of the message
+	FString Message;
+
+	// Interned id of the sender. From the user-id tag when available, else from the username.
+	uint64 UserKey = 0;
+
+	// Roles of the sender, interned from the badges tag
+	ETwitchUserRole Roles = ETwitchUserRole::NONE;
+
+	// Bits cheered with the message, from the bits tag
+	int32 Bits = 0;
+
+	// Monotonic time (FPlatformTime::Seconds) the message was received at
+	double ReceivedTime = 0.0;
+
+	// Registered command found in the message, empty if none or if the sender is not allowed to use it
+	FString Command;
+
+	// Options of the command
+	TArray<FString> Options;
+
+	// True if the message is a registered command the sender is not allowed to use.
+	// Command is cleared, stages must skip the message instead of parsing it again.
+	bool bCommandRejected = false;
+
+	// True if this is a batch of identical commands merged by the receiver thread instead of a single chat message
+	bool bIsCoalesced = false;
+
+	// Number of identical commands merged into this batch
+	int32 Count = 1;
+
+	// First distinct senders of the merged commands, capped by the command rule
+	TArray<FString> Senders;
+
+	// How to display the message, built by the receiver thread when display lines are enabled
+	TSharedPtr<const FTwitchChatDisplayLine, ESPMode::ThreadSafe> Display;
+
+	/**
+	 * Interns a numeric Twitch user id or a login name into a user key.
+	 * Ids map to themselves, names are hashed case insensitively into a separate range so the two never overlap.
+	 */
+	static TWITCHPLAY_API uint64 MakeUserKey(const FString& userIdOrName);
+};
+
+// How a registered command is handled by the receiver thread
+struct FTwitchCommandRule
+{
+	// Sender must have at least one of these roles. NONE allows everyone.
+	ETwitchUserRole RequiredRoles = ETwitchUserRole::NONE;
+
+	// If above 0, identical commands (same command and options) received within this many seconds are merged into one dispatch
+	float CoalesceSeconds = 0.0f;
+
+	// Maximum number of senders listed in a merged dispatch
+	int32 MaxCoalescedSenders = 0;
+};
+
+// Assets a command handler is going to need, streamed in as soon as the receiver thread parses the command
+struct FTwitchCommandAssets
+{
+	// Assets needed whatever the options are
+	TArray<FSoftObjectPath> Assets;
+
+	// Assets needed when a given option is passed (ie. the dragon for !spawn#dragon#)
+	TMap<FString, TArray<FSoftObjectPath>> OptionAssets;
+};
+
+/**
+ * Immutable snapshot of the registered commands, published to the receiver thread so
+ * commands can be parsed and authorized before they reach the game thread.
+ */
+struct TWITCHPLAY_API FTwitchCommandRules
+{
+	// Characters encapsulating a command
+	FString CommandDelimiter;
+
+	// Characters encapsulating the command options
+	FString OptionsDelimiter;
+
+	// Registered commands (CASE SENSITIVE)
+	TMap<FString, FTwitchCommandRule> Commands;
+
+	// Assets to prefetch per registered command
+	TMap<FString, FTwitchCommandAssets> CommandAssets;
+
+	// Streams the command assets in, not set if no command has assets
+	TWeakPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> Prefetcher;
+
+	/**
+	 * Finds a registered command in the message the sender is allowed to use.
+	 *
+	 * @param message - The chat message to search
+	 * @param roles - Roles of the sender
+	 * @param commandOut - The command found
+	 * @param optionsOut - The options of the command found
+	 * @param bRejectedOut - If not null, set to whether the command is registered but the sender is not allowed to use it
+	 *
+	 * @return The rule of the command, nullptr if there is no registered command or the sender is not allowed to use it.
+	 */
+	const FTwitchCommandRule* ParseCommand(const FString& message, const ETwitchUserRole roles, FString& commandOut, TArray<FString>& optionsOut,
+		bool* bRejectedOut = nullptr) const;
+
+	/**
+	 * Adds the assets the command needs with the given options to the list, skipping the ones already in it.
+	 *
+	 * @return Whether any asset was added
+	 */
+	bool GetCommandAssets(const FString& command, const TArray<FString>& options, TArray<FSoftObjectPath>& assetsOut) const;
+
+	/**
+	 * Returns the string encapsulated between the first two delimiters of the input string.
+	 * Returns "" if no delimited string can be found.
+	 */
+	static FString GetDelimitedString(const FString& inString, const FString& delimiter);
+
+	/**
+	 * Interns a badges tag value (ie. "moderator/1,subscriber/12") into a role mask.
+	 */
+	static ETwitchUserRole GetRolesFromBadges(const FString& badges);
+};
+
+using FTwitchCommandRulesPtr = TSharedPtr<const FTwitchCommandRules, ESPMode::ThreadSafe>;
@@ -0,0 +1,119 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+#include "TwitchChatterTracker.generated.h"
+
+// What a chatter did since the last batch
+USTRUCT(BlueprintType)
+struct FTwitchChatterUpdate
+{
+	GENERATED_BODY()
+
+	// Interned id of the chatter, from the user id when available. Stable for as long as the chatter is tracked.
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	int64 ChatterId = 0;
+
+	// Login name of the chatter
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	FString Username;
+
+	// Roles of the chatter (ETwitchUserRole flags)
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters", meta = (Bitmask, BitmaskEnum = "ETwitchUserRole"))
+	int32 Roles = 0;
+
+	// Number of messages the chatter sent since the last batch
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	int32 NewMessages = 0;
+
+	// Last registered command the chatter sent since the last batch, empty if none
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	FString LastCommand;
+
+	// Options of the last command
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	TArray<FString> LastOptions;
+};
+
+/**
+ * Chatters that joined, were updated or left since the last batch.
+ * Apply Departed first: a chatter that left and came back within a batch is both in Departed and in Joined.
+ */
+USTRUCT(BlueprintType)
+struct FTwitchChatterBatch
+{
+	GENERATED_BODY()
+
+	// Chatters seen for the first time, to create
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	TArray<FTwitchChatterUpdate> Joined;
+
+	// Chatters already known that sent messages, to update
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	TArray<FTwitchChatterUpdate> Updated;
+
+	// Ids of the chatters that left the channel or were timed out or banned, to remove
+	UPROPERTY(BlueprintReadOnly, Category = "Chatters")
+	TArray<int64> Departed;
+};
+
+/**
+ * Tracks the chatters of the channel on the receiver thread and merges what they do into one batch per frame,
+ * so a game showing every chatter as a unit creates and updates them in bulk instead of once per message.
+ * All the messages of a chatter within a frame make a single update.
+ */
+class TWITCHPLAY_API FTwitchChatterTracker final : public ITwitchChatStage
+{
+public:
+
+	// @param maxChatters - Maximum number of chatters tracked, 0 for no limit. Chatters over the limit are ignored until others leave.
+	explicit FTwitchChatterTracker(const int32 maxChatters);
+
+	/**
+	 * Takes the changes since the last call. Can be called from any thread.
+	 * @return Whether anything changed
+	 */
+	bool GatherBatch(FTwitchChatterBatch& batchOut);
+
+	// Number of chatters tracked
+	int32 Num() const;
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+	virtual void ProcessDepartures(const TArray<FString>& usernames) override;
+
+private:
+
+	struct FPendingUpdate
+	{
+		FTwitchChatterUpdate Update;
+		uint64 UserKey;
+		// First seen in this batch
+		bool bJoined;
+	};
+
+	// Drops the pending update of a chatter, if any. Returns whether the chatter joined in this batch.
+	bool RemovePendingUpdate(const uint64 userKey);
+
+	const int32 MaxChatters;
+
+	// User key of each tracked chatter, by name key
+	TMap<uint64, uint64> KeysByName;
+
+	// Name key of each tracked chatter, by user key
+	TMap<uint64, uint64> NamesByKey;
+
+	// Updates of the current batch, and where each chatter's is
+	TArray<FPendingUpdate> PendingUpdates;
+	TMap<uint64, int32> PendingIndices;
+	TArray<int64> PendingDepartures;
+
+	// The receiver thread writes, the game thread gathers
+	mutable FCriticalSection Lock;
+};
+
+using FTwitchChatterTrackerPtr = TSharedPtr<FTwitchChatterTracker, ESPMode::ThreadSafe>;
@@ -0,0 +1,92 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "TwitchCommandProfiler.generated.h"
+
+// Cost of the handlers of a command
+USTRUCT(BlueprintType)
+struct FTwitchCommandCost
+{
+	GENERATED_BODY()
+
+	// The command
+	UPROPERTY(BlueprintReadOnly, Category = "Profiling")
+	FString Command;
+
+	// Number of times its handler ran
+	UPROPERTY(BlueprintReadOnly, Category = "Profiling")
+	int32 Calls = 0;
+
+	// Seconds spent in its handler, all calls together
+	UPROPERTY(BlueprintReadOnly, Category = "Profiling")
+	float TotalSeconds = 0.0f;
+
+	// Seconds of its slowest call
+	UPROPERTY(BlueprintReadOnly, Category = "Profiling")
+	float MaxSeconds = 0.0f;
+};
+
+/**
+ * Times the handlers of registered commands, to find the one behind a frame spike during a chat burst.
+ * Only runs while TwitchPlay.ProfileCommands is set, otherwise a dispatch costs one console variable read.
+ * Costs are kept per command for the whole process, and each command also gets its own cycle stat in the TwitchPlay stats group.
+ * Game thread only.
+ */
+class TWITCHPLAY_API FTwitchCommandProfiler
+{
+public:
+
+	// Times a handler call for as long as it is in scope
+	class TWITCHPLAY_API FScope
+	{
+	public:
+
+		explicit FScope(const FString& command);
+		~FScope();
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+
+		// Null while profiling is off
+		const FString* Command;
+		uint64 StartCycles;
+#if STATS
+		TOptional<FScopeCycleCounter> CycleCounter;
+#endif
+	};
+
+	static FTwitchCommandProfiler& Get();
+
+	// Is TwitchPlay.ProfileCommands set?
+	static bool IsEnabled();
+
+	void AddSample(const FString& command, const uint64 cycles);
+
+	// Gets the commands that took the most time, slowest first. 0 for all of them.
+	void GetTopOffenders(const int32 count, TArray<FTwitchCommandCost>& costsOut) const;
+
+	void Reset();
+
+private:
+
+	struct FCost
+	{
+		int32 Calls = 0;
+		uint64 TotalCycles = 0;
+		uint64 MaxCycles = 0;
+	};
+
+#if STATS
+	// Cycle stat of a command, created the first time it is profiled
+	TStatId GetStatId(const FString& command);
+
+	TMap<FString, TStatId> StatIds;
+#endif
+
+	TMap<FString, FCost> Costs;
+};
@@ -0,0 +1,145 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Styling/SlateBrush.h"
+#include "Interfaces/IHttpRequest.h"
+#include "TwitchEmoteCache.generated.h"
+
+class UTexture2D;
+class IImageWrapperModule;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FTwitchEmoteReady, const FString&, emoteId);
+
+/**
+ * Cache of emote images by Twitch emote id, packed into a single atlas texture so a chat full of emotes is drawn from one texture.
+ * Missing emotes are downloaded, or loaded from the disk cache, then decoded on worker threads. Only the copy into
+ * the atlas happens on the game thread. When the atlas is full the least recently used emote makes room.
+ */
+UCLASS(BlueprintType, EditInlineNew, DefaultToInstanced)
+class TWITCHPLAY_API UTwitchEmoteCache : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UTwitchEmoteCache();
+
+	// URL emote images are downloaded from, {id} is replaced by the emote id. Point it to a local server to test without Twitch.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emotes")
+	FString BaseUrl;
+
+	// Size in pixels of an emote in the atlas. Images of another size are scaled to fit.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Emotes", meta = (ClampMin = "8", ClampMax = "112"))
+	int32 EmoteSize;
+
+	// Size in pixels of the atlas texture, which sets how many emotes are kept
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Emotes", meta = (ClampMin = "128", ClampMax = "4096"))
+	int32 AtlasSize;
+
+	// If true, downloaded images are kept in Saved/TwitchPlay/Emotes so the next runs don't download them again
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Emotes")
+	bool bUseDiskCache;
+
+	// Event called when an emote that was requested is in the atlas
+	UPROPERTY(BlueprintAssignable, Category = "Emotes")
+	FTwitchEmoteReady OnEmoteReady;
+
+	/**
+	 * Gets the brush of an emote, drawing it from the atlas. If the emote isn't cached yet it is requested, and OnEmoteReady is called once it is.
+	 * @return Whether the emote is cached
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Emotes")
+	bool GetEmoteBrush(const FString& emoteId, FSlateBrush& brushOut);
+
+	// Requests an emote without drawing it yet, ie. as soon as a message with the emote is received
+	UFUNCTION(BlueprintCallable, Category = "Emotes")
+	void RequestEmote(const FString& emoteId);
+
+	// Texture the emotes are drawn from, null until the first emote is loaded
+	UFUNCTION(BlueprintPure, Category = "Emotes")
+	UTexture2D* GetAtlas() const { return Atlas; }
+
+	// Number of emotes in the atlas
+	UFUNCTION(BlueprintPure, Category = "Emotes")
+	int32 GetNumCachedEmotes() const { return CellsById.Num(); }
+
+	/**
+	 * Finds the brush of an emote, requesting the emote if it isn't cached. Game thread only.
+	 * The brush is owned by the cache and is reused for another emote once evicted, so look it up again each frame instead of keeping it.
+	 * @return The brush, null if the emote isn't cached yet
+	 */
+	const FSlateBrush* FindBrush(const FString& emoteId);
+
+private:
+
+	struct FCell
+	{
+		FString EmoteId;
+		FSlateBrush Brush;
+		// Neighbours in the LRU list, more recently used first
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+	};
+
+	// Creates the atlas on first use
+	void CreateAtlas();
+
+	// Path of an emote in the disk cache
+	FString GetDiskCachePath(const FString& emoteId) const;
+
+	void StartDownload(const FString& emoteId);
+
+	void OnDownloadComplete(FHttpRequestPtr request, FHttpResponsePtr response, bool bSucceeded, FString emoteId);
+
+	// Decodes an image on a worker thread, then adds it to the atlas on the game thread
+	void DecodeAsync(const FString& emoteId, TArray<uint8>&& compressedData, const bool bSaveToDisk);
+
+	// Copies a decoded emote into a free or evicted cell
+	void AddToAtlas(const FString& emoteId, TArray<uint8>&& pixels);
+
+	// Called when an emote could not be loaded
+	void OnEmoteFailed(const FString& emoteId);
+
+	// Decodes an image and scales it to fit a size x size BGRA square
+	static bool DecodeImage(IImageWrapperModule& imageWrapperModule, const TArray<uint8>& compressedData, const int32 size, TArray<uint8>& pixelsOut);
+
+	// Moves a cell to the front of the LRU list
+	void TouchCell(const int32 cellIndex);
+	void UnlinkCell(const int32 cellIndex);
+
+	UPROPERTY(Transient)
+	UTexture2D* Atlas;
+
+	// Cells of the atlas, in rows
+	TArray<FCell> Cells;
+	TArray<int32> FreeCells;
+	TMap<FString, int32> CellsById;
+
+	// Ends of the LRU list
+	int32 LruHead;
+	int32 LruTail;
+
+	// Emotes being downloaded or decoded
+	TSet<FString> PendingIds;
+
+	// An emote that could not be loaded
+	struct FFailedEmote
+	{
+		// Not requested again before this time
+		double RetryTime = 0.0;
+		int32 Failures = 0;
+	};
+
+	// Emotes that could not be loaded, retried with a growing delay
+	TMap<FString, FFailedEmote> FailedEmotes;
+
+	// Pixels between cells in the atlas, so filtering doesn't bleed neighbours in
+	static constexpr int32 CellPadding = 1;
+
+	int32 CellsPerRow;
+
+	IImageWrapperModule* ImageWrapperModule;
+};
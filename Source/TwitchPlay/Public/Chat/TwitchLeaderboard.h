@@ -0,0 +1,145 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TwitchLeaderboard.generated.h"
+
+// A viewer on the leaderboard
+USTRUCT(BlueprintType)
+struct FTwitchLeaderboardEntry
+{
+	GENERATED_BODY()
+
+	// Username of the viewer
+	UPROPERTY(BlueprintReadOnly, Category = "Leaderboard")
+	FString Username;
+
+	// Score of the viewer
+	UPROPERTY(BlueprintReadOnly, Category = "Leaderboard")
+	int64 Score = 0;
+
+	// Rank of the viewer, 1 for the top score
+	UPROPERTY(BlueprintReadOnly, Category = "Leaderboard")
+	int32 Rank = 0;
+};
+
+/**
+ * Viewer scores ranked highest first, stored as an order-statistics treap in a flat array.
+ * Each node knows the size of its subtree, so updating a score and finding the rank of a viewer are O(log n),
+ * and reading N entries from any rank is O(N + log n). Equal scores rank by who reached the score first.
+ * Not thread safe, meant to be updated from command handlers on the game thread.
+ */
+class TWITCHPLAY_API FTwitchLeaderboard
+{
+public:
+
+	FTwitchLeaderboard();
+
+	/**
+	 * Sets the score of a viewer, adding the viewer if needed.
+	 * @return The new rank of the viewer
+	 */
+	int32 SetScore(const FString& username, const int64 score);
+
+	/**
+	 * Adds to the score of a viewer, adding the viewer with a score of 0 first if needed.
+	 * @return The new rank of the viewer
+	 */
+	int32 AddScore(const FString& username, const int64 delta);
+
+	/**
+	 * Takes a viewer off the leaderboard.
+	 * @return Whether the viewer was on it
+	 */
+	bool Remove(const FString& username);
+
+	/**
+	 * Rank of a viewer, 1 for the top score.
+	 * @param scoreOut - If not null, the score of the viewer
+	 * @return 0 if the viewer is not on the leaderboard
+	 */
+	int32 GetRank(const FString& username, int64* scoreOut = nullptr) const;
+
+	/**
+	 * Gets consecutive entries, ie. the top 10 or the viewers around a given rank.
+	 * @param firstRank - Rank of the first entry, starting from 1
+	 * @param count - Maximum number of entries
+	 * @param entriesOut - The entries, best first
+	 */
+	void GetEntries(const int32 firstRank, const int32 count, TArray<FTwitchLeaderboardEntry>& entriesOut) const;
+
+	// Number of viewers on the leaderboard
+	int32 Num() const { return NodesByUser.Num(); }
+
+	// Removes everybody
+	void Reset();
+
+	// Changes each time a score changes, to skip refreshing a displayed leaderboard
+	uint32 GetRevision() const { return Revision; }
+
+private:
+
+	struct FNode
+	{
+		int64 Score = 0;
+		// Order the score was reached in, breaks ties
+		uint64 Sequence = 0;
+		uint64 UserKey = 0;
+		FString Username;
+		// Heap priority of the treap
+		uint32 Priority = 0;
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+		// Number of nodes in the subtree, this one included
+		int32 Size = 1;
+	};
+
+	// Does the node rank before the given score and sequence?
+	static bool RanksBefore(const FNode& node, const int64 score, const uint64 sequence)
+	{
+		return node.Score > score || (node.Score == score && node.Sequence < sequence);
+	}
+
+	int32 SizeOf(const int32 node) const { return node != INDEX_NONE ? Nodes[node].Size : 0; }
+
+	// Recomputes the subtree size of a node
+	void UpdateSize(const int32 node);
+
+	// Splits a subtree into the nodes ranking before the score and sequence, and the others
+	void Split(const int32 node, const int64 score, const uint64 sequence, int32& leftOut, int32& rightOut);
+
+	// Merges two subtrees, all the nodes of the left one ranking before the ones of the right one
+	int32 Merge(const int32 left, const int32 right);
+
+	// Links a detached node in the tree
+	void Insert(const int32 node);
+
+	// Unlinks a node from the tree, keeping it allocated
+	void Erase(const int32 node);
+
+	// Rank of a node in the tree, 1 based
+	int32 RankOf(const int32 node) const;
+
+	// Sets the score of a node and moves it to its new place
+	int32 UpdateScore(const int32 node, const int64 score);
+
+	// Finds or adds the node of a viewer
+	int32 FindOrAddNode(const FString& username);
+
+	// All the nodes, free ones are chained through Right
+	TArray<FNode> Nodes;
+	int32 FreeList;
+
+	int32 Root;
+
+	// Node of each viewer, by user key
+	TMap<uint64, int32> NodesByUser;
+
+	uint64 NextSequence;
+
+	// Xorshift state for the treap priorities
+	uint32 RandomState;
+
+	uint32 Revision;
+};
@@ -0,0 +1,51 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Outbound chat message parsed once into literal and placeholder segments.
+ * Placeholders are ordered like FString::Format, ie. "Welcome {0}, you have {1} points".
+ * Literals are kept UTF-8 encoded, so a send only encodes its arguments, straight into the outbound buffer.
+ * Immutable once parsed, shared with the sending thread.
+ */
+class TWITCHPLAY_API FTwitchMessageTemplate
+{
+public:
+
+	explicit FTwitchMessageTemplate(const FString& pattern);
+
+	// Appends the UTF-8 message for the arguments. Placeholders without an argument are left empty.
+	void Encode(const TArray<FString>& arguments, TArray<uint8>& bufferOut) const;
+
+	// Number of arguments the template uses
+	int32 GetNumArguments() const { return NumArguments; }
+
+	// Appends text to a buffer as UTF-8, without a terminator. CR and LF are replaced with spaces so text can't break the line.
+	static void AppendUtf8(const TCHAR* text, const int32 length, TArray<uint8>& bufferOut);
+	static void AppendUtf8(const FString& text, TArray<uint8>& bufferOut) { AppendUtf8(*text, text.Len(), bufferOut); }
+
+	// Appends an ASCII literal to a buffer, without a terminator
+	static void AppendAnsi(const ANSICHAR* text, TArray<uint8>& bufferOut);
+
+private:
+
+	struct FSegment
+	{
+		// Literal bytes, ignored by placeholders
+		int32 Offset;
+		int32 Length;
+		// Argument of a placeholder, INDEX_NONE for literals
+		int32 Argument;
+	};
+
+	TArray<FSegment> Segments;
+
+	// UTF-8 bytes of all the literals
+	TArray<uint8> Literals;
+
+	int32 NumArguments;
+};
+
+using FTwitchMessageTemplatePtr = TSharedPtr<const FTwitchMessageTemplate, ESPMode::ThreadSafe>;
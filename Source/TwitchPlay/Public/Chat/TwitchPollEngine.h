@@ -0,0 +1,187 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+#include "TwitchPollEngine.generated.h"
+
+class FTwitchAssetPrefetcher;
+
+// Snapshot of the state of a poll
+USTRUCT(BlueprintType)
+struct FTwitchPollResult
+{
+	GENERATED_BODY()
+
+	// Id returned when the poll was started
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	int32 PollId = INDEX_NONE;
+
+	// Command chat votes with
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	FString Command;
+
+	// Options of the poll
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	TArray<FString> Options;
+
+	// Weighted votes of each option
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	TArray<float> Tallies;
+
+	// Number of voters of each option
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	TArray<int32> Voters;
+
+	// Index of the option with the highest tally, -1 while nobody voted
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	int32 LeadingOption = INDEX_NONE;
+
+	// Seconds until the poll closes. 0 for closed polls and polls without a duration.
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	float SecondsRemaining = 0.0f;
+
+	// Is the poll still taking votes?
+	UPROPERTY(BlueprintReadOnly, Category = "Polls")
+	bool bIsOpen = false;
+};
+
+// How a poll is voted on and weighted
+struct FTwitchPollDefinition
+{
+	// Command chat votes with, the option is the first command option (ie. !vote#red#). Options can also be voted by number, starting from 1.
+	FString Command;
+
+	// Options to vote for, case insensitive
+	TArray<FString> Options;
+
+	// Seconds the poll stays open. 0 keeps it open until it is ended.
+	double DurationSeconds = 0.0;
+
+	// Voter must have at least one of these roles. NONE allows everyone.
+	ETwitchUserRole RequiredRoles = ETwitchUserRole::NONE;
+
+	// Weight of a subscriber vote, a plain vote weighs 1
+	float SubscriberMultiplier = 1.0f;
+
+	// Weight added to a vote for each bit cheered with it. Cheering again for the same option adds up.
+	float WeightPerBit = 0.0f;
+
+	// Can voters move their vote to another option?
+	bool bAllowVoteChange = false;
+
+	// Assets to prefetch when each option takes the lead, by option index
+	TArray<TArray<FSoftObjectPath>> OptionAssets;
+
+	// Streams the option assets in
+	TWeakPtr<FTwitchAssetPrefetcher, ESPMode::ThreadSafe> Prefetcher;
+};
+
+/**
+ * Runs any number of concurrent polls on the receiver thread.
+ * All the polls voted with the same command share an index from option to polls, so each message costs two map lookups
+ * however many polls are running, instead of being handed to every poll.
+ * Votes are tallied as they arrive. The game thread gathers snapshots of the polls that changed once per tick.
+ */
+class TWITCHPLAY_API FTwitchPollEngine final : public ITwitchChatStage
+{
+public:
+
+	FTwitchPollEngine();
+
+	/**
+	 * Starts a poll. Can be called from any thread.
+	 * @return Id of the poll, INDEX_NONE if the definition has no command or no options
+	 */
+	int32 StartPoll(FTwitchPollDefinition&& definition);
+
+	/**
+	 * Closes a poll. Its final result is handed out by the next GatherResults.
+	 * @return Whether the poll was open
+	 */
+	bool EndPoll(const int32 pollId);
+
+	// Sets the delimiters votes are parsed with when the vote command is not a registered command
+	void SetDelimiters(const FString& commandDelimiter, const FString& optionsDelimiter);
+
+	/**
+	 * Gets a snapshot of a poll.
+	 * @return Whether the poll exists
+	 */
+	bool GetResult(const int32 pollId, FTwitchPollResult& resultOut) const;
+
+	/**
+	 * Gets the snapshots of the polls that changed since the last call, and the final results of the polls that closed.
+	 * Closed polls are removed.
+	 */
+	void GatherResults(TArray<FTwitchPollResult>& updatedOut, TArray<FTwitchPollResult>& endedOut);
+
+	// Number of running polls
+	int32 Num() const;
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+
+private:
+
+	struct FPollVote
+	{
+		int32 Option;
+		double Weight;
+	};
+
+	struct FPoll
+	{
+		FTwitchPollDefinition Definition;
+		// Monotonic close time, 0 if open until ended
+		double EndTime = 0.0;
+		TArray<double> Tallies;
+		TArray<int32> Voters;
+		// Vote of each voter, by user key
+		TMap<uint64, FPollVote> Votes;
+		int32 LeadingOption = INDEX_NONE;
+		bool bEnded = false;
+		// Bumped on each change, compared to the last gathered one
+		uint32 Revision = 0;
+		uint32 GatheredRevision = 0;
+	};
+
+	// An option of a poll a vote string maps to
+	struct FPollTarget
+	{
+		int32 PollId;
+		int32 Option;
+	};
+
+	using FOptionIndex = TMap<FString, TArray<FPollTarget, TInlineAllocator<2>>>;
+
+	// Adds a vote to a poll. Returns whether the poll changed.
+	bool CastVote(FPoll& poll, const int32 option, const FTwitchChatMessage& message);
+
+	// Rebuilds the vote index after polls were added or removed
+	void RebuildIndex();
+
+	// Maps a vote key to an option of a poll, unless the key already maps to another option of that poll
+	static void AddPollTarget(TArray<FPollTarget, TInlineAllocator<2>>& targets, const int32 pollId, const int32 option);
+
+	void FillResult(const int32 pollId, const FPoll& poll, const double now, FTwitchPollResult& resultOut) const;
+
+	// Running polls, by id
+	TMap<int32, FPoll> Polls;
+
+	// Command, then option name or number, to the polls taking it
+	TMap<FString, FOptionIndex> VoteIndex;
+
+	FString CommandDelimiter;
+	FString OptionsDelimiter;
+
+	int32 NextPollId;
+
+	// Polls are started and gathered on the game thread and voted on the receiver thread
+	mutable FCriticalSection Lock;
+};
+
+using FTwitchPollEnginePtr = TSharedPtr<FTwitchPollEngine, ESPMode::ThreadSafe>;
@@ -0,0 +1,93 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+
+// Who can enter a raffle and how entrants are weighted
+struct FTwitchRaffleDefinition
+{
+	// Command chat enters with (ie. enter for !enter!)
+	FString Command;
+
+	// Characters encapsulating the command, when it is not a registered command
+	FString CommandDelimiter;
+
+	// Number of winners drawn
+	int32 NumWinners = 1;
+
+	// Entrant must have at least one of these roles. NONE allows everyone.
+	ETwitchUserRole RequiredRoles = ETwitchUserRole::NONE;
+
+	// Weight of a subscriber entry, a plain entry weighs 1
+	float SubscriberWeight = 1.0f;
+
+	// Weight added to an entry for each bit cheered with it
+	float WeightPerBit = 0.0f;
+
+	// Seed of the draw, 0 for a random one
+	int32 Seed = 0;
+};
+
+/**
+ * Raffle over any number of chat entrants, run on the receiver thread.
+ * Entries are deduped exactly on the user key and sampled with weighted reservoir sampling (Efraimidis-Spirakis A-Res):
+ * each entrant draws the key u^(1/weight) and only the NumWinners highest keys are kept, in a min-heap.
+ * Only the user keys grow with the entrants (8 bytes each plus the set overhead), usernames are kept for the reservoir alone.
+ * Drawing just sorts the reservoir, however many viewers entered.
+ */
+class TWITCHPLAY_API FTwitchRaffle final : public ITwitchChatStage
+{
+public:
+
+	explicit FTwitchRaffle(FTwitchRaffleDefinition&& definition);
+
+	/**
+	 * Closes the raffle and gets the winners, in draw order. Can be called from any thread.
+	 * @param winnersOut - Usernames of the winners. Fewer than NumWinners if not enough viewers entered.
+	 */
+	void Draw(TArray<FString>& winnersOut);
+
+	// Number of distinct entrants so far
+	int32 GetNumEntrants() const;
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+
+private:
+
+	struct FEntrant
+	{
+		// Log of the sampling key, log(u)/weight. Higher wins.
+		double Key;
+		FString Username;
+
+		// Min-heap on the key, the weakest kept entrant is on top
+		bool operator<(const FEntrant& other) const { return Key < other.Key; }
+	};
+
+	// Uniform random number in (0, 1] with double precision
+	double GetRandomFraction();
+
+	const FTwitchRaffleDefinition Definition;
+
+	// The NumWinners entrants with the highest keys
+	TArray<FEntrant> Reservoir;
+
+	// Keys of the users that already entered
+	TSet<uint64> Entered;
+
+	FRandomStream Random;
+
+	int32 NumEntrants;
+
+	bool bIsOpen;
+
+	// Entries come from the receiver thread, the draw from the game thread
+	mutable FCriticalSection Lock;
+};
+
+using FTwitchRafflePtr = TSharedPtr<FTwitchRaffle, ESPMode::ThreadSafe>;
@@ -0,0 +1,110 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// Chat load in CSV profiles, recorded per frame
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(TWITCHPLAY_API, TwitchPlay);
+
+// Game thread costs of the plugin, see stat TwitchPlay
+DECLARE_STATS_GROUP(TEXT("TwitchPlay"), STATGROUP_TwitchPlay, STATCAT_Advanced);
+
+// Values of the stats at one point in time
+struct FTwitchStatsSnapshot
+{
+	int64 Connected = 0;
+	int64 Connections = 0;
+	int64 Reconnects = 0;
+	int64 Disconnects = 0;
+	int64 LinesReceived = 0;
+	int64 MessagesReceived = 0;
+	int64 MessagesFiltered = 0;
+	int64 ReceiveQueueDepth = 0;
+	int64 SendQueueDepth = 0;
+	int64 MessagesSent = 0;
+	int64 SendFailures = 0;
+	int64 RateLimitWaits = 0;
+	int64 CommandsDropped = 0;
+	int64 CommandsRejected = 0;
+	int64 ParseMicroseconds = 0;
+	int64 DispatchLatencyMicroseconds = 0;
+	int64 RoundTripMicroseconds = -1;
+};
+
+/**
+ * Health counters of all the Twitch connections of the process.
+ * Receiver and game threads only do atomic adds on them, and snapshots are plain atomic reads,
+ * so reading the stats never contends with chat.
+ */
+class TWITCHPLAY_API FTwitchStats
+{
+public:
+
+	static FTwitchStats& Get();
+
+	// Connections logged in right now
+	FThreadSafeCounter64 Connected;
+
+	// Successful logins
+	FThreadSafeCounter64 Connections;
+
+	// Logins of a component that had been connected before
+	FThreadSafeCounter64 Reconnects;
+
+	// Connections lost without being asked to disconnect
+	FThreadSafeCounter64 Disconnects;
+
+	// IRC lines read from the server
+	FThreadSafeCounter64 LinesReceived;
+
+	// Chat messages parsed
+	FThreadSafeCounter64 MessagesReceived;
+
+	// Chat messages dropped by the user filter
+	FThreadSafeCounter64 MessagesFiltered;
+
+	// Chat messages waiting to be pulled by the game thread
+	FThreadSafeCounter64 ReceiveQueueDepth;
+
+	// Chat messages waiting to be sent
+	FThreadSafeCounter64 SendQueueDepth;
+
+	// Chat messages written to the socket
+	FThreadSafeCounter64 MessagesSent;
+
+	// Chat messages the socket refused
+	FThreadSafeCounter64 SendFailures;
+
+	// Sends held back by the time between messages
+	FThreadSafeCounter64 RateLimitWaits;
+
+	// Commands dropped because the command backlog was full
+	FThreadSafeCounter64 CommandsDropped;
+
+	// Registered commands sent by chatters without the required roles
+	FThreadSafeCounter64 CommandsRejected;
+
+	// Time receivers spent parsing and filtering chat, in microseconds
+	FThreadSafeCounter64 ParseMicroseconds;
+
+	// Longest wait between reading a message and dispatching it, in the last frame with messages, in microseconds
+	FThreadSafeCounter64 DispatchLatencyMicroseconds;
+
+	// Round trip of the last PING we sent, in microseconds. -1 until measured.
+	FThreadSafeCounter64 RoundTripMicroseconds;
+
+	FTwitchStatsSnapshot TakeSnapshot() const;
+
+	// Records the queue depths and the drops of the frame in the CSV profile. Called on the game thread at the end of each frame.
+	void RecordCsvFrame();
+
+private:
+
+	FTwitchStats();
+
+	// Drops counted when the last frame was recorded
+	int64 CsvRecordedDrops;
+};
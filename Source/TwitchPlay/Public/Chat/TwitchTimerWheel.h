@@ -0,0 +1,117 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Handle to a timer scheduled on a FTwitchTimerWheel
+struct FTwitchTimerHandle
+{
+	int32 Index = INDEX_NONE;
+	uint32 Serial = 0;
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	void Invalidate() { Index = INDEX_NONE; }
+};
+
+/**
+ * Hierarchical timer wheel driven by the monotonic platform clock.
+ * Scheduling, cancelling and expiring a timer are O(1) no matter how many timers are pending,
+ * so per-user cooldowns, vote windows, send pacing and keepalive deadlines can all share one wheel.
+ * Not thread safe. The receiver thread owns its wheel.
+ */
+class TWITCHPLAY_API FTwitchTimerWheel
+{
+public:
+
+	using FTimerCallback = TFunction<void()>;
+
+	// Number of slots per level
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 NumSlots = 1 << SlotBits;
+
+	// Number of levels. With the default 10ms tick the wheel covers about 46 hours.
+	static constexpr int32 NumLevels = 4;
+
+	/**
+	 * @param tickSeconds - Resolution of the wheel
+	 */
+	explicit FTwitchTimerWheel(const double tickSeconds = 0.01);
+
+	// Current monotonic time in seconds
+	static double Now() { return FPlatformTime::Seconds(); }
+
+	/**
+	 * Schedules a callback to fire after a delay. Callbacks can schedule and cancel timers.
+	 * @param delaySeconds - Seconds from now, rounded up to the wheel resolution
+	 * @param callback - The function to call when the timer expires
+	 * @return Handle to cancel the timer with
+	 */
+	FTwitchTimerHandle Schedule(const double delaySeconds, FTimerCallback&& callback);
+
+	/**
+	 * Cancels a pending timer and invalidates the handle.
+	 * @return Whether the timer was pending
+	 */
+	bool Cancel(FTwitchTimerHandle& handle);
+
+	// Is the timer still pending?
+	bool IsPending(const FTwitchTimerHandle& handle) const;
+
+	/**
+	 * Moves the wheel up to the current time, firing all expired timers.
+	 * @return Number of timers fired
+	 */
+	int32 Advance();
+
+	/**
+	 * Seconds until the next timer fires, or maxSeconds if nothing is due before that.
+	 * Used to sleep exactly as long as there's nothing to do.
+	 */
+	double GetSecondsUntilNextTimer(const double maxSeconds) const;
+
+	// Number of pending timers
+	int32 Num() const { return NumPending; }
+
+private:
+
+	struct FTimerNode
+	{
+		FTimerCallback Callback;
+		uint64 ExpireTick = 0;
+		int32 Prev = INDEX_NONE;
+		int32 Next = INDEX_NONE;
+		uint32 Serial = 0;
+		// Level * NumSlots + slot, INDEX_NONE when free
+		int32 Bucket = INDEX_NONE;
+	};
+
+	// Links the node in the bucket matching its expire tick
+	void Insert(const int32 nodeIndex);
+
+	// Unlinks the node from its bucket
+	void Unlink(const int32 nodeIndex);
+
+	// Re-inserts all timers of a higher level bucket into the lower levels
+	void Cascade(const int32 level);
+
+	// Fires all the timers of a level 0 slot
+	int32 Expire(const int32 slot);
+
+	uint64 GetTick(const double seconds) const;
+
+	// All the timers, free ones are chained through Next
+	TArray<FTimerNode> Nodes;
+	int32 FreeList;
+
+	// Head of each bucket list
+	int32 Buckets[NumLevels * NumSlots];
+
+	// Bit per non empty slot of each level
+	uint64 Occupied[NumLevels];
+
+	double StartTime;
+	double TickSeconds;
+	uint64 CurrentTick;
+	int32 NumPending;
+};
@@ -0,0 +1,50 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatTypes.h"
+#include "Chat/TwitchBloomFilter.h"
+
+/**
+ * Immutable blocklist or allowlist of chat users, checked on the receiver thread.
+ * A Bloom filter sits in front of an exact sorted array of user keys, so the common case of a user
+ * not being on a large list costs a few bit tests and no memory walk.
+ * Refresh a list by building a new filter and swapping it in.
+ */
+class TWITCHPLAY_API FTwitchUserFilter
+{
+public:
+
+	/**
+	 * Builds the filter. Can be slow for large lists, build it off the game thread.
+	 *
+	 * @param users - User ids or login names on the list
+	 * @param bInIsAllowlist - If true only users on the list are allowed, else users on the list are blocked
+	 * @param falsePositiveRate - Rate of Bloom filter hits that need the exact check
+	 */
+	FTwitchUserFilter(const TArray<FString>& users, const bool bInIsAllowlist, const double falsePositiveRate = 0.01);
+
+	// Should the message of this user be received?
+	bool IsAllowed(const FTwitchChatMessage& message) const;
+
+	// Is the user key on the list?
+	bool Contains(const uint64 userKey) const;
+
+	// Number of users on the list
+	int32 Num() const { return SortedKeys.Num(); }
+
+	bool IsAllowlist() const { return bIsAllowlist; }
+
+private:
+
+	// Bloom filter in front of the exact list
+	FTwitchBloomFilter Bloom;
+
+	// The exact list of user keys, sorted for binary search
+	TArray<uint64> SortedKeys;
+
+	bool bIsAllowlist;
+};
+
+using FTwitchUserFilterPtr = TSharedPtr<const FTwitchUserFilter, ESPMode::ThreadSafe>;
@@ -0,0 +1,109 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chat/TwitchChatStage.h"
+
+// How viewers join and leave a viewer queue
+struct FTwitchViewerQueueDefinition
+{
+	// Command chat joins the queue with (ie. join for !join!)
+	FString JoinCommand;
+
+	// Command chat leaves the queue with, empty for none
+	FString LeaveCommand;
+
+	// Characters encapsulating the commands, when they are not registered commands
+	FString CommandDelimiter;
+
+	// Maximum number of viewers in the queue, 0 for no limit
+	int32 MaxViewers = 0;
+
+	// Viewer must have at least one of these roles. NONE allows everyone.
+	ETwitchUserRole RequiredRoles = ETwitchUserRole::NONE;
+};
+
+/**
+ * First come first served line of viewers, filled on the receiver thread.
+ * Viewers are deduped by user key and leave the line when they leave the channel or are timed out or banned.
+ * Each viewer holds a slot in arrival order. A Fenwick tree over the slots counts the viewers still in line,
+ * so joining, leaving and looking up a position are O(log n) however long the line is.
+ */
+class TWITCHPLAY_API FTwitchViewerQueue final : public ITwitchChatStage
+{
+public:
+
+	explicit FTwitchViewerQueue(FTwitchViewerQueueDefinition&& definition);
+
+	/**
+	 * Position of a viewer in the line. Can be called from any thread.
+	 * @param username - Login name of the viewer
+	 * @return 1 for the next viewer, 0 if the viewer is not in line
+	 */
+	int32 GetPosition(const FString& username) const;
+
+	/**
+	 * Takes the next viewers out of the line. Can be called from any thread.
+	 * @param count - Maximum number of viewers to take
+	 * @param usernamesOut - Login names of the viewers, in line order
+	 */
+	void Dequeue(const int32 count, TArray<FString>& usernamesOut);
+
+	/**
+	 * Takes a viewer out of the line. Can be called from any thread.
+	 * @return Whether the viewer was in line
+	 */
+	bool Remove(const FString& username);
+
+	// Number of viewers in line
+	int32 Num() const;
+
+	//
+	// ITwitchChatStage interface.
+	//
+	virtual void ProcessMessages(const TArray<FTwitchChatMessage>& messages) override;
+	virtual void ProcessDepartures(const TArray<FString>& usernames) override;
+
+private:
+
+	struct FQueueSlot
+	{
+		uint64 UserKey = 0;
+		// Key of the login name, membership and moderation lines only carry the name
+		uint64 NameKey = 0;
+		FString Username;
+		bool bInLine = false;
+	};
+
+	// Adds a viewer at the end of the line
+	void Join(const FTwitchChatMessage& message);
+
+	// Frees the slot of a viewer
+	void RemoveSlot(const int32 slot);
+
+	// Fenwick tree update and prefix count, slots are 0 based
+	void TreeAdd(const int32 slot, const int32 delta);
+	int32 TreePrefixCount(const int32 slot) const;
+
+	// Drops the freed slots and rebuilds the tree with room to grow
+	void Compact();
+
+	const FTwitchViewerQueueDefinition Definition;
+
+	// Slots in arrival order. Slots before Head are all free.
+	TArray<FQueueSlot> Slots;
+	int32 Head;
+
+	// Fenwick tree of the viewers in line, 1 based. Its size bounds the number of slots.
+	TArray<int32> Tree;
+
+	// Slot of each viewer in line, by user key and by name key
+	TMap<uint64, int32> SlotsByUser;
+	TMap<uint64, int32> SlotsByName;
+
+	// Joins come from the receiver thread, lookups and dequeues from the game thread
+	mutable FCriticalSection Lock;
+};
+
+using FTwitchViewerQueuePtr = TSharedPtr<FTwitchViewerQueue, ESPMode::ThreadSafe>;
@@ -1,269 +1,820 @@
-// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "CoreTypes.h"
-#include "Components/ActorComponent.h"
-#include "Networking.h"
-#include "TwitchIRCComponent.generated.h"
-
-UENUM(BlueprintType)
-enum class ETwitchConnectionMessageType : uint8
-{
-	// A connection and authentication was established.
-	CONNECTED,
-	// Failed to connect.
-	FAILED_TO_CONNECT,
-	// Failed to authenticate.
-	FAILED_TO_AUTHENTICATE,
-	// A general error, doesn't mean the connection was terminated.
-	ERROR,
-	// General message from the server
-	MESSAGE,
-	// Disconnected from server.
-	DISCONNECTED
-};
-
-/**
- * Declaration of delegate type for messages received from chat.
- * Delegate signature should receive two parameters:
- * _message (const FString&) - Message received.
- * _username (const FString&) - Username of who sent the message.
- */
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTwitchMessageReceived, const FString&, message, const FString&, username);
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTwitchConnectionMessage, const ETwitchConnectionMessageType, type, const FString&, message);
-
-// Blob of user messages received
-struct FTwitchReceiveMessages
-{
-	TArray<FString> Usernames;
-	TArray<FString> Messages;
-};
-
-enum class ETwitchSendMessageType : uint8
-{
-	// User Chat Message
-	CHAT_MESSAGE,
-
-	// Join new channel message
-	JOIN_MESSAGE,
-};
-
-struct FTwitchSendMessage
-{
-	// The message type
-	ETwitchSendMessageType Type;
-	// The message
-	FString Message;
-	// The channel (can be empty)
-	FString Channel;
-};
-
-/**
- * Twitch messages reciever runnable
- */
-class FTwitchMessageReceiver final : public FRunnable
-{
-public:
-	using TwitchConnectionPair = TPair<ETwitchConnectionMessageType, FString>;
-	using FTwitchReceiveMessagesQueue = TQueue<FTwitchReceiveMessages, EQueueMode::Spsc>;
-	using FTwitchSendMessagesQueue = TQueue<FTwitchSendMessage, EQueueMode::Spsc>;
-	using FTwitchConnectionQueue = TQueue<TwitchConnectionPair, EQueueMode::Spsc>;
-	
-	FTwitchMessageReceiver();
-	virtual ~FTwitchMessageReceiver();
-
-	void StartConnection(const FString& auth, const FString& username, const FString& channel, const float timeBetweenMessages);
-
-	//
-	// FRunnable interface.
-	//
-	virtual uint32 Run() override;
-	virtual void Stop() override;
-	virtual void Exit() override;
-
-	void PullMessages(TArray<FString>& usernamesOut, TArray<FString>& messagesOut);
-	void SendMessage(const ETwitchSendMessageType type, const FString& message, const FString& channel);
-	bool PullConnectionMessage(ETwitchConnectionMessageType& statusOut, FString& messageOut);
-
-	void StopConnection(bool waitTillComplete);
-
-	bool IsConnected() const { return bIsConnected; }
-
-	void GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const
-	{
-		oauthOut = Oauth;
-		usernameOut = Username;
-		channelOut = Channel;
-	}
-
-private:
-
-	void SleepReceiver(float seconds);
-
-	FString ReceiveFromConnection() const;
-
-	/**
-	* Parses the message received from Twitch IRC chat in order to only get the content of the message.
-	* Since a single "message" could actually include multiple lines an array of strings is returned.
-	*
-	* @param message - Message to parse
-	* @param out_sender_username - The username(s) of the message sender(s). In sync with the return array.
-	* @param messagesOut - Parsed messages.
-	*
-	*/
-	void ParseMessage(const FString& message, TArray<FString>& out_sender_username, TArray<FString>& messagesOut);
-
-	/**
-	 * Send a message on the connected socket
-	 * @param message - The message to send
-	 * @param channel - The channel (or user) to send this message to
-	 */
-	bool SendIRCMessage(const FString& message, const FString channel = TEXT(""));
-
-	// Sending and recieving queues
-	TUniquePtr<FTwitchSendMessagesQueue> SendingQueue;
-	TUniquePtr<FTwitchReceiveMessagesQueue> ReceivingQueue;
-
-	// Connection status queue
-	TUniquePtr<FTwitchConnectionQueue> ConnectionQueue;
-
-	FSocket* ConnectionSocket;
-
-	FRunnableThread* MessagesThread;
-
-	FThreadSafeBool ShouldExit;
-
-	FThreadSafeBool bIsConnected;
-
-	// Authentication token. Need to get it from official Twitch API
-	FString Oauth;
-
-	// Username. Must be in lowercaps
-	FString Username;
-
-	// Channel to join upon successful connection	
-	FString Channel;
-
-	// True while we are waiting for the auth reply from the server
-	bool WaitingForAuth;
-
-	// The number of times auth has slept
-	int32 NumAuthWaits;
-
-	// A time accumulator while the thread is running. Precision isn't great, but accurate enough for general timing.
-	float AccumulationTime;
-
-	// The set time between messages
-	float TimeBetweenMessages;
-
-	// The next time to send a message
-	float NextSendMessageTime;
-};
-
-/**
- * Makes communication with Twitch IRC possible through UE4 sockets.
- * You can send and receive messages to/from channel chat.
- * Subscribe to OnMessageReceived to know when a message has harrived.
- * Remember to first Connect(), SetUserInfo() and then AuthenticateTwitchIRC() before trying to send messages.
- */
-UCLASS(ClassGroup = (TwitchAPI), meta = (BlueprintSpawnableComponent))
-class TWITCHPLAY_API UTwitchIRCComponent : public UActorComponent
-{
-	GENERATED_BODY()
-
-public:
-	// Event called each time a message is received
-	UPROPERTY(BlueprintAssignable, Category = "Message Events")
-	FTwitchMessageReceived OnMessageReceived;
-
-	// Event called each time a connection message occurs.
-	// Use this to determine if the connection was successful, or was disconnected, or an error occured.
-	// Also includes general server messages from connection commands, join commands, etc.
-	UPROPERTY(BlueprintAssignable, Category = "Message Events")
-	FTwitchConnectionMessage OnConnectionMessage;
-
-	// The seconds delay between sending chat messages. This is set to a safe time by default, but if your bot has elevated
-	// permissions you might be able to set this to a shorter time.
-	UPROPERTY(EditAnywhere, Category = "Setup")
-	float TimeBetweenChatMessages;
-	
-
-private:
-
-	// Message receiver runnable
-	TUniquePtr<FTwitchMessageReceiver> TwitchMessageReceiver;
-
-public:
-
-	// Sets default values for this component's properties
-	UTwitchIRCComponent();
-
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
-	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
-
-	/**
-	* Creates a socket and tries to connect to Twitch IRC server.
-	*
-	* @param oauth - Oauth token to use. Get one from official Twitch APIs.
-	* @param username - Username to login with. All low caps.
-	* @param channel - The channel to join upon connection. (optional, can call JoinChannel later)
-	*/
-	UFUNCTION(BlueprintCallable, Category = "Setup")
-    void Connect(const FString& oauth, const FString& username, const FString& channel);
-	
-	/**
-	 * Send a message on the connected socket
-	 * @param message - The message
-	 * @param channel - The channel (or user channel) to send this message to
-	 * @return Whether the message was sent to the worker thread. Check your connection callback for errors.
-	 */
-	UFUNCTION(BlueprintCallable, Category = "Messages")
-	bool SendChatMessage(const FString& message, const FString channel = TEXT(""));
-
-	/**
-	* Send a whisper message to a specific user on a channel on the connected socket
-	* NOTE: The user account being used as a bot must have command rights for whispers to work. See the connection
-	* log to find out if your user is unable to send whispers in this way.
-	* To request bot extended privilages, see https://dev.twitch.tv/limit-increase
-	* @param userName - The user to whisper to
-	* @param message - The message
-	* @param channel - The channel (or user channel) to send this message to
-	* @return Whether the message was sent to the worker thread. Check your connection callback for errors.
-	*/
-	UFUNCTION(BlueprintCallable, Category = "Messages")
-	bool SendWhisper(const FString& userName, const FString& message, const FString channel = TEXT(""));
-
-	/**
-	 * If connected, join a new channel. If already in a channel, will leave it before joining the new one.
-	 */
-	UFUNCTION(BlueprintCallable, Category = "Setup")
-	void JoinChannel(const FString& channel);
-
-	/**
-	 * If connected, disconnects
-	 */
-	UFUNCTION(BlueprintCallable, Category = "Setup")
-	void Disconnect();
-
-	/**
-	 * Has a connection been established? Not Pending?
-	 */
-	UFUNCTION(BlueprintPure, Category = "Info")
-	bool IsConnected() const;
-
-	/**
-	* Establishing a connection?
-	* Returns false if connected.
-	*/
-	UFUNCTION(BlueprintPure, Category = "Info")
-	bool IsPendingConnection() const;
-
-	/**
-	 * Get the current connection info
-	 * returns false if not connected
-	 */
-	UFUNCTION(BlueprintPure, Category = "Info")
-    bool GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const;
-};
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CoreTypes.h"
+#include "Components/ActorComponent.h"
+#include "Networking.h"
+#include "Chat/TwitchChatTypes.h"
+#include "Chat/TwitchUserFilter.h"
+#include "Chat/TwitchTimerWheel.h"
+#include "Chat/TwitchChatStage.h"
+#include "Chat/TwitchChatHistory.h"
+#include "Chat/TwitchChatDisplay.h"
+#include "Chat/TwitchEmoteCache.h"
+#include "Chat/TwitchChatAggregator.h"
+#include "Chat/TwitchMessageTemplate.h"
+#include "TwitchIRCComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class ETwitchConnectionMessageType : uint8
+{
+	// A connection and authentication was established.
+	CONNECTED,
+	// Failed to connect.
+	FAILED_TO_CONNECT,
+	// Failed to authenticate.
+	FAILED_TO_AUTHENTICATE,
+	// A general error, doesn't mean the connection was terminated.
+	ERROR,
+	// General message from the server
+	MESSAGE,
+	// Disconnected from server.
+	DISCONNECTED
+};
+
+/**
+ * Declaration of delegate type for messages received from chat.
+ * Delegate signature should receive two parameters:
+ * _message (const FString&) - Message received.
+ * _username (const FString&) - Username of who sent the message.
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTwitchMessageReceived, const FString&, message, const FString&, username);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FTwitchConnectionMessage, const ETwitchConnectionMessageType, type, const FString&, message);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FTwitchChatLineReceived, const FString&, message, const FString&, username, const FTwitchChatDisplayLine&, line);
+
+// Blob of user messages received
+struct FTwitchReceiveMessages
+{
+	TArray<FTwitchChatMessage> Messages;
+};
+
+enum class ETwitchSendMessageType : uint8
+{
+	// User Chat Message
+	CHAT_MESSAGE,
+
+	// Join new channel message
+	JOIN_MESSAGE,
+};
+
+enum class ETwitchConnectionRole : uint8
+{
+	// Receives and sends chat messages on the same connection
+	READ_WRITE,
+
+	// Only receives chat messages. Chat messages can not be sent.
+	READ_ONLY,
+
+	// Only sends chat messages. Received chat lines are discarded.
+	WRITE_ONLY,
+};
+
+struct FTwitchSendMessage
+{
+	// The message type
+	ETwitchSendMessageType Type;
+	// The message
+	FString Message;
+	// The channel (can be empty)
+	FString Channel;
+	// If set, the message is encoded from the template by the sending thread and Message is unused
+	FTwitchMessageTemplatePtr Template;
+	// Arguments of the template
+	TArray<FString> Arguments;
+	// If not empty, the templated message is whispered to this user
+	FString WhisperTarget;
+};
+
+/**
+ * Twitch messages reciever runnable
+ */
+class FTwitchMessageReceiver final : public FRunnable
+{
+public:
+	using TwitchConnectionPair = TPair<ETwitchConnectionMessageType, FString>;
+	using FTwitchReceiveMessagesQueue = TQueue<FTwitchReceiveMessages, EQueueMode::Spsc>;
+	using FTwitchSendMessagesQueue = TQueue<FTwitchSendMessage, EQueueMode::Spsc>;
+	using FTwitchConnectionQueue = TQueue<TwitchConnectionPair, EQueueMode::Spsc>;
+	using FTwitchReceiverTaskQueue = TQueue<TFunction<void()>, EQueueMode::Mpsc>;
+	
+	FTwitchMessageReceiver();
+	virtual ~FTwitchMessageReceiver();
+
+	void StartConnection(const FString& auth, const FString& username, const FString& channel, const float timeBetweenMessages,
+		const ETwitchConnectionRole role = ETwitchConnectionRole::READ_WRITE);
+
+	/**
+	 * Starts a read-only connection using Twitch's anonymous login (justinfan nick, no PASS).
+	 * Anonymous connections do not count against the bot account and cannot send chat messages.
+	 * @param channel - The channel to join upon connection
+	 */
+	void StartAnonymousConnection(const FString& channel);
+
+	/**
+	 * If true, this connection is shared: chat is parsed once and handed to the followers instead of this receiver's queues.
+	 * Must be set before the connection is started.
+	 */
+	void SetShared(const bool bShared) { bIsShared = bShared; }
+
+	/**
+	 * Follows a started shared connection instead of opening one. The thread of the shared connection runs this receiver's
+	 * filter, commands and stages on the chat it parsed, and chat messages are sent on the shared connection.
+	 * @param source - The shared connection
+	 */
+	void StartFollowing(const TSharedRef<FTwitchMessageReceiver, ESPMode::ThreadSafe>& source);
+
+	// Has the connection ended, or is it ending?
+	bool IsStopping() const { return ShouldExit || bIsFinished; }
+
+	// Has the connection thread ended?
+	bool IsFinished() const { return bIsFinished; }
+
+	//
+	// FRunnable interface.
+	//
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	virtual void Exit() override;
+
+	void PullMessages(TArray<FTwitchChatMessage>& messagesOut);
+	bool SendMessage(const ETwitchSendMessageType type, const FString& message, const FString& channel);
+	bool SendMessage(FTwitchSendMessage&& message);
+	bool PullConnectionMessage(ETwitchConnectionMessageType& statusOut, FString& messageOut);
+
+	void StopConnection(bool waitTillComplete);
+
+	/**
+	 * Sets the registered commands to look for. Can be called from any thread.
+	 * Messages parsed after this call will have their command and options filled in, or cleared if the sender lacks the required roles.
+	 */
+	void SetCommandRules(const FTwitchCommandRulesPtr& rules);
+
+	/**
+	 * Swaps in a new user blocklist or allowlist. Can be called from any thread.
+	 * Messages of users that are not allowed are dropped before they are queued for the game thread.
+	 * @param filter - The new filter, nullptr to let everyone through
+	 */
+	void SetUserFilter(const FTwitchUserFilterPtr& filter);
+
+	/**
+	 * Swaps in the stages each batch of chat messages goes through. Can be called from any thread.
+	 * @param stages - The new stages, nullptr for none
+	 */
+	void SetChatStages(const FTwitchChatStagesPtr& stages);
+
+	// If true, messages parsed after this call come with their display line. Can be called from any thread.
+	void SetBuildDisplayLines(const bool bBuild) { bBuildDisplayLines = bBuild; }
+
+	/**
+	 * Runs a function on the receiver thread, at the start of its next loop.
+	 * The function can use the timer wheel and anything else owned by the receiver thread.
+	 */
+	void RunOnReceiverThread(TFunction<void()>&& task);
+
+	/**
+	 * Sends a chat message after a delay, and optionally keeps repeating it. Timed by the receiver thread.
+	 * @param message - The message
+	 * @param channel - The channel to send to, empty for the joined channel
+	 * @param delaySeconds - Seconds before the first send
+	 * @param repeatSeconds - Seconds between repeats, 0 to send only once
+	 * @return Id to cancel the announcement with, INDEX_NONE if chat can't be sent on this connection
+	 */
+	int32 ScheduleAnnouncement(const FString& message, const FString& channel, const float delaySeconds, const float repeatSeconds);
+
+	// Stops a scheduled announcement
+	void CancelAnnouncement(const int32 announcementId);
+
+	bool IsConnected() const { return bIsConnected; }
+
+	bool IsAnonymous() const { return bIsAnonymous; }
+
+	ETwitchConnectionRole GetRole() const { return Role; }
+
+	// Can chat messages be sent on this connection?
+	bool CanSendChat() const { return !bIsAnonymous && Role != ETwitchConnectionRole::READ_ONLY; }
+
+	void GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const
+	{
+		oauthOut = Oauth;
+		usernameOut = Username;
+		channelOut = Channel;
+	}
+
+private:
+
+	// Waits until data is available on the socket, or the timeout is hit
+	void WaitForIncomingData(float maxSeconds);
+
+	// Waits until a message is queued for sending and can be sent, or the timeout is hit
+	void WaitForSendWork(float maxSeconds);
+
+	// Runs the functions queued with RunOnReceiverThread
+	void RunReceiverTasks();
+
+	// Sends the next queued message, if the send delay allows it
+	void SendNextMessage();
+
+	// Restarts the keepalive deadline. Called whenever the server sends anything.
+	void ResetKeepAlive();
+
+	// Sends a PING, its PONG measures the round trip
+	void SendPing();
+
+	// PINGs the server regularly to keep the round trip stat fresh
+	void ScheduleRoundTripProbe();
+
+	// Sets the connection flag, keeping the connected stat in step
+	void SetConnected(const bool bConnected);
+
+	// Counts a chat message send in the stats
+	void CountSend(const bool bSent);
+
+	// Queues a connection message for the game thread, or for the followers of a shared connection
+	void PostConnectionMessage(const ETwitchConnectionMessageType type, const FString& message);
+
+	// Queues a connection message of the shared connection on a follower. Called with the followers lock held.
+	void DeliverConnectionMessage(const ETwitchConnectionMessageType type, const FString& message);
+
+	// Runs the receive pipeline on the parsed messages and queues what is left for the game thread
+	void ProcessReceived(TArray<FTwitchChatMessage>&& messages, const TArray<FString>& departures);
+
+	// Runs the receive pipeline of each follower on the parsed messages
+	void DeliverToFollowers(TArray<FTwitchChatMessage>&& messages, const TArray<FString>& departures);
+
+	// Fires the due timers of the followers, and returns the seconds until the next one, no later than maxSeconds
+	double AdvanceFollowerTimers(const double maxSeconds);
+
+	// Attaches a follower to this shared connection
+	void AddFollower(FTwitchMessageReceiver& follower);
+
+	// Detaches a follower from this shared connection. Returns the number of followers left.
+	int32 RemoveFollower(FTwitchMessageReceiver& follower);
+
+	// Queues an announcement and schedules its repeat
+	void FireAnnouncement(const int32 announcementId, const FString& message, const FString& channel, const float repeatSeconds);
+
+	// Receives pending data and decodes the complete lines in it from UTF-8
+	FString ReceiveFromConnection();
+
+	/**
+	* Parses the message received from Twitch IRC chat in order to only get the content of the message.
+	* Since a single "message" could actually include multiple lines an array of messages is returned.
+	*
+	* @param message - Message to parse
+	* @param messagesOut - Parsed messages, including the sender username and roles.
+	* @param departuresOut - Users that left the channel or were timed out or banned.
+	*
+	*/
+	void ParseMessage(const FString& message, TArray<FTwitchChatMessage>& messagesOut, TArray<FString>& departuresOut);
+
+	// Tags a display line is built from
+	struct FTwitchDisplayTags
+	{
+		FString DisplayName;
+		FString Color;
+		FString Emotes;
+	};
+
+	/**
+	 * Splits the IRCv3 tags off a line, if any, and reads the tags we care about into the message.
+	 * @param line - The line to parse. The tags are removed from it.
+	 * @param messageOut - The message to fill in
+	 * @param displayTagsOut - If not null, filled in with the display tags
+	 */
+	void ParseTags(FString& line, FTwitchChatMessage& messageOut, FTwitchDisplayTags* displayTagsOut);
+
+	// Current registered commands snapshot
+	FTwitchCommandRulesPtr GetCommandRules();
+
+	// Finds and authorizes the registered commands of the parsed messages
+	void ApplyCommandRules(const FTwitchCommandRulesPtr& rules, TArray<FTwitchChatMessage>& messages);
+
+	// Hands the messages to the installed chat stages
+	void ApplyChatStages(const TArray<FTwitchChatMessage>& messages);
+
+	// Hands the users that left to the installed chat stages
+	void ApplyChatDepartures(const TArray<FString>& usernames);
+
+	// Takes the commands that coalesce out of the messages and merges them into their batches
+	void CoalesceCommands(const FTwitchCommandRulesPtr& rules, TArray<FTwitchChatMessage>& messages);
+
+	// Drops the messages of users that are not allowed by the user filter
+	void ApplyUserFilter(TArray<FTwitchChatMessage>& messages);
+
+	/**
+	 * Merges a command into the open batch of identical commands, or opens a new batch
+	 * that is queued for the game thread once the rule's window has passed.
+	 */
+	void CoalesceCommand(FTwitchChatMessage&& message, const FTwitchCommandRule& rule);
+
+	/**
+	 * Send a message on the connected socket
+	 * @param message - The message to send
+	 * @param channel - The channel (or user) to send this message to
+	 */
+	bool SendIRCMessage(const FString& message, const FString channel = TEXT(""));
+
+	// Sends a chat message to a channel, encoding its template if it has one
+	bool SendChatLine(const FTwitchSendMessage& message, const FString& channel);
+
+	// Sends the outbound buffer on the connected socket, behind the bytes previous sends left unsent
+	bool FlushSendBuffer();
+
+	/**
+	 * Sends the bytes the socket did not take yet. Drops the connection on a socket error,
+	 * since anything sent after half a line would be glued to it.
+	 */
+	bool SendUnsentBytes();
+
+	/**
+	 * Ends the connection after the server went away: posts the reason as an ERROR followed by DISCONNECTED and counts one disconnect.
+	 * Only the first call does anything, and the thread then closes the socket without parting the channel.
+	 */
+	void LoseConnection(const FString& reason);
+
+	// UTF-8 bytes of the line being sent, reused by every send. Only touched by the receiver thread.
+	TArray<uint8> SendBuffer;
+
+	// Tail of the lines the socket did not take yet, sent before anything else. Only touched by the receiver thread.
+	TArray<uint8> UnsentBytes;
+
+	// Received bytes of a line that did not end yet. Only touched by the receiver thread.
+	TArray<uint8> ReceiveBuffer;
+
+	// Sending and recieving queues
+	TUniquePtr<FTwitchSendMessagesQueue> SendingQueue;
+	TUniquePtr<FTwitchReceiveMessagesQueue> ReceivingQueue;
+
+	// Connection status queue
+	TUniquePtr<FTwitchConnectionQueue> ConnectionQueue;
+
+	// Functions to run on the receiver thread
+	TUniquePtr<FTwitchReceiverTaskQueue> ReceiverTasks;
+
+	FSocket* ConnectionSocket;
+
+	FRunnableThread* MessagesThread;
+
+	FThreadSafeBool ShouldExit;
+
+	// Set once the connection was lost rather than closed on request. Only touched by the receiver thread.
+	bool bConnectionLost;
+
+	FThreadSafeBool bIsConnected;
+
+	// Triggered when a message is queued for sending, wakes up write connections
+	FEvent* SendEvent;
+
+	// What this connection is used for
+	ETwitchConnectionRole Role;
+
+	// Registered commands, set from the game thread
+	FTwitchCommandRulesPtr CommandRules;
+	FCriticalSection CommandRulesLock;
+
+	// User blocklist or allowlist, swapped in from any thread
+	FTwitchUserFilterPtr UserFilter;
+	FCriticalSection UserFilterLock;
+
+	// Stages of the receive pipeline, swapped in from any thread
+	FTwitchChatStagesPtr ChatStages;
+	FCriticalSection ChatStagesLock;
+
+	// Build display lines for the parsed messages?
+	FThreadSafeBool bBuildDisplayLines;
+
+	// Roles of each badge set seen so far. Only touched by the receiver thread.
+	TMap<FString, ETwitchUserRole> BadgeRolesCache;
+
+	// Authentication token. Need to get it from official Twitch API
+	FString Oauth;
+
+	// Username. Must be in lowercaps
+	FString Username;
+
+	// Channel to join upon successful connection	
+	FString Channel;
+
+	// True if logged in anonymously. No PASS is sent and chat messages are rejected.
+	bool bIsAnonymous;
+
+	// True while we are waiting for the auth reply from the server
+	bool WaitingForAuth;
+
+	// The set time between messages
+	float TimeBetweenMessages;
+
+	// Timers of the receiver thread, on the monotonic clock. Only touched by the receiver thread.
+	FTwitchTimerWheel Timers;
+
+	// False while waiting for the time between messages to pass
+	bool bSendAllowed;
+
+	// Fires when the server has been quiet for too long
+	FTwitchTimerHandle KeepAliveTimer;
+
+	// When the unanswered PING was sent, 0 if none
+	double PingSentTime;
+
+	// Messages sent by scheduled announcements, sent before the queued messages
+	TArray<FTwitchSendMessage> AnnouncementSends;
+
+	// Open batches of identical commands, by command and options. Only touched by the receiver thread.
+	TMap<FString, FTwitchChatMessage> CoalescingBatches;
+
+	// Pending announcements by id. Only touched by the receiver thread.
+	TMap<int32, FTwitchTimerHandle> Announcements;
+
+	// Id of the next scheduled announcement
+	FThreadSafeCounter NextAnnouncementId;
+
+	// Is chat handed to the followers?
+	bool bIsShared;
+
+	// Receivers following this shared connection. Their receive pipelines run on this thread.
+	TArray<FTwitchMessageReceiver*> Followers;
+
+	// Did the shared connection log in? Tells late followers they are connected.
+	bool bSessionConnected;
+
+	// Message the shared connection ended with, handed to late followers
+	TwitchConnectionPair FinalMessage;
+
+	// Guards the followers, their connection queues and the session state
+	FCriticalSection FollowersLock;
+
+	// Set once the connection thread is done
+	FThreadSafeBool bIsFinished;
+
+	// Shared connection this receiver follows, if any
+	TSharedPtr<FTwitchMessageReceiver, ESPMode::ThreadSafe> Source;
+
+	// Announcements this follower scheduled on the shared connection, cancelled when it leaves. Game thread only.
+	TArray<int32> FollowerAnnouncements;
+};
+
+/**
+ * Makes communication with Twitch IRC possible through UE4 sockets.
+ * You can send and receive messages to/from channel chat.
+ * Subscribe to OnMessageReceived to know when a message has harrived.
+ * Remember to first Connect(), SetUserInfo() and then AuthenticateTwitchIRC() before trying to send messages.
+ */
+UCLASS(ClassGroup = (TwitchAPI), meta = (BlueprintSpawnableComponent))
+class TWITCHPLAY_API UTwitchIRCComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Event called each time a message is received
+	UPROPERTY(BlueprintAssignable, Category = "Message Events")
+	FTwitchMessageReceived OnMessageReceived;
+
+	// Event called each time a connection message occurs.
+	// Use this to determine if the connection was successful, or was disconnected, or an error occured.
+	// Also includes general server messages from connection commands, join commands, etc.
+	UPROPERTY(BlueprintAssignable, Category = "Message Events")
+	FTwitchConnectionMessage OnConnectionMessage;
+
+	// Event called each time a message is received, with its display line (name color, text and emote runs).
+	// Only called when bBuildDisplayLines is set.
+	UPROPERTY(BlueprintAssignable, Category = "Message Events")
+	FTwitchChatLineReceived OnChatLineReceived;
+
+	// The seconds delay between sending chat messages. This is set to a safe time by default, but if your bot has elevated
+	// permissions you might be able to set this to a shorter time.
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	float TimeBetweenChatMessages;
+
+	// If true, Connect opens a dedicated connection for receiving chat and a separate authenticated connection for sending.
+	// Sending can then never delay receiving, which keeps command latency flat while the bot is posting heavily.
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	bool bSplitReadWriteConnections;
+
+	// If true and the connections are split, the read connection logs in anonymously instead of using the bot account.
+	UPROPERTY(EditAnywhere, Category = "Setup", meta = (EditCondition = "bSplitReadWriteConnections"))
+	bool bAnonymousReadConnection;
+
+#if WITH_EDITORONLY_DATA
+	// If true, the worlds of a multi-client PIE session connecting with the same account and channel share one connection.
+	// Only the first world logs in, and chat is parsed once for all of them. A shared connection is never split,
+	// bSplitReadWriteConnections and bAnonymousReadConnection are ignored while sharing.
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	bool bSharePIEConnection;
+#endif
+
+	// Number of chat messages kept in the history for moderation. 0 disables the history. Applied on the first connection.
+	UPROPERTY(EditAnywhere, Category = "History", meta = (ClampMin = "0"))
+	int32 ChatHistorySize;
+
+	// If true, a background thread keeps an index of the history words and senders, so searches don't scan the whole history.
+	UPROPERTY(EditAnywhere, Category = "History", meta = (EditCondition = "ChatHistorySize > 0"))
+	bool bIndexChatHistory;
+
+	// If true, the receiver thread splits each message into text and emote runs and reads the sender's display name and color,
+	// so chat UI doesn't have to parse messages on the game thread. Applied on the next connection.
+	UPROPERTY(EditAnywhere, Category = "Setup")
+	bool bBuildDisplayLines;
+
+	// Images of the emotes of the display lines. Nothing is downloaded until an emote is requested.
+	UPROPERTY(VisibleAnywhere, Instanced, BlueprintReadOnly, Category = "Emotes")
+	UTwitchEmoteCache* EmoteCache;
+
+	// If true, chat activity (message rate, top emotes, heatmap, votes) is summed up each frame and published for particle systems
+	// and other readers. Top emotes need bBuildDisplayLines. Applied on the first connection.
+	UPROPERTY(EditAnywhere, Category = "Aggregates")
+	bool bAggregateChat;
+
+	// Name the chat aggregates are published under, ie. the Source of the Twitch Chat Niagara data interface
+	UPROPERTY(EditAnywhere, Category = "Aggregates", meta = (EditCondition = "bAggregateChat"))
+	FName AggregatesName;
+
+	// Command adding a position to the heatmap, with the coordinates from 0 to 1 as options (ie. !tap#0.25,0.8#)
+	UPROPERTY(EditAnywhere, Category = "Aggregates", meta = (EditCondition = "bAggregateChat"))
+	FString HeatmapCommand;
+
+	// Number of cells on each side of the heatmap
+	UPROPERTY(EditAnywhere, Category = "Aggregates", meta = (EditCondition = "bAggregateChat", ClampMin = "0", ClampMax = "256"))
+	int32 HeatmapSize;
+
+	// Number of most used emotes tracked
+	UPROPERTY(EditAnywhere, Category = "Aggregates", meta = (EditCondition = "bAggregateChat", ClampMin = "0", ClampMax = "64"))
+	int32 NumTopEmotes;
+
+	// Seconds for the rate, emote counts and heatmap to decay to half
+	UPROPERTY(EditAnywhere, Category = "Aggregates", meta = (EditCondition = "bAggregateChat", ClampMin = "0.01"))
+	float AggregatesHalfLife;
+	
+
+private:
+
+	// Message receiver runnable. When the connections are split this is the read connection.
+	TUniquePtr<FTwitchMessageReceiver> TwitchMessageReceiver;
+
+	// Write connection runnable, only valid when the connections are split
+	TUniquePtr<FTwitchMessageReceiver> TwitchWriteReceiver;
+
+	// The receiver chat messages should be sent on
+	FTwitchMessageReceiver* GetSendingReceiver() const;
+
+	// Broadcasts pending connection messages of a receiver. Returns false if the receiver is no longer connected.
+	bool PullConnectionMessages(FTwitchMessageReceiver& receiver);
+
+	// Registered commands the receiver thread parses and authorizes
+	FTwitchCommandRulesPtr CommandRules;
+
+	// User blocklist or allowlist applied by the receiver thread
+	FTwitchUserFilterPtr UserFilter;
+
+	// Incremented for each list change so a slow build can not overwrite a newer list
+	int32 UserFilterGeneration;
+
+	// Did a connection of this component log in before? Later logins count as reconnects.
+	bool bHasConnected;
+
+	// Builds the user filter on a worker thread, then swaps it in on the game thread
+	void BuildUserFilter(const TArray<FString>& users, const bool bIsAllowlist);
+
+	// Sets the user filter on this component and its receiver
+	void SetUserFilter(const FTwitchUserFilterPtr& filter);
+
+	// Stages of the receive pipeline, in the order they were added
+	TArray<FTwitchChatStagePtr> ChatStages;
+
+	// Parsed message templates, by id
+	TArray<FTwitchMessageTemplatePtr> MessageTemplates;
+
+	// Queues a templated message on the sending receiver
+	bool SendTemplate(const FString& userName, const int32 templateId, const TArray<FString>& arguments, const FString& channel);
+
+	// Publishes the current stages to the read receiver
+	void PublishChatStages();
+
+	// Last received chat messages, created with the first read receiver. Kept across connections.
+	FTwitchChatHistoryPtr ChatHistory;
+
+	// Sums up chat activity, created with the first read receiver. Kept across connections.
+	FTwitchChatAggregatorPtr ChatAggregator;
+
+	// Publishes the chat aggregates of this frame
+	void PublishChatAggregates(const float deltaSeconds);
+
+	// Creates the read receiver, with the current command rules, user filter and stages
+	void CreateReadReceiver();
+
+#if WITH_EDITOR
+	// Should this component follow the shared connection of its PIE session instead of opening its own?
+	bool ShouldSharePIEConnection() const;
+#endif
+
+protected:
+
+	/**
+	 * Called on the game thread for each chat message received, after OnMessageReceived was broadcast.
+	 * @param message - The message, with the command already parsed and authorized by the receiver thread.
+	 */
+	virtual void HandleChatMessage(const FTwitchChatMessage& message) {}
+
+	// Called on the game thread once the connection is gone and the component stopped ticking
+	virtual void HandleDisconnected() {}
+
+	/**
+	 * Sets the registered commands the receiver thread should parse and authorize.
+	 * Kept across connections.
+	 */
+	void SetCommandRules(const FTwitchCommandRulesPtr& rules);
+
+	// Gets the chat aggregator, null if chat is not aggregated or not connected yet
+	const FTwitchChatAggregatorPtr& GetChatAggregator() const { return ChatAggregator; }
+
+public:
+
+	// Sets default values for this component's properties
+	UTwitchIRCComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Gets the chat history, null if disabled or not connected yet
+	const FTwitchChatHistoryPtr& GetChatHistory() const { return ChatHistory; }
+
+	/**
+	 * Adds a stage to the receive pipeline. Stages run on the receiver thread for every batch of chat messages.
+	 * Kept across connections.
+	 */
+	void AddChatStage(const FTwitchChatStagePtr& stage);
+
+	// Removes a stage from the receive pipeline
+	void RemoveChatStage(const FTwitchChatStagePtr& stage);
+
+	/**
+	* Creates a socket and tries to connect to Twitch IRC server.
+	*
+	* @param oauth - Oauth token to use. Get one from official Twitch APIs.
+	* @param username - Username to login with. All low caps.
+	* @param channel - The channel to join upon connection. (optional, can call JoinChannel later)
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+    void Connect(const FString& oauth, const FString& username, const FString& channel);
+
+	/**
+	* Creates a socket and connects to Twitch IRC server anonymously (read-only).
+	* No oauth token is required and the connection does not count against your bot account's limits.
+	* Chat messages and whispers cannot be sent on an anonymous connection.
+	*
+	* @param channel - The channel to join upon connection. (optional, can call JoinChannel later)
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void ConnectAnonymous(const FString& channel);
+	
+	/**
+	 * Send a message on the connected socket
+	 * @param message - The message
+	 * @param channel - The channel (or user channel) to send this message to
+	 * @return Whether the message was sent to the worker thread. Check your connection callback for errors.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	bool SendChatMessage(const FString& message, const FString channel = TEXT(""));
+
+	/**
+	* Send a whisper message to a specific user on a channel on the connected socket
+	* NOTE: The user account being used as a bot must have command rights for whispers to work. See the connection
+	* log to find out if your user is unable to send whispers in this way.
+	* To request bot extended privilages, see https://dev.twitch.tv/limit-increase
+	* @param userName - The user to whisper to
+	* @param message - The message
+	* @param channel - The channel (or user channel) to send this message to
+	* @return Whether the message was sent to the worker thread. Check your connection callback for errors.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	bool SendWhisper(const FString& userName, const FString& message, const FString channel = TEXT(""));
+
+	/**
+	 * Parses a message template once, for messages the bot sends often.
+	 * Placeholders are ordered like FString::Format, ie. "Welcome {0}, you have {1} points".
+	 * @param pattern - The message, with its placeholders
+	 * @return Id to send the template with
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	int32 RegisterMessageTemplate(const FString& pattern);
+
+	/**
+	 * Sends a message from a template. Only the arguments are copied, the message is encoded straight into
+	 * the outbound buffer on the connection thread.
+	 * @param templateId - Id returned by RegisterMessageTemplate
+	 * @param arguments - Values of the placeholders, in order
+	 * @param channel - The channel (or user channel) to send this message to
+	 * @return Whether the message was sent to the worker thread. Check your connection callback for errors.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	bool SendTemplateMessage(const int32 templateId, const TArray<FString>& arguments, const FString channel = TEXT(""));
+
+	/**
+	 * Whispers a message from a template to a specific user. Same requirements as SendWhisper.
+	 * @param userName - The user to whisper to
+	 * @param templateId - Id returned by RegisterMessageTemplate
+	 * @param arguments - Values of the placeholders, in order
+	 * @param channel - The channel (or user channel) to send this message to
+	 * @return Whether the message was sent to the worker thread. Check your connection callback for errors.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	bool SendTemplateWhisper(const FString& userName, const int32 templateId, const TArray<FString>& arguments, const FString channel = TEXT(""));
+
+	/**
+	 * Sends a chat message after a delay, and optionally keeps repeating it.
+	 * Timing runs on the connection thread, so nothing is checked on the game thread each tick.
+	 * @param message - The message
+	 * @param delaySeconds - Seconds before the first send
+	 * @param repeatSeconds - Seconds between repeats, 0 to send only once
+	 * @param channel - The channel (or user channel) to send this message to
+	 * @return Id to cancel the announcement with, -1 if not connected or on an anonymous connection
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	int32 ScheduleAnnouncement(const FString& message, const float delaySeconds, const float repeatSeconds = 0.0f, const FString channel = TEXT(""));
+
+	/**
+	 * Stops a scheduled announcement.
+	 * @param announcementId - Id returned by ScheduleAnnouncement
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Messages")
+	void CancelAnnouncement(const int32 announcementId);
+
+	/**
+	 * If connected, join a new channel. If already in a channel, will leave it before joining the new one.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void JoinChannel(const FString& channel);
+
+	/**
+	 * If connected, disconnects
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void Disconnect();
+
+	/**
+	 * Has a connection been established? Not Pending?
+	 */
+	UFUNCTION(BlueprintPure, Category = "Info")
+	bool IsConnected() const;
+
+	/**
+	* Establishing a connection?
+	* Returns false if connected.
+	*/
+	UFUNCTION(BlueprintPure, Category = "Info")
+	bool IsPendingConnection() const;
+
+	/**
+	 * Is the connection an anonymous read-only connection?
+	 */
+	UFUNCTION(BlueprintPure, Category = "Info")
+	bool IsAnonymous() const;
+
+	/**
+	 * Blocks messages from the users on the list. Replaces any previous blocklist or allowlist.
+	 * The list is built on a worker thread and swapped in once ready, so it can be refreshed with very large lists.
+	 * @param users - User ids or login names to block
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void SetUserBlocklist(const TArray<FString>& users);
+
+	/**
+	 * Only receives messages from the users on the list. Replaces any previous blocklist or allowlist.
+	 * The list is built on a worker thread and swapped in once ready, so it can be refreshed with very large lists.
+	 * @param users - User ids or login names to allow
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void SetUserAllowlist(const TArray<FString>& users);
+
+	/**
+	 * Removes the current blocklist or allowlist.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Setup")
+	void ClearUserFilter();
+
+	/**
+	 * Get the current connection info
+	 * returns false if not connected
+	 */
+	UFUNCTION(BlueprintPure, Category = "Info")
+    bool GetConnectionInfo(FString& oauthOut, FString& usernameOut, FString& channelOut) const;
+
+	/**
+	 * Finds the newest chat messages containing all the words of a text and/or sent by a user.
+	 * @param text - Words to look for, case insensitive. Empty to only look for the user.
+	 * @param username - Sender to look for. Empty for anyone.
+	 * @param maxResults - Maximum number of messages
+	 * @param resultsOut - The messages found, newest first
+	 */
+	UFUNCTION(BlueprintCallable, Category = "History")
+	void SearchChatHistory(const FString& text, const FString& username, const int32 maxResults, TArray<FTwitchChatHistoryEntry>& resultsOut) const;
+
+	/**
+	 * Gets the last chat messages received.
+	 * @param count - Maximum number of messages
+	 * @param messagesOut - The messages, oldest first
+	 */
+	UFUNCTION(BlueprintCallable, Category = "History")
+	void GetRecentChatHistory(const int32 count, TArray<FTwitchChatHistoryEntry>& messagesOut) const;
+};
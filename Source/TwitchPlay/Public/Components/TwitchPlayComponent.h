@@ -1,132 +1,564 @@
-// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
-
-#pragma once
-
-#include "Components/TwitchIRCComponent.h"
-#include "TwitchPlayComponent.generated.h"
-
-/**
- * Declaration of delegate type for commands received from chat.
- * Delegate signature should receive three parameters:
- * _command_name (const FString&) - Name of the command received.
- * _command_options (const TArray<FString>&) - Additional array of options for the command being invoked.
- * _sender_username (const FString&) - Username of who triggered the command.
- */
-DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnCommandReceived, const FString&, _command_name, const TArray<FString>&, _command_options, const FString&, _sender_username);
-
-
-/**
- * Works the same as UTwitchIRCComponent, but enables to subscribe to events that are fired on specific chat commands.
- * You can still send and receive messages to/from channel chat.
- * Subscribe to OnMessageReceived to know when a message has harrived.
- * Subscribe to specific commands by registering with RegisterCommand() to receive events for that command.
- * Only one object/function per command can be subscribed. Might change in later versions of the API.
- * You can change the default characters for commands/options encapsulation via SetupEncasulationChars().
- * Remember to first Connect(), SetUserInfo() and then AuthenticateTwitchIRC() before trying to send messages.
- */
-UCLASS(ClassGroup = (TwitchAPI), meta = (BlueprintSpawnableComponent))
-class TWITCHPLAY_API UTwitchPlayComponent : public UTwitchIRCComponent
-{
-	GENERATED_BODY()
-
-public:
-
-	// Character to use for command encapsulation. Commands will be read in the form CHAR_Command_CHAR (no spaces or underscores!)
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Setup")
-	FString command_encapsulation_char_ = "!";
-
-	/**
-	 * Character to use for command options encapsulation. Commands will be read in the form CHAR_Option1[,Option2,..]_CHAR (no spaces or underscores!)
-	 * Multiple options can be specified and will be split into an FString array upon parsing
-	 */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Setup")
-	FString options_encapsulation_char_ = "#";
-
-private:
-
-	/**
-	 * Map of the command events currently bound.
-	 * Each time a new command event is subscribed to, a new map entry is added.
-	 * For each command only one function will be bound.
-	 * NOTE: Only methods marked as UFUNCTION can be bound dinamically!
-	 *
-	 * TODO: Unbind all events on component destruction? I don't know if it would generate memory leaks if not done
-	 */
-	TMap<FString, FOnCommandReceived> bound_events_;
-
-public:
-
-	/**
-	 * Constructor subscribes to message reception.
-	 */
-	UTwitchPlayComponent();
-
-	/**
-	 * Setups the encapsulation characters to use for commands and options.
-	 *
-	 * @param _command_char - Character(s) to use to encapsulate commands.
-	 * @param _options_char - Character(s) to use to encapsulate command options.
-	 */
-	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
-	void SetupEncapsulationChars(const FString& _command_char, const FString& _options_char);
-
-	/**
-	 * Registers a command to receive an event whenever that command is called via chat.
-	 * Only one function associated with a single object can be registered per command (as a delegate pointer!).
-	 * You actually need to create a delegate, bind it to a function and pass that in by reference.
-	 * If you try to register another function or another object with the same command the new function of that object will replace the previous one.
-	 * If you need to fire multiple events when a single command is received consider having just one event calling all the others.
-	 *
-	 * @param _command_name - The command to register (CASE SENSITIVE).
-	 * @param _callback_function - The function to fire when the event rises.
-	 * @param _out_result - Result of the operation.
-	 *
-	 * @return Whether the registration was successfully completed.
-	 */
-	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
-	bool RegisterCommand(const FString& _command_name, const FOnCommandReceived& _callback_function, FString& _out_result);
-
-	/**
-	* Unregisters a command to stop receiving events whenever that command is called via chat.
-	* Keep in mind that since each command can only be bound to a single function (and single object) unregistering that command will remove any function from any object.
-	*
-	* @param _command_name - The command to unregister (CASE SENSITIVE).
-	* @param _out_result - Result of the operation.
-	*
-	* @return Whether the unregistration was successfully completed.
-	*/
-	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
-	bool UnregisterCommand(const FString& _command_name, FString& _out_result);
-
-private:
-
-	/**
-	 * Handler for when a message is received.
-	 * Should call the parsing method to search for commands/options and fire the corresponding event.
-	 *
-	 * @param _message - The message that was received.
-	 * @param _username - Username of who sent the chat message
-	 *
-	 * NOTE: Method must be marked as UFUNCTION in order to bind a dynamic delegate to it!
-	 */
-	UFUNCTION()
-	void MessageReceivedHandler(const FString& _message, const FString& _username);
-
-	/**
-	 * Parses the message and returns any command associated with the message.
-	 *
-	 * @param _message - The message to parse.
-	 *
-	 * @return The command found, if any. Returns "" if no command was found.
-	 */
-	FString GetCommandString(const FString& _message) const;
-
-	/**
-	* Parses the message and returns any command options associated with the message.
-	*
-	* @param _message - The message to parse.
-	* @param optionsOut - The array of options found, if any. Returns an empty array if no command option was found.
-	*
-	*/
-	void GetCommandOptionsStrings(const FString& _message, TArray<FString>& optionsOut) const;
-};
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "Components/TwitchIRCComponent.h"
+#include "Chat/TwitchAssetPrefetcher.h"
+#include "Chat/TwitchPollEngine.h"
+#include "Chat/TwitchRaffle.h"
+#include "Chat/TwitchViewerQueue.h"
+#include "Chat/TwitchLeaderboard.h"
+#include "Chat/TwitchChatterTracker.h"
+#include "Chat/TwitchCommandProfiler.h"
+#include "TwitchPlayComponent.generated.h"
+
+/**
+ * Declaration of delegate type for commands received from chat.
+ * Delegate signature should receive three parameters:
+ * _command_name (const FString&) - Name of the command received.
+ * _command_options (const TArray<FString>&) - Additional array of options for the command being invoked.
+ * _sender_username (const FString&) - Username of who triggered the command.
+ */
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnCommandReceived, const FString&, _command_name, const TArray<FString>&, _command_options, const FString&, _sender_username);
+
+/**
+ * Declaration of delegate type for batches of identical commands received from chat.
+ * Delegate signature should receive four parameters:
+ * _command_name (const FString&) - Name of the command received.
+ * _command_options (const TArray<FString>&) - Options of the command, the same for the whole batch.
+ * _count (int32) - Number of times the command was received in the batch window.
+ * _sender_usernames (const TArray<FString>&) - The first distinct senders of the command, capped when registering.
+ */
+DECLARE_DYNAMIC_DELEGATE_FourParams(FOnCoalescedCommandReceived, const FString&, _command_name, const TArray<FString>&, _command_options, int32, _count, const TArray<FString>&, _sender_usernames);
+
+/**
+ * Declaration of delegate type for poll updates.
+ * _result (const FTwitchPollResult&) - Snapshot of the poll.
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPollEvent, const FTwitchPollResult&, _result);
+
+/**
+ * Declaration of delegate type for chatter batches.
+ * _batch (const FTwitchChatterBatch&) - Chatters that joined, were updated or left since the last tick.
+ */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnChattersUpdated, const FTwitchChatterBatch&, _batch);
+
+
+/**
+ * Works the same as UTwitchIRCComponent, but enables to subscribe to events that are fired on specific chat commands.
+ * You can still send and receive messages to/from channel chat.
+ * Subscribe to OnMessageReceived to know when a message has harrived.
+ * Subscribe to specific commands by registering with RegisterCommand() to receive events for that command.
+ * Only one object/function per command can be subscribed. Might change in later versions of the API.
+ * You can change the default characters for commands/options encapsulation via SetupEncasulationChars().
+ * Remember to first Connect(), SetUserInfo() and then AuthenticateTwitchIRC() before trying to send messages.
+ */
+UCLASS(ClassGroup = (TwitchAPI), meta = (BlueprintSpawnableComponent))
+class TWITCHPLAY_API UTwitchPlayComponent : public UTwitchIRCComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	// Character to use for command encapsulation. Commands will be read in the form CHAR_Command_CHAR (no spaces or underscores!)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Setup")
+	FString command_encapsulation_char_ = "!";
+
+	/**
+	 * Character to use for command options encapsulation. Commands will be read in the form CHAR_Option1[,Option2,..]_CHAR (no spaces or underscores!)
+	 * Multiple options can be specified and will be split into an FString array upon parsing
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Setup")
+	FString options_encapsulation_char_ = "#";
+
+	/**
+	 * Maximum number of commands fired per tick. 0 fires every command as soon as it arrives, in order.
+	 * Above 0 commands wait in a priority queue where cheers jump ahead of plain commands in proportion to their bits.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Scheduling", meta = (ClampMin = "0"))
+	int32 max_commands_per_tick_ = 0;
+
+	/**
+	 * Seconds a command moves up the queue for each bit cheered with it.
+	 * A command is only ever passed by commands received before it, or by cheers received less than their boost after it,
+	 * so every command keeps progressing and a cheer waits at most for the commands received before it.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Scheduling", meta = (ClampMin = "0"))
+	float seconds_per_bit_ = 0.01f;
+
+	// Maximum boost in seconds a cheer can get, however many bits it carries
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Scheduling", meta = (ClampMin = "0"))
+	float max_bits_boost_seconds_ = 10.0f;
+
+	// Maximum number of commands waiting in the queue. When full, commands without bits are dropped.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Scheduling", meta = (ClampMin = "1"))
+	int32 max_command_backlog_ = 10000;
+
+	// Extra room in a full queue kept for cheers. Cheers are dropped too once it is used up.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Scheduling", meta = (ClampMin = "0"))
+	int32 max_cheer_backlog_ = 1000;
+
+	// Seconds the assets of a command are kept resident after the command was last received
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Commands Prefetch", meta = (ClampMin = "0"))
+	float prefetch_retain_seconds_ = 60.0f;
+
+	// Event called at most once per tick for each poll that received votes
+	UPROPERTY(BlueprintAssignable, Category = "Polls")
+	FOnPollEvent on_poll_updated_;
+
+	// Event called with the final result of a poll once it closes
+	UPROPERTY(BlueprintAssignable, Category = "Polls")
+	FOnPollEvent on_poll_ended_;
+
+	// Event called at most once per tick, while chatters are tracked, with the chatters that joined, sent messages or left
+	UPROPERTY(BlueprintAssignable, Category = "Chatters")
+	FOnChattersUpdated on_chatters_updated_;
+
+private:
+
+	// A command waiting in the priority queue
+	struct FPendingCommand
+	{
+		// Receive time minus the bits boost. Lower goes first.
+		double priority_key;
+		// Order of arrival, keeps equal keys first in first out
+		uint64 sequence;
+		FTwitchChatMessage message;
+
+		bool operator<(const FPendingCommand& other) const
+		{
+			return priority_key < other.priority_key || (priority_key == other.priority_key && sequence < other.sequence);
+		}
+	};
+
+	// Priority queue of commands waiting to be fired, a binary heap
+	TArray<FPendingCommand> pending_commands_;
+
+	// Arrival counter of the pending commands
+	uint64 pending_sequence_ = 0;
+
+	/**
+	 * Map of the command events currently bound.
+	 * Each time a new command event is subscribed to, a new map entry is added.
+	 * For each command only one function will be bound.
+	 * NOTE: Only methods marked as UFUNCTION can be bound dinamically!
+	 *
+	 * TODO: Unbind all events on component destruction? I don't know if it would generate memory leaks if not done
+	 */
+	TMap<FString, FOnCommandReceived> bound_events_;
+
+	/**
+	 * Map of the coalesced command events currently bound.
+	 * A command is either in bound_events_ or in this map, never both.
+	 */
+	TMap<FString, FOnCoalescedCommandReceived> bound_coalesced_events_;
+
+	/**
+	 * The registered commands and how the receiver thread should treat them.
+	 * A copy is published to the receiver thread each time it changes.
+	 */
+	FTwitchCommandRules command_rules_;
+
+	// Streams in the assets of the commands parsed by the receiver thread. Created with the first asset annotation.
+	FTwitchAssetPrefetcherPtr asset_prefetcher_;
+
+	// Tallies the running polls on the receiver thread. Created with the first poll.
+	FTwitchPollEnginePtr poll_engine_;
+
+	// Running raffles by id, each one a stage of the receive pipeline
+	TMap<int32, FTwitchRafflePtr> raffles_;
+
+	// Id of the next raffle
+	int32 next_raffle_id_ = 0;
+
+	// Running viewer queues by id, each one a stage of the receive pipeline
+	TMap<int32, FTwitchViewerQueuePtr> viewer_queues_;
+
+	// Id of the next viewer queue
+	int32 next_viewer_queue_id_ = 0;
+
+	// Viewer scores, updated from command handlers
+	FTwitchLeaderboard leaderboard_;
+
+	// Batches what chatters do on the receiver thread, while chatters are tracked
+	FTwitchChatterTrackerPtr chatter_tracker_;
+
+	// Batch handed to on_chatters_updated_, kept to reuse its allocations
+	FTwitchChatterBatch chatter_batch_;
+
+public:
+
+	/**
+	 * Constructor subscribes to message reception.
+	 */
+	UTwitchPlayComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/**
+	 * Setups the encapsulation characters to use for commands and options.
+	 *
+	 * @param _command_char - Character(s) to use to encapsulate commands.
+	 * @param _options_char - Character(s) to use to encapsulate command options.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
+	void SetupEncapsulationChars(const FString& _command_char, const FString& _options_char);
+
+	/**
+	 * Registers a command to receive an event whenever that command is called via chat.
+	 * Only one function associated with a single object can be registered per command (as a delegate pointer!).
+	 * You actually need to create a delegate, bind it to a function and pass that in by reference.
+	 * If you try to register another function or another object with the same command the new function of that object will replace the previous one.
+	 * If you need to fire multiple events when a single command is received consider having just one event calling all the others.
+	 *
+	 * The sender roles are checked on the receiver thread, commands from senders without any of the required roles never reach the game thread.
+	 *
+	 * @param _command_name - The command to register (CASE SENSITIVE).
+	 * @param _callback_function - The function to fire when the event rises.
+	 * @param _out_result - Result of the operation.
+	 * @param _required_roles - The sender must have at least one of these roles (ETwitchUserRole flags). 0 allows everyone.
+	 *
+	 * @return Whether the registration was successfully completed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
+	bool RegisterCommand(const FString& _command_name, const FOnCommandReceived& _callback_function, FString& _out_result,
+		UPARAM(meta = (Bitmask, BitmaskEnum = "ETwitchUserRole")) int32 _required_roles = 0);
+
+	/**
+	 * Registers a command whose identical calls are merged into a single event.
+	 * During hype moments thousands of chatters may send the same command within a second. Instead of one event each,
+	 * the receiver thread merges calls with the same options received within the window into one event carrying the count.
+	 * Calls of a coalesced command do not fire OnMessageReceived.
+	 * Replaces any previous registration of the same command, coalesced or not.
+	 *
+	 * @param _command_name - The command to register (CASE SENSITIVE).
+	 * @param _callback_function - The function to fire when a batch window closes.
+	 * @param _out_result - Result of the operation.
+	 * @param _window_seconds - Seconds from the first call of a batch until the event fires.
+	 * @param _max_senders - Maximum number of sender usernames listed in the event.
+	 * @param _required_roles - The sender must have at least one of these roles (ETwitchUserRole flags). 0 allows everyone.
+	 *
+	 * @return Whether the registration was successfully completed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
+	bool RegisterCoalescedCommand(const FString& _command_name, const FOnCoalescedCommandReceived& _callback_function, FString& _out_result,
+		float _window_seconds = 1.0f, int32 _max_senders = 16, UPARAM(meta = (Bitmask, BitmaskEnum = "ETwitchUserRole")) int32 _required_roles = 0);
+
+	/**
+	* Unregisters a command to stop receiving events whenever that command is called via chat.
+	* Keep in mind that since each command can only be bound to a single function (and single object) unregistering that command will remove any function from any object.
+	*
+	* @param _command_name - The command to unregister (CASE SENSITIVE).
+	* @param _out_result - Result of the operation.
+	*
+	* @return Whether the unregistration was successfully completed.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Commands Setup")
+	bool UnregisterCommand(const FString& _command_name, FString& _out_result);
+
+	/**
+	 * Annotates a command with the assets its handler is going to need.
+	 * As soon as the receiver thread parses the command the assets start streaming in, so they are usually resident by the time the event fires
+	 * instead of being loaded synchronously by the handler. Annotations are kept when the command is registered again.
+	 *
+	 * @param _command_name - The command to annotate (CASE SENSITIVE).
+	 * @param _assets - The assets to stream in.
+	 * @param _option - If not empty, the assets are only streamed in when the command comes with this option (ie. "dragon" for !spawn#dragon#).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Commands Prefetch")
+	void SetCommandPrefetchAssets(const FString& _command_name, const TArray<FSoftObjectPath>& _assets, const FString& _option = TEXT(""));
+
+	/**
+	 * Removes all the asset annotations of a command.
+	 *
+	 * @param _command_name - The command (CASE SENSITIVE).
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Commands Prefetch")
+	void ClearCommandPrefetchAssets(const FString& _command_name);
+
+	/**
+	 * Starts a poll chat votes on with a command, ie. !vote#red# or !vote#1# for the first option.
+	 * Votes are tallied on the receiver thread and do not need a registered command. Several polls can run at the same time,
+	 * even on the same command. Each voter counts once per poll.
+	 * If the vote command has assets annotated per option, the assets of an option start streaming in as soon as it takes the lead.
+	 *
+	 * @param _command_name - The command to vote with (CASE SENSITIVE).
+	 * @param _options - The options to vote for.
+	 * @param _duration_seconds - Seconds the poll stays open. 0 keeps it open until EndPoll is called.
+	 * @param _subscriber_multiplier - Weight of a subscriber vote, a plain vote weighs 1.
+	 * @param _weight_per_bit - Weight added to a vote for each bit cheered with it.
+	 * @param _allow_vote_change - Can voters move their vote to another option?
+	 * @param _required_roles - The voter must have at least one of these roles (ETwitchUserRole flags). 0 allows everyone.
+	 *
+	 * @return Id of the poll, -1 if the command or the options are empty.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Polls")
+	int32 StartPoll(const FString& _command_name, const TArray<FString>& _options, float _duration_seconds = 60.0f, float _subscriber_multiplier = 1.0f,
+		float _weight_per_bit = 0.0f, bool _allow_vote_change = false, UPARAM(meta = (Bitmask, BitmaskEnum = "ETwitchUserRole")) int32 _required_roles = 0);
+
+	/**
+	 * Closes a poll before its time. on_poll_ended_ fires with the final result on the next tick.
+	 *
+	 * @param _poll_id - Id returned by StartPoll.
+	 *
+	 * @return Whether the poll was open.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Polls")
+	bool EndPoll(int32 _poll_id);
+
+	/**
+	 * Gets the current state of a running poll.
+	 *
+	 * @param _poll_id - Id returned by StartPoll.
+	 * @param _out_result - Snapshot of the poll.
+	 *
+	 * @return Whether the poll is running.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Polls")
+	bool GetPollResult(int32 _poll_id, FTwitchPollResult& _out_result) const;
+
+	/**
+	 * Starts a raffle chat enters with a command, ie. !enter!.
+	 * Entries are deduped and sampled on the receiver thread as they arrive, so only the user ids are kept for each entrant
+	 * and drawing the winners does not depend on their number. Each user enters once, with the weight of their first entry.
+	 *
+	 * @param _command_name - The command to enter with (CASE SENSITIVE).
+	 * @param _num_winners - Number of winners to draw.
+	 * @param _subscriber_weight - Weight of a subscriber entry, a plain entry weighs 1.
+	 * @param _weight_per_bit - Weight added to an entry for each bit cheered with it.
+	 * @param _required_roles - The entrant must have at least one of these roles (ETwitchUserRole flags). 0 allows everyone.
+	 *
+	 * @return Id of the raffle, -1 if the command is empty.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Raffles")
+	int32 StartRaffle(const FString& _command_name, int32 _num_winners = 1, float _subscriber_weight = 1.0f,
+		float _weight_per_bit = 0.0f, UPARAM(meta = (Bitmask, BitmaskEnum = "ETwitchUserRole")) int32 _required_roles = 0);
+
+	/**
+	 * Closes a raffle and draws its winners.
+	 *
+	 * @param _raffle_id - Id returned by StartRaffle.
+	 * @param _out_winners - Usernames of the winners, in draw order. Fewer than asked if not enough viewers entered.
+	 *
+	 * @return Whether the raffle was running.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Raffles")
+	bool DrawRaffle(int32 _raffle_id, TArray<FString>& _out_winners);
+
+	/**
+	 * Number of distinct viewers that entered a running raffle, -1 if the raffle is not running.
+	 *
+	 * @param _raffle_id - Id returned by StartRaffle.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Raffles")
+	int32 GetRaffleEntrants(int32 _raffle_id) const;
+
+	/**
+	 * Starts a line of viewers joining with a command, ie. !join!.
+	 * Joins are handled on the receiver thread. Viewers are in line once, and leave it when they leave the channel or are timed out or banned.
+	 * Looking up the position of a viewer costs O(log n) however long the line is.
+	 *
+	 * @param _join_command - The command to join with (CASE SENSITIVE).
+	 * @param _leave_command - The command to leave with (CASE SENSITIVE), empty for none.
+	 * @param _max_viewers - Maximum number of viewers in line, 0 for no limit.
+	 * @param _required_roles - The viewer must have at least one of these roles (ETwitchUserRole flags). 0 allows everyone.
+	 *
+	 * @return Id of the queue, -1 if the join command is empty.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Viewer Queues")
+	int32 StartViewerQueue(const FString& _join_command, const FString& _leave_command = TEXT(""), int32 _max_viewers = 0,
+		UPARAM(meta = (Bitmask, BitmaskEnum = "ETwitchUserRole")) int32 _required_roles = 0);
+
+	/**
+	 * Stops a viewer queue, the viewers still in line are dropped.
+	 *
+	 * @param _queue_id - Id returned by StartViewerQueue.
+	 *
+	 * @return Whether the queue was running.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Viewer Queues")
+	bool StopViewerQueue(int32 _queue_id);
+
+	/**
+	 * Takes the next viewers out of the line.
+	 *
+	 * @param _queue_id - Id returned by StartViewerQueue.
+	 * @param _count - Maximum number of viewers to take.
+	 * @param _out_usernames - Usernames of the viewers, in line order.
+	 *
+	 * @return Whether the queue is running.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Viewer Queues")
+	bool DequeueViewers(int32 _queue_id, int32 _count, TArray<FString>& _out_usernames);
+
+	/**
+	 * Takes a viewer out of the line.
+	 *
+	 * @param _queue_id - Id returned by StartViewerQueue.
+	 * @param _username - Username of the viewer.
+	 *
+	 * @return Whether the viewer was in line.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Viewer Queues")
+	bool RemoveQueuedViewer(int32 _queue_id, const FString& _username);
+
+	/**
+	 * Position of a viewer in line, 1 for the next one. 0 if the viewer is not in line.
+	 *
+	 * @param _queue_id - Id returned by StartViewerQueue.
+	 * @param _username - Username of the viewer.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Viewer Queues")
+	int32 GetViewerQueuePosition(int32 _queue_id, const FString& _username) const;
+
+	/**
+	 * Number of viewers in line, -1 if the queue is not running.
+	 *
+	 * @param _queue_id - Id returned by StartViewerQueue.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Viewer Queues")
+	int32 GetViewerQueueLength(int32 _queue_id) const;
+
+	/**
+	 * Adds to the score of a viewer on the leaderboard. Viewers start with a score of 0.
+	 * O(log n) however many viewers are on the leaderboard.
+	 *
+	 * @param _username - Username of the viewer.
+	 * @param _delta - Score to add, can be negative.
+	 *
+	 * @return The new rank of the viewer, 1 for the top score.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	int32 AddViewerScore(const FString& _username, int64 _delta);
+
+	/**
+	 * Sets the score of a viewer on the leaderboard.
+	 *
+	 * @param _username - Username of the viewer.
+	 * @param _score - The new score.
+	 *
+	 * @return The new rank of the viewer, 1 for the top score.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	int32 SetViewerScore(const FString& _username, int64 _score);
+
+	/**
+	 * Takes a viewer off the leaderboard.
+	 *
+	 * @param _username - Username of the viewer.
+	 *
+	 * @return Whether the viewer was on the leaderboard.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	bool RemoveViewerScore(const FString& _username);
+
+	/**
+	 * Rank of a viewer on the leaderboard, 1 for the top score. 0 if the viewer is not on it.
+	 *
+	 * @param _username - Username of the viewer.
+	 * @param _out_score - Score of the viewer.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	int32 GetViewerRank(const FString& _username, int64& _out_score) const;
+
+	/**
+	 * Gets consecutive leaderboard entries, ie. the top 10 or the viewers around a rank.
+	 * Costs O(count + log n), cheap enough to refresh a displayed leaderboard every frame.
+	 *
+	 * @param _first_rank - Rank of the first entry, 1 for the top.
+	 * @param _count - Maximum number of entries.
+	 * @param _out_entries - The entries, best first.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	void GetLeaderboardEntries(int32 _first_rank, int32 _count, TArray<FTwitchLeaderboardEntry>& _out_entries) const;
+
+	/**
+	 * Changes each time a score changes. Compare it with the last one seen to skip refreshing a displayed leaderboard.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Leaderboard")
+	int32 GetLeaderboardRevision() const;
+
+	/**
+	 * Number of viewers on the leaderboard.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Leaderboard")
+	int32 GetLeaderboardSize() const;
+
+	/**
+	 * Takes everybody off the leaderboard.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Leaderboard")
+	void ResetLeaderboard();
+
+	/**
+	 * Starts tracking the chatters of the channel. Each tick on_chatters_updated_ is called once with the chatters that joined,
+	 * sent messages or left, so a crowd of chatter units can be created and updated in bulk.
+	 * Restarts tracking if already tracking.
+	 *
+	 * @param _max_chatters - Maximum number of chatters tracked, 0 for no limit. New chatters are ignored until others leave.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Chatters")
+	void StartChatterTracking(int32 _max_chatters = 0);
+
+	/**
+	 * Stops tracking the chatters.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Chatters")
+	void StopChatterTracking();
+
+	/**
+	 * Number of chatters tracked.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Chatters")
+	int32 GetNumChatters() const;
+
+	/**
+	 * Gets the commands whose handlers took the most time, slowest first.
+	 * Handlers are only timed while the TwitchPlay.ProfileCommands console variable is set. Costs are shared by all the components.
+	 *
+	 * @param _count - Maximum number of commands listed, 0 for all of them.
+	 * @param _out_costs - Number of calls, total and max time of each command.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Profiling")
+	void GetCommandCosts(int32 _count, TArray<FTwitchCommandCost>& _out_costs) const;
+
+private:
+
+	/**
+	 * Handler for when a message is received.
+	 * The receiver thread already found and authorized the command, so only the event needs to be fired.
+	 *
+	 * @param _message - The message that was received.
+	 */
+	virtual void HandleChatMessage(const FTwitchChatMessage& _message) override;
+
+	// Drops the commands still waiting in the queue, they can't be fired once the connection is gone
+	virtual void HandleDisconnected() override;
+
+	/**
+	 * Fires the event registered for the command of the message.
+	 *
+	 * @param _message - The message, with an authorized command.
+	 */
+	void DispatchCommand(const FTwitchChatMessage& _message);
+
+	/**
+	 * Fires up to max_commands_per_tick_ of the queued commands, highest priority first.
+	 */
+	void DispatchPendingCommands();
+
+	/**
+	 * Publishes a copy of the current command rules to the receiver thread.
+	 */
+	void PublishCommandRules();
+
+	/**
+	 * Fires on_chatters_updated_ with the chatter changes since the last tick.
+	 */
+	void PublishChatterBatch();
+
+	/**
+	 * Fires the poll events for the polls that changed or closed since the last tick.
+	 */
+	void PublishPollResults();
+};
@@ -1,15 +1,28 @@
-// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
-
-#pragma once
-
-#include "Modules/ModuleManager.h"
-#include "Engine.h"
-
-class FTwitchPlayModule : public IModuleInterface
-{
-public:
-
-	/** IModuleInterface implementation */
-	virtual void StartupModule() override;
-	virtual void ShutdownModule() override;
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "Modules/ModuleManager.h"
+#include "Engine.h"
+
+class FTwitchMetricsEndpoint;
+
+class FTwitchPlayModule : public IModuleInterface
+{
+public:
+
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+
+private:
+
+	// Starts or stops the metrics endpoint when TwitchPlay.MetricsPort changes
+	void OnMetricsPortChanged(IConsoleVariable* variable);
+
+	// Local Prometheus endpoint, only while TwitchPlay.MetricsPort is set
+	TSharedPtr<FTwitchMetricsEndpoint> MetricsEndpoint;
+
+	// Records the per-frame stats in CSV profiles
+	FDelegateHandle CsvFrameHandle;
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+#include "Chat/TwitchChatHistory.h"
+
+class UTwitchEmoteCache;
+
+using FTwitchChatListItemPtr = TSharedPtr<FTwitchChatHistoryEntry>;
+
+/**
+ * Virtualized list of the last chat messages, read from a chat history.
+ * Only the visible rows have widgets. New messages are pulled from the history once per frame and appended in one batch,
+ * so the cost of the list depends on its size on screen and not on how fast chat is going.
+ */
+class TWITCHPLAY_API STwitchChatList : public SCompoundWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(STwitchChatList)
+		: _MaxMessages(200)
+		, _UsernameColor(FLinearColor(0.57f, 0.27f, 1.0f))
+		, _MessageColor(FLinearColor::White)
+		, _bAutoScroll(true)
+		{}
+
+		// History to read the messages from. Can change or be null, ie. before connecting.
+		SLATE_ATTRIBUTE(FTwitchChatHistoryPtr, History)
+
+		// Emote images of the messages with a display line. Without it emotes are shown as text.
+		SLATE_ATTRIBUTE(UTwitchEmoteCache*, EmoteCache)
+
+		// Number of messages kept in the list, older ones are dropped
+		SLATE_ARGUMENT(int32, MaxMessages)
+
+		SLATE_ARGUMENT(FSlateFontInfo, Font)
+		SLATE_ARGUMENT(FSlateColor, UsernameColor)
+		SLATE_ARGUMENT(FSlateColor, MessageColor)
+
+		// If true, the list follows new messages while it is scrolled to the end
+		SLATE_ARGUMENT(bool, bAutoScroll)
+
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	// Removes the messages shown so far. Only messages received afterwards are shown.
+	void ClearMessages();
+
+	//
+	// SWidget interface.
+	//
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+
+private:
+
+	// Appends the records added to the history since the last frame
+	void AppendNewRecords();
+
+	TSharedRef<ITableRow> GenerateRow(FTwitchChatListItemPtr item, const TSharedRef<STableViewBase>& ownerTable);
+
+	// Content of a message with emotes, words and emote images wrapped together
+	TSharedRef<SWidget> MakeEmoteContent(const FTwitchChatHistoryEntry& item, const FTwitchChatDisplayLine& display, UTwitchEmoteCache* emoteCache) const;
+
+	TAttribute<FTwitchChatHistoryPtr> History;
+	TAttribute<UTwitchEmoteCache*> EmoteCache;
+
+	// History the items were read from, the list restarts when it changes
+	TWeakPtr<FTwitchChatHistory, ESPMode::ThreadSafe> ShownHistory;
+
+	// Newest record read from the history
+	uint64 LastShownId;
+
+	int32 MaxMessages;
+	FSlateFontInfo Font;
+	FSlateColor UsernameColor;
+	FSlateColor MessageColor;
+	bool bAutoScroll;
+
+	// Shown messages, oldest first
+	TArray<FTwitchChatListItemPtr> Items;
+
+	// Items dropped from the list, reused for new messages
+	TArray<FTwitchChatListItemPtr> FreeItems;
+
+	// Records read each frame, kept to reuse its allocation
+	TArray<FTwitchChatHistoryEntry> NewRecords;
+
+	TSharedPtr<SListView<FTwitchChatListItemPtr>> ListView;
+};
@@ -0,0 +1,80 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/Widget.h"
+#include "Chat/TwitchChatHistory.h"
+#include "TwitchChatList.generated.h"
+
+class STwitchChatList;
+class UTwitchIRCComponent;
+class UTwitchEmoteCache;
+
+/**
+ * Chat list showing the last messages received by an IRC component, read straight from its chat history.
+ * Use this instead of adding a widget per message from OnMessageReceived: only the visible rows are built
+ * and new messages are appended once per frame however fast chat is going.
+ */
+UCLASS()
+class TWITCHPLAY_API UTwitchChatList : public UWidget
+{
+	GENERATED_BODY()
+
+public:
+
+	UTwitchChatList(const FObjectInitializer& ObjectInitializer);
+
+	// Number of messages kept in the list, older ones are dropped
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Chat", meta = (ClampMin = "1"))
+	int32 MaxMessages;
+
+	// If true, the list follows new messages while it is scrolled to the end
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Chat")
+	bool bAutoScroll;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Appearance")
+	FSlateFontInfo Font;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Appearance")
+	FSlateColor UsernameColor;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Appearance")
+	FSlateColor MessageColor;
+
+	/**
+	 * Sets the component whose chat history is shown. The component must keep a history (ChatHistorySize above 0).
+	 * Can be set before connecting, messages show up once connected.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Chat")
+	void SetChatComponent(UTwitchIRCComponent* component);
+
+	// Removes the messages shown so far. Only messages received afterwards are shown.
+	UFUNCTION(BlueprintCallable, Category = "Chat")
+	void ClearMessages();
+
+	//
+	// UWidget interface.
+	//
+	virtual void ReleaseSlateResources(bool bReleaseChildren) override;
+#if WITH_EDITOR
+	virtual const FText GetPaletteCategory() override;
+#endif
+
+protected:
+
+	virtual TSharedRef<SWidget> RebuildWidget() override;
+
+private:
+
+	// History of the chat component, polled by the list each frame
+	FTwitchChatHistoryPtr GetChatHistory() const;
+
+	// Emote cache of the chat component, for the messages with a display line
+	UTwitchEmoteCache* GetEmoteCache() const;
+
+	UPROPERTY(Transient)
+	TWeakObjectPtr<UTwitchIRCComponent> ChatComponent;
+
+	TSharedPtr<STwitchChatList> MyChatList;
+};
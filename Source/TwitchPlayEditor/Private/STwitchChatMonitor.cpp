@@ -0,0 +1,306 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "STwitchChatMonitor.h"
+#include "STwitchMonitorGraph.h"
+#include "Components/TwitchIRCComponent.h"
+#include "Widgets/STwitchChatList.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UObjectIterator.h"
+#include "Widgets/SBoxPanel.h"
+#include "Widgets/SOverlay.h"
+#include "Widgets/Layout/SBorder.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Layout/SSplitter.h"
+#include "Widgets/Layout/SUniformGridPanel.h"
+#include "Widgets/Text/STextBlock.h"
+#include "EditorStyleSet.h"
+
+#define LOCTEXT_NAMESPACE "TwitchPlayEditor"
+
+// Graphs are sampled this many times per second
+static constexpr double MonitorSampleRate = 4.0;
+
+// Samples kept per graph, 30 seconds
+static constexpr int32 MonitorNumSamples = 120;
+
+// Seconds between looks for new sessions
+static constexpr double MonitorRefreshSeconds = 1.0;
+
+// Messages kept for a session without a history of its own, as many as the chat list shows
+static constexpr int32 MonitorHistorySize = 500;
+
+void STwitchChatMonitor::FSeries::Add(const float sample)
+{
+	if(Samples.Num() >= MonitorNumSamples)
+	{
+		Samples.RemoveAt(0, Samples.Num() - MonitorNumSamples + 1, false);
+	}
+	Samples.Add(sample);
+}
+
+void STwitchChatMonitor::Construct(const FArguments& InArgs)
+{
+	LastSnapshot = FTwitchStats::Get().TakeSnapshot();
+	LastSampleTime = FPlatformTime::Seconds();
+	LastRefreshTime = 0.0;
+
+	auto make_graph = [](const FSeries& series, const FText& label, const FText& valueFormat)
+	{
+		return SNew(SBox)
+			.Padding(2.0f)
+			[
+				SNew(STwitchMonitorGraph)
+				.Samples(&series.Samples)
+				.Label(label)
+				.ValueFormat(valueFormat)
+			];
+	};
+	const FText per_second = LOCTEXT("PerSecond", "{0}/s");
+	const FText milliseconds = LOCTEXT("Milliseconds", "{0} ms");
+	const FText plain = LOCTEXT("Plain", "{0}");
+
+	ChildSlot
+	[
+		SNew(SSplitter)
+		.Orientation(Orient_Vertical)
+		+ SSplitter::Slot()
+		.Value(0.45f)
+		[
+			SNew(SUniformGridPanel)
+			+ SUniformGridPanel::Slot(0, 0) [ make_graph(LinesPerSecond, LOCTEXT("Lines", "Lines"), per_second) ]
+			+ SUniformGridPanel::Slot(1, 0) [ make_graph(MessagesPerSecond, LOCTEXT("Messages", "Messages"), per_second) ]
+			+ SUniformGridPanel::Slot(0, 1) [ make_graph(ParseMillisecondsPerSecond, LOCTEXT("ParseCost", "Parse cost"), LOCTEXT("MillisecondsPerSecond", "{0} ms/s")) ]
+			+ SUniformGridPanel::Slot(1, 1) [ make_graph(DispatchLatency, LOCTEXT("DispatchLatency", "Dispatch latency"), milliseconds) ]
+			+ SUniformGridPanel::Slot(0, 2) [ make_graph(ReceiveBacklog, LOCTEXT("ReceiveBacklog", "Receive backlog"), plain) ]
+			+ SUniformGridPanel::Slot(1, 2) [ make_graph(SendQueueDepth, LOCTEXT("SendQueue", "Send queue"), plain) ]
+			+ SUniformGridPanel::Slot(0, 3) [ make_graph(RejectedPerSecond, LOCTEXT("Rejected", "Rejected commands"), per_second) ]
+			+ SUniformGridPanel::Slot(1, 3) [ make_graph(RoundTrip, LOCTEXT("RoundTrip", "Round trip"), milliseconds) ]
+		]
+		+ SSplitter::Slot()
+		.Value(0.55f)
+		[
+			SNew(SSplitter)
+			+ SSplitter::Slot()
+			.Value(0.3f)
+			[
+				SAssignNew(SessionList, SListView<FSessionPtr>)
+				.ListItemsSource(&Sessions)
+				.SelectionMode(ESelectionMode::Single)
+				.OnGenerateRow(this, &STwitchChatMonitor::GenerateSessionRow)
+				.OnSelectionChanged_Lambda([this](FSessionPtr session, ESelectInfo::Type selectInfo)
+				{
+					SelectedComponent = session.IsValid() ? session->Component : TWeakObjectPtr<UTwitchIRCComponent>();
+					UpdateMonitorHistory();
+				})
+			]
+			+ SSplitter::Slot()
+			.Value(0.7f)
+			[
+				SNew(SBorder)
+				.BorderImage(FEditorStyle::GetBrush("ToolPanel.GroupBorder"))
+				[
+					SNew(SOverlay)
+					+ SOverlay::Slot()
+					[
+						SNew(STwitchChatList)
+						.History(this, &STwitchChatMonitor::GetSelectedHistory)
+						.MaxMessages(MonitorHistorySize)
+					]
+					+ SOverlay::Slot()
+					.HAlign(HAlign_Center)
+					.VAlign(VAlign_Center)
+					[
+						SNew(STextBlock)
+						.Text(LOCTEXT("NoSession", "Play in editor with a Twitch IRC component to see its chat"))
+						.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+						.Visibility(this, &STwitchChatMonitor::GetNoHistoryVisibility)
+					]
+				]
+			]
+		]
+	];
+}
+
+STwitchChatMonitor::~STwitchChatMonitor()
+{
+	// The session must not keep filling a history nobody reads
+	UTwitchIRCComponent* component = MonitoredComponent.Get();
+	if(component != nullptr)
+	{
+		component->RemoveChatStage(MonitorHistory);
+	}
+}
+
+void STwitchChatMonitor::Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime)
+{
+	SCompoundWidget::Tick(AllottedGeometry, InCurrentTime, InDeltaTime);
+
+	const double now = FPlatformTime::Seconds();
+	if(now - LastSampleTime >= 1.0 / MonitorSampleRate)
+	{
+		TakeSample(now);
+	}
+	if(now - LastRefreshTime >= MonitorRefreshSeconds)
+	{
+		LastRefreshTime = now;
+		RefreshSessions();
+		UpdateMonitorHistory();
+	}
+}
+
+void STwitchChatMonitor::TakeSample(const double time)
+{
+	const FTwitchStatsSnapshot snapshot = FTwitchStats::Get().TakeSnapshot();
+	const float seconds = static_cast<float>(time - LastSampleTime);
+
+	LinesPerSecond.Add((snapshot.LinesReceived - LastSnapshot.LinesReceived) / seconds);
+	MessagesPerSecond.Add((snapshot.MessagesReceived - LastSnapshot.MessagesReceived) / seconds);
+	ParseMillisecondsPerSecond.Add((snapshot.ParseMicroseconds - LastSnapshot.ParseMicroseconds) / 1000.0f / seconds);
+	RejectedPerSecond.Add((snapshot.CommandsRejected - LastSnapshot.CommandsRejected) / seconds);
+	ReceiveBacklog.Add(static_cast<float>(snapshot.ReceiveQueueDepth));
+	SendQueueDepth.Add(static_cast<float>(snapshot.SendQueueDepth));
+	DispatchLatency.Add(snapshot.DispatchLatencyMicroseconds / 1000.0f);
+	RoundTrip.Add(FMath::Max(snapshot.RoundTripMicroseconds, int64(0)) / 1000.0f);
+
+	LastSnapshot = snapshot;
+	LastSampleTime = time;
+}
+
+void STwitchChatMonitor::RefreshSessions()
+{
+	TArray<FSessionPtr> sessions;
+	for(TObjectIterator<UTwitchIRCComponent> it; it; ++it)
+	{
+		UTwitchIRCComponent* component = *it;
+		const UWorld* world = component->GetWorld();
+		if(world == nullptr || world->WorldType != EWorldType::PIE || component->IsPendingKill() || component->IsTemplate())
+		{
+			continue;
+		}
+
+		const FWorldContext* context = GEngine->GetWorldContextFromWorld(world);
+		const AActor* owner = component->GetOwner();
+		FSessionPtr session = MakeShared<FSession>();
+		session->Component = component;
+		session->Label = FString::Printf(TEXT("PIE %d: %s.%s"), context != nullptr ? context->PIEInstance : 0,
+			owner != nullptr ? *owner->GetName() : TEXT("?"), *component->GetName());
+		sessions.Add(MoveTemp(session));
+	}
+
+	// Keep the rows, and the selection, while the sessions stay the same
+	const bool b_same = sessions.Num() == Sessions.Num() && !sessions.ContainsByPredicate([this](const FSessionPtr& session)
+	{
+		return !Sessions.ContainsByPredicate([&session](const FSessionPtr& shown)
+		{
+			return shown->Component == session->Component;
+		});
+	});
+	if(b_same)
+	{
+		return;
+	}
+
+	Sessions = MoveTemp(sessions);
+	SessionList->RequestListRefresh();
+
+	const FSessionPtr* selected = Sessions.FindByPredicate([this](const FSessionPtr& session)
+	{
+		return session->Component == SelectedComponent;
+	});
+	if(selected != nullptr)
+	{
+		SessionList->SetSelection(*selected);
+	}
+	else if(Sessions.Num() > 0)
+	{
+		// Follow the first session by default
+		SessionList->SetSelection(Sessions[0]);
+	}
+	else
+	{
+		SelectedComponent = nullptr;
+	}
+}
+
+void STwitchChatMonitor::UpdateMonitorHistory()
+{
+	// The session history is created on its first connection, from then on the monitor one is not needed
+	UTwitchIRCComponent* selected = SelectedComponent.Get();
+	UTwitchIRCComponent* target = selected != nullptr && !selected->GetChatHistory().IsValid() ? selected : nullptr;
+
+	UTwitchIRCComponent* monitored = MonitoredComponent.Get();
+	if(monitored == target && MonitorHistory.IsValid() == (target != nullptr))
+	{
+		return;
+	}
+
+	if(monitored != nullptr)
+	{
+		monitored->RemoveChatStage(MonitorHistory);
+	}
+	MonitoredComponent = target;
+	if(target != nullptr)
+	{
+		// Start empty, the list restarts when its history changes
+		MonitorHistory = MakeShared<FTwitchChatHistory, ESPMode::ThreadSafe>(MonitorHistorySize, false);
+		target->AddChatStage(MonitorHistory);
+	}
+	else
+	{
+		MonitorHistory = nullptr;
+	}
+}
+
+FTwitchChatHistoryPtr STwitchChatMonitor::GetSelectedHistory() const
+{
+	const UTwitchIRCComponent* component = SelectedComponent.Get();
+	if(component == nullptr)
+	{
+		return nullptr;
+	}
+	if(component->GetChatHistory().IsValid())
+	{
+		return component->GetChatHistory();
+	}
+	return MonitoredComponent == SelectedComponent ? MonitorHistory : nullptr;
+}
+
+EVisibility STwitchChatMonitor::GetNoHistoryVisibility() const
+{
+	return SelectedComponent.IsValid() ? EVisibility::Collapsed : EVisibility::HitTestInvisible;
+}
+
+TSharedRef<ITableRow> STwitchChatMonitor::GenerateSessionRow(FSessionPtr session, const TSharedRef<STableViewBase>& ownerTable)
+{
+	return SNew(STableRow<FSessionPtr>, ownerTable)
+		[
+			SNew(SVerticalBox)
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock)
+				.Text(FText::FromString(session->Label))
+			]
+			+ SVerticalBox::Slot()
+			.AutoHeight()
+			[
+				SNew(STextBlock)
+				.Text(this, &STwitchChatMonitor::GetSessionStatus, session)
+				.ColorAndOpacity(FSlateColor::UseSubduedForeground())
+			]
+		];
+}
+
+FText STwitchChatMonitor::GetSessionStatus(FSessionPtr session) const
+{
+	const UTwitchIRCComponent* component = session->Component.Get();
+	if(component == nullptr)
+	{
+		return LOCTEXT("SessionEnded", "Ended");
+	}
+	return component->IsConnected() ? LOCTEXT("SessionConnected", "Connected") : LOCTEXT("SessionDisconnected", "Not connected");
+}
+
+#undef LOCTEXT_NAMESPACE
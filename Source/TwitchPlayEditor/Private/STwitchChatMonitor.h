@@ -0,0 +1,90 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+#include "Chat/TwitchStats.h"
+#include "Chat/TwitchChatHistory.h"
+
+class UTwitchIRCComponent;
+
+/**
+ * Editor panel showing the chat load of the Twitch connections while playing in editor.
+ * Graphs are sampled a few times per second from the stats counters, and the chat of the selected session is read
+ * from its history ring, so watching a session adds next to nothing to it.
+ * A session without a history gets a small one from the panel, only while it is selected and the panel is open.
+ */
+class STwitchChatMonitor : public SCompoundWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(STwitchChatMonitor)
+		{}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+	virtual ~STwitchChatMonitor();
+
+	//
+	// SWidget interface.
+	//
+	virtual void Tick(const FGeometry& AllottedGeometry, const double InCurrentTime, const float InDeltaTime) override;
+
+private:
+
+	// A component of a PIE world
+	struct FSession
+	{
+		TWeakObjectPtr<UTwitchIRCComponent> Component;
+		FString Label;
+	};
+
+	using FSessionPtr = TSharedPtr<FSession>;
+
+	// Samples of a graphed value, oldest first
+	struct FSeries
+	{
+		TArray<float> Samples;
+		void Add(const float sample);
+	};
+
+	// Reads the stats and adds a sample to each graph
+	void TakeSample(const double time);
+
+	// Finds the IRC components of the PIE worlds
+	void RefreshSessions();
+
+	// Installs the monitor history on the selected session if it has none of its own, and removes it from any other
+	void UpdateMonitorHistory();
+
+	// History of the selected session
+	FTwitchChatHistoryPtr GetSelectedHistory() const;
+
+	EVisibility GetNoHistoryVisibility() const;
+
+	TSharedRef<ITableRow> GenerateSessionRow(FSessionPtr session, const TSharedRef<STableViewBase>& ownerTable);
+	FText GetSessionStatus(FSessionPtr session) const;
+
+	FSeries LinesPerSecond;
+	FSeries MessagesPerSecond;
+	FSeries ParseMillisecondsPerSecond;
+	FSeries ReceiveBacklog;
+	FSeries SendQueueDepth;
+	FSeries RejectedPerSecond;
+	FSeries DispatchLatency;
+	FSeries RoundTrip;
+
+	FTwitchStatsSnapshot LastSnapshot;
+	double LastSampleTime;
+	double LastRefreshTime;
+
+	TArray<FSessionPtr> Sessions;
+	TWeakObjectPtr<UTwitchIRCComponent> SelectedComponent;
+
+	// History the panel adds to the pipeline of a session without one, and the session it is on
+	FTwitchChatHistoryPtr MonitorHistory;
+	TWeakObjectPtr<UTwitchIRCComponent> MonitoredComponent;
+	TSharedPtr<SListView<FSessionPtr>> SessionList;
+};
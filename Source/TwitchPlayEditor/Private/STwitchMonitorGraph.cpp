@@ -0,0 +1,58 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "STwitchMonitorGraph.h"
+#include "Rendering/DrawElements.h"
+#include "Styling/CoreStyle.h"
+
+void STwitchMonitorGraph::Construct(const FArguments& InArgs)
+{
+	Samples = InArgs._Samples;
+	Label = InArgs._Label;
+	ValueFormat = InArgs._ValueFormat.IsEmpty() ? FText::FromString(TEXT("{0}")) : InArgs._ValueFormat;
+	Color = InArgs._Color;
+}
+
+FVector2D STwitchMonitorGraph::ComputeDesiredSize(float LayoutScaleMultiplier) const
+{
+	return FVector2D(240.0f, 72.0f);
+}
+
+int32 STwitchMonitorGraph::OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+	int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const
+{
+	const FVector2D size = AllottedGeometry.GetLocalSize();
+	FSlateDrawElement::MakeBox(OutDrawElements, LayerId, AllottedGeometry.ToPaintGeometry(), FCoreStyle::Get().GetBrush("GenericWhiteBox"),
+		ESlateDrawEffect::None, FLinearColor(0.02f, 0.02f, 0.02f, 1.0f));
+
+	float last_sample = 0.0f;
+	float max_sample = 0.0f;
+	if(Samples != nullptr && Samples->Num() > 0)
+	{
+		last_sample = Samples->Last();
+		for(const float sample : *Samples)
+		{
+			max_sample = FMath::Max(max_sample, sample);
+		}
+	}
+
+	if(Samples != nullptr && Samples->Num() > 1)
+	{
+		// Leave room for the label at the top
+		const float top = 18.0f;
+		const float scale = max_sample > 0.0f ? (size.Y - top - 2.0f) / max_sample : 0.0f;
+		const float step = size.X / static_cast<float>(Samples->Num() - 1);
+		Points.Reset(Samples->Num());
+		for(int32 index = 0; index < Samples->Num(); ++index)
+		{
+			Points.Add(FVector2D(index * step, size.Y - 1.0f - (*Samples)[index] * scale));
+		}
+		FSlateDrawElement::MakeLines(OutDrawElements, LayerId + 1, AllottedGeometry.ToPaintGeometry(), Points, ESlateDrawEffect::None, Color, true, 1.5f);
+	}
+
+	const FText text = FText::Format(FText::FromString(TEXT("{0}: {1} (max {2})")), Label,
+		FText::Format(ValueFormat, FText::AsNumber(last_sample)), FText::Format(ValueFormat, FText::AsNumber(max_sample)));
+	FSlateDrawElement::MakeText(OutDrawElements, LayerId + 2, AllottedGeometry.ToOffsetPaintGeometry(FVector2D(4.0f, 2.0f)), text,
+		FCoreStyle::GetDefaultFontStyle("Regular", 9), ESlateDrawEffect::None, FLinearColor::White);
+
+	return LayerId + 2;
+}
@@ -0,0 +1,52 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Widgets/SLeafWidget.h"
+
+/**
+ * Line graph of the last samples of a value, scaled to its highest sample.
+ * Draws straight from the samples it is given, nothing is copied.
+ */
+class STwitchMonitorGraph : public SLeafWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(STwitchMonitorGraph)
+		: _Samples(nullptr)
+		, _Color(FLinearColor(0.57f, 0.27f, 1.0f))
+		{}
+
+		// Samples to draw, oldest first. Must outlive the widget.
+		SLATE_ARGUMENT(const TArray<float>*, Samples)
+
+		// Name of the value, shown with its last and highest samples
+		SLATE_ARGUMENT(FText, Label)
+
+		// Format of the values shown, ie. "{0} ms"
+		SLATE_ARGUMENT(FText, ValueFormat)
+
+		SLATE_ARGUMENT(FLinearColor, Color)
+
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	//
+	// SWidget interface.
+	//
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry, const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+		int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override;
+	virtual FVector2D ComputeDesiredSize(float LayoutScaleMultiplier) const override;
+
+private:
+
+	const TArray<float>* Samples;
+	FText Label;
+	FText ValueFormat;
+	FLinearColor Color;
+
+	// Points of the line, kept to reuse the allocation
+	mutable TArray<FVector2D> Points;
+};
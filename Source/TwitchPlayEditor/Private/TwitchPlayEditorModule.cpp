@@ -0,0 +1,50 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+#include "Modules/ModuleManager.h"
+#include "Framework/Application/SlateApplication.h"
+#include "Framework/Docking/TabManager.h"
+#include "Widgets/Docking/SDockTab.h"
+#include "WorkspaceMenuStructure.h"
+#include "WorkspaceMenuStructureModule.h"
+#include "STwitchChatMonitor.h"
+
+#define LOCTEXT_NAMESPACE "TwitchPlayEditor"
+
+static const FName TwitchChatMonitorTabName(TEXT("TwitchChatMonitor"));
+
+class FTwitchPlayEditorModule : public IModuleInterface
+{
+public:
+
+	/** IModuleInterface implementation */
+	virtual void StartupModule() override
+	{
+		FGlobalTabmanager::Get()->RegisterNomadTabSpawner(TwitchChatMonitorTabName, FOnSpawnTab::CreateStatic(&FTwitchPlayEditorModule::SpawnChatMonitorTab))
+			.SetDisplayName(LOCTEXT("ChatMonitorTabTitle", "Twitch Chat Monitor"))
+			.SetTooltipText(LOCTEXT("ChatMonitorTabTooltip", "Live chat load, queues and latency of the Twitch connections while playing in editor."))
+			.SetGroup(WorkspaceMenu::GetMenuStructure().GetDeveloperToolsMiscCategory());
+	}
+
+	virtual void ShutdownModule() override
+	{
+		if(FSlateApplication::IsInitialized())
+		{
+			FGlobalTabmanager::Get()->UnregisterNomadTabSpawner(TwitchChatMonitorTabName);
+		}
+	}
+
+private:
+
+	static TSharedRef<SDockTab> SpawnChatMonitorTab(const FSpawnTabArgs& args)
+	{
+		return SNew(SDockTab)
+			.TabRole(ETabRole::NomadTab)
+			[
+				SNew(STwitchChatMonitor)
+			];
+	}
+};
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FTwitchPlayEditorModule, TwitchPlayEditor)
@@ -0,0 +1,29 @@
+// Copyright (C) Simone Di Gravio <email: altairjp@gmail.com> - All Rights Reserved
+
+using UnrealBuildTool;
+using System.IO;
+
+public class TwitchPlayEditor : ModuleRules
+{
+	public TwitchPlayEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PrivateIncludePaths.Add(Path.Combine(ModuleDirectory, "Private"));
+
+		PrivateDependencyModuleNames.AddRange(
+			 new string[]
+			 {
+					 "Core",
+					 "CoreUObject",
+					 "Engine",
+					 "Slate",
+					 "SlateCore",
+					 "EditorStyle",
+					 "UnrealEd",
+					 "WorkspaceMenuStructure",
+					 "TwitchPlay",
+			 }
+			 );
+	}
+}